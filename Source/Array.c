@@ -0,0 +1,215 @@
+#include "Array.h"
+
+#include <string.h>
+
+void *M_ArrayReserve(M_Arena **arena, umem max_size) {
+	*arena = M_ArenaAllocate(M_ARRAY_OFFSET + max_size, 0);
+	if (!(*arena)->reserved)
+		return nullptr;
+	return (u8 *)*arena + M_ARRAY_OFFSET;
+}
+
+bool M_ArrayGrow(M_Arena *arena, umem size) {
+	umem pos = M_ARRAY_OFFSET + size;
+	if (pos <= arena->committed)
+		return true;
+
+	if (pos > arena->reserved)
+		return false;
+
+	// Commit ahead by half of what is there already, so a growing array makes a
+	// logarithmic number of commit calls instead of one per page
+	umem want = Max(pos, arena->committed + arena->committed / 2);
+	return M_EnsureCommit(arena, Min(want, arena->reserved));
+}
+
+void M_ArrayShrink(M_Arena *arena, umem size) {
+	if (arena->reserved)
+		M_PackToPosition(arena, M_ARRAY_OFFSET + size);
+}
+
+//
+//
+//
+
+bool M_StackGrow(void **data, imem *capacity, M_Arena **arena, umem element_size, umem max_count) {
+	umem count = (umem)*capacity;
+	if (count >= max_count)
+		return false;
+
+	umem grown = Min(count * 2, max_count);
+
+	// The first time the local elements move over, the array has room for all of them
+	if (!*arena) {
+		void *spill = M_ArrayReserve(arena, element_size * max_count);
+		if (!spill || !M_ArrayGrow(*arena, element_size * grown))
+			return false;
+		memcpy(spill, *data, element_size * count);
+		*data = spill;
+	} else if (!M_ArrayGrow(*arena, element_size * grown)) {
+		return false;
+	}
+
+	*capacity = (imem)grown;
+	return true;
+}
+
+//
+//
+//
+
+#define M_MAP_MIN_SLOTS 16
+
+static umem M_MapSlotsFor(umem count) {
+	// Keeps the table at most 3/4 full
+	umem slots = M_MAP_MIN_SLOTS;
+	while (slots / 4 * 3 < count)
+		slots *= 2;
+	return slots;
+}
+
+bool M_MapInit(M_Map *map, umem item_size, umem max_count) {
+	memset(map, 0, sizeof(*map));
+
+	max_count      = Min(max_count, (umem)UINT32_MAX - 1);
+	map->item_size = item_size;
+	map->max_count = max_count;
+
+	bool result = M_ArrayInit(&map->items, item_size * max_count);
+	result      = M_ArrayInit(&map->hashes, max_count) && result;
+	result      = M_ArrayInit(&map->slots, M_MapSlotsFor(max_count)) && result;
+
+	if (!result)
+		M_MapFree(map);
+	return result;
+}
+
+void M_MapFree(M_Map *map) {
+	if (map->items.arena)  M_ArrayFree(&map->items);
+	if (map->hashes.arena) M_ArrayFree(&map->hashes);
+	if (map->slots.arena)  M_ArrayFree(&map->slots);
+}
+
+void M_MapClear(M_Map *map) {
+	M_ArrayClear(&map->items);
+	M_ArrayClear(&map->hashes);
+	memset(map->slots.data, 0, sizeof(M_Map_Slot) * map->slots.count);
+}
+
+static void M_MapPlace(M_Map *map, u64 hash, u32 item) {
+	umem mask = (umem)map->slots.count - 1;
+	umem slot = (umem)hash & mask;
+
+	while (map->slots.data[slot].item)
+		slot = (slot + 1) & mask;
+
+	map->slots.data[slot] = (M_Map_Slot){ item, (u32)(hash >> 32) };
+}
+
+// Only the table is rebuilt, items stay where they are
+static bool M_MapResize(M_Map *map, umem slots) {
+	if (!M_ArrayGrow(map->slots.arena, sizeof(M_Map_Slot) * slots))
+		return false;
+
+	map->slots.count = (imem)slots;
+	memset(map->slots.data, 0, sizeof(M_Map_Slot) * slots);
+
+	for (imem index = 0; index < map->hashes.count; ++index)
+		M_MapPlace(map, map->hashes.data[index], (u32)index + 1);
+
+	return true;
+}
+
+void *M_MapFind(M_Map *map, u64 hash, umem *probe) {
+	if (!map->slots.count)
+		return nullptr;
+
+	umem mask = (umem)map->slots.count - 1;
+	umem slot = *probe ? *probe - 1 : (umem)hash & mask;
+	u32  tag  = (u32)(hash >> 32);
+
+	for (M_Map_Slot *entry = &map->slots.data[slot]; entry->item; entry = &map->slots.data[slot]) {
+		slot = (slot + 1) & mask;
+
+		if (entry->tag == tag && map->hashes.data[entry->item - 1] == hash) {
+			*probe = slot + 1;
+			return M_MapItem(map, entry->item - 1);
+		}
+	}
+
+	*probe = slot + 1;
+	return nullptr;
+}
+
+void *M_MapInsert(M_Map *map, u64 hash, u32 flags) {
+	umem count = (umem)map->hashes.count;
+	if (count >= map->max_count)
+		return nullptr;
+
+	if ((count + 1) > (umem)map->slots.count / 4 * 3) {
+		if (!M_MapResize(map, map->slots.count ? (umem)map->slots.count * 2 : M_MAP_MIN_SLOTS))
+			return nullptr;
+	}
+
+	u8 * item = M_ArrayPushN(&map->items, map->item_size);
+	u64 *slot = M_ArrayPush(&map->hashes);
+	if (!item || !slot)
+		return nullptr;
+
+	*slot = hash;
+	if (flags & M_CLEAR_MEMORY)
+		memset(item, 0, map->item_size);
+
+	M_MapPlace(map, hash, (u32)count + 1);
+	return item;
+}
+
+static umem M_MapSlotOf(M_Map *map, u32 item) {
+	umem mask = (umem)map->slots.count - 1;
+	umem slot = (umem)map->hashes.data[item - 1] & mask;
+
+	while (map->slots.data[slot].item != item)
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+void M_MapRemove(M_Map *map, void *item) {
+	umem mask  = (umem)map->slots.count - 1;
+	umem index = ((u8 *)item - map->items.data) / map->item_size;
+	umem hole  = M_MapSlotOf(map, (u32)index + 1);
+
+	// Shift back the following slots that can not be found past the hole anymore
+	for (bool shifted = true; shifted;) {
+		map->slots.data[hole].item = 0;
+		shifted = false;
+
+		umem next = hole;
+		for (;;) {
+			next = (next + 1) & mask;
+
+			M_Map_Slot *entry = &map->slots.data[next];
+			if (!entry->item)
+				break;
+
+			umem home = (umem)map->hashes.data[entry->item - 1] & mask;
+			bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+			if (!stays) {
+				map->slots.data[hole] = *entry;
+				hole    = next;
+				shifted = true;
+				break;
+			}
+		}
+	}
+
+	umem last = (umem)map->hashes.count - 1;
+	if (index != last) {
+		map->slots.data[M_MapSlotOf(map, (u32)last + 1)].item = (u32)index + 1;
+		memcpy(item, M_MapItem(map, last), map->item_size);
+		map->hashes.data[index] = map->hashes.data[last];
+	}
+
+	map->items.count  -= map->item_size;
+	map->hashes.count -= 1;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "Memory.h"
+
+//
+// Growable containers on top of M_Arena. The address space for the largest size is
+// reserved up front and pages are committed as the container grows, so elements
+// never move and growing never copies.
+//
+
+// Elements start this far into the arena, past the arena header
+#define M_ARRAY_OFFSET 64
+
+// Declares a typed array, name it with a typedef to pass it around:
+//   typedef M_Array(Token) Token_Array;
+#define M_Array(type) struct { type *data; imem count; M_Arena *arena; }
+
+// Returns the element storage, null when the reservation failed
+void *M_ArrayReserve(M_Arena **arena, umem max_size);
+
+// Commits at least `size` bytes of elements, false past the reservation
+bool  M_ArrayGrow(M_Arena *arena, umem size);
+
+// Gives the pages past `size` bytes of elements back to the system
+void  M_ArrayShrink(M_Arena *arena, umem size);
+
+// The macros below evaluate `array` more than once
+
+#define M_ArrayInit(array, max_count)                                                          \
+	((array)->count = 0,                                                                       \
+	 (array)->data  = M_ArrayReserve(&(array)->arena, sizeof(*(array)->data) * (umem)(max_count)), \
+	 (array)->data != nullptr)
+
+#define M_ArrayFree(array) \
+	(M_ArenaFree((array)->arena), (array)->arena = nullptr, (array)->data = nullptr, (array)->count = 0)
+
+// Pointer to `n` new uninitialized elements at the end, null when the array is full
+#define M_ArrayPushN(array, n)                                                                 \
+	(M_ArrayGrow((array)->arena, sizeof(*(array)->data) * (umem)((array)->count + (n)))        \
+		? ((array)->count += (n), (array)->data + (array)->count - (n))                         \
+		: nullptr)
+
+#define M_ArrayPush(array)  M_ArrayPushN(array, 1)
+#define M_ArrayPop(array)   (&(array)->data[--(array)->count])
+#define M_ArrayLast(array)  (&(array)->data[(array)->count - 1])
+#define M_ArrayClear(array) ((array)->count = 0)
+#define M_ArrayPack(array)  M_ArrayShrink((array)->arena, sizeof(*(array)->data) * (umem)(array)->count)
+
+//
+// Stack for walking trees without recursion. The first `local_count` elements live in the
+// stack itself, so shallow trees never leave the C stack; a deeper walk moves them to an
+// array that reserves `max_count` elements and commits them as it goes.
+//
+
+#define M_Stack(type, local_count) \
+	struct { type *data; imem count; imem capacity; umem max_count; M_Arena *arena; type local[local_count]; }
+
+// Makes room for one more element, false when the stack already holds `max_count` of them or
+// its array could not be reserved
+bool  M_StackGrow(void **data, imem *capacity, M_Arena **arena, umem element_size, umem max_count);
+
+#define M_StackInit(stack, max)                                                                \
+	((stack)->data = (stack)->local, (stack)->count = 0, (stack)->capacity = ArrayCount((stack)->local), \
+	 (stack)->max_count = (max), (stack)->arena = nullptr)
+
+#define M_StackFree(stack) \
+	((stack)->arena ? M_ArenaFree((stack)->arena) : (void)0, (void)((stack)->arena = nullptr))
+
+// Pointer to a new uninitialized element on top, null when the stack is full
+#define M_StackPush(stack)                                                                     \
+	((stack)->count < (stack)->capacity ||                                                     \
+	 M_StackGrow((void **)&(stack)->data, &(stack)->capacity, &(stack)->arena, sizeof(*(stack)->data), (stack)->max_count) \
+		? &(stack)->data[(stack)->count++]                                                     \
+		: nullptr)
+
+#define M_StackPop(stack) (&(stack)->data[--(stack)->count])
+#define M_StackTop(stack) (&(stack)->data[(stack)->count - 1])
+
+//
+//
+//
+
+// Hash map with open addressing. Items live in insertion order in their own array,
+// the probed table only holds item numbers and hash tags, so items keep their address
+// while the table grows. The caller owns hashing and key comparison:
+//
+//   umem  probe = 0;
+//   Item *item;
+//   while ((item = M_MapFind(&map, hash, &probe)))
+//       if (ItemKeyEquals(item, key)) break;
+//   if (!item) item = M_MapInsert(&map, hash, M_CLEAR_MEMORY);
+
+typedef struct M_Map_Slot {
+	u32 item; // index + 1, 0 when the slot is empty
+	u32 tag;  // high half of the hash, compared before touching the item
+} M_Map_Slot;
+
+typedef struct M_Map {
+	M_Array(u8)         items;
+	M_Array(u64)        hashes; // hash of every item, the table is rebuilt from them
+	M_Array(M_Map_Slot) slots;
+	umem                item_size;
+	umem                max_count;
+} M_Map;
+
+bool  M_MapInit(M_Map *map, umem item_size, umem max_count);
+void  M_MapFree(M_Map *map);
+void  M_MapClear(M_Map *map);
+
+// Next item with this hash after `probe`, start with `probe` at 0. Null when there is none.
+void *M_MapFind(M_Map *map, u64 hash, umem *probe);
+
+// Adds an item without looking for an existing one, null when the map is full
+void *M_MapInsert(M_Map *map, u64 hash, u32 flags);
+
+// Moves the last item into the place of the removed one
+void  M_MapRemove(M_Map *map, void *item);
+
+inproc umem M_MapCount(const M_Map *map) {
+	return (umem)map->hashes.count;
+}
+
+inproc void *M_MapItem(M_Map *map, umem index) {
+	return map->items.data + index * map->item_size;
+}
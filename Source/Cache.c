@@ -0,0 +1,609 @@
+#include "Cache.h"
+#include "Hash.h"
+#include "Array.h"
+
+#include <string.h>
+
+static umem CacheExprSize(Expr_Kind kind) {
+	switch (kind) {
+	case Expr_Kind_Literal:         return sizeof(Cache_Expr_Literal);
+	case Expr_Kind_Identifier:      return sizeof(Cache_Expr_Identifier);
+	case Expr_Kind_Unary_Operator:  return sizeof(Cache_Expr_Unary_Operator);
+	case Expr_Kind_Binary_Operator: return sizeof(Cache_Expr_Binary_Operator);
+	case Expr_Kind_Assignment:      return sizeof(Cache_Expr_Assignment);
+	NoDefaultCase();
+	}
+	return 0;
+}
+
+//
+//
+//
+
+u64 CacheKey(String stream) {
+	return HashString(stream);
+}
+
+void CachePath(char *buffer, umem size, const char *dir, u64 key) {
+	snprintf(buffer, size, "%s/%016" PRIx64 ".zc", dir, key);
+}
+
+//
+//
+//
+
+typedef struct Cache_Writer {
+	u8 *       base;
+	umem       node_pos;
+	umem       string_pos;
+	u32        node_count;
+	Source_Loc source_base;
+} Cache_Writer;
+
+// A node still to be written and where its offset goes
+typedef struct Cache_Link {
+	Expr *        expr;
+	Cache_Offset *offset;
+} Cache_Link;
+
+#define CACHE_STACK_LOCAL 64
+#define CACHE_STACK_MAX   (MegaBytes(256) / sizeof(Cache_Link))
+
+// False when the tree is too deep to walk
+static bool CacheMeasure(Expr *root, umem *nodes, umem *strings) {
+	M_Stack(Expr *, CACHE_STACK_LOCAL) stack;
+	M_StackInit(&stack, CACHE_STACK_MAX);
+
+	// Follows the left side and keeps the right one for later
+	for (Expr *expr = root; expr;) {
+		Expr *other = nullptr;
+
+		*nodes += CacheExprSize(expr->kind);
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+			expr = nullptr;
+			break;
+
+		case Expr_Kind_Identifier:
+			*strings += ((Expr_Identifier *)expr)->name.count;
+			expr      = nullptr;
+			break;
+
+		case Expr_Kind_Unary_Operator:
+			expr = ((Expr_Unary_Operator *)expr)->child;
+			break;
+
+		case Expr_Kind_Binary_Operator:
+			other = ((Expr_Binary_Operator *)expr)->right;
+			expr  = ((Expr_Binary_Operator *)expr)->left;
+			break;
+
+		case Expr_Kind_Assignment:
+			other = ((Expr_Assignment *)expr)->right;
+			expr  = ((Expr_Assignment *)expr)->left;
+			break;
+
+		NoDefaultCase();
+		}
+
+		if (other) {
+			Expr **slot = M_StackPush(&stack);
+			if (!slot) {
+				M_StackFree(&stack);
+				return false;
+			}
+			*slot = other;
+		}
+
+		if (!expr && stack.count)
+			expr = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return true;
+}
+
+// Nodes are laid out in pre-order, so a tree walk reads the image front to back. The offset
+// of `root` goes to `offset`, false when the tree is too deep to walk.
+static bool CacheWriteExpr(Cache_Writer *w, Expr *root, Cache_Offset *offset) {
+	M_Stack(Cache_Link, CACHE_STACK_LOCAL) stack;
+	M_StackInit(&stack, CACHE_STACK_MAX);
+
+	// Follows the left side and keeps the right one for later, written once the left is done
+	for (Cache_Link next = { root, offset }; next.expr;) {
+		Expr *       expr  = next.expr;
+		Cache_Expr * node  = (Cache_Expr *)(w->base + w->node_pos);
+		Cache_Link   other = { 0 };
+
+		*next.offset = (Cache_Offset)w->node_pos;
+		next.expr    = nullptr;
+
+		w->node_pos   += CacheExprSize(expr->kind);
+		w->node_count += 1;
+
+		node->kind    = (u8)expr->kind;
+		node->type_id = CACHE_TYPE_NONE;
+		node->from    = expr->range.from - w->source_base;
+		node->length  = expr->range.length;
+
+		if (expr->type) {
+			node->type_id   = (u8)expr->type->id;
+			node->type_size = (u8)expr->type->runtime_size;
+			if (expr->type->id == Expr_Type_Id_INTEGER)
+				node->type_flags = (u8)((Expr_Type_Integer *)expr->type)->flags;
+		}
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+		{
+			Expr_Literal *      src = (Expr_Literal *)expr;
+			Cache_Expr_Literal *dst = (Cache_Expr_Literal *)node;
+			memcpy(&dst->value, &src->value, sizeof(dst->value));
+		} break;
+
+		case Expr_Kind_Identifier:
+		{
+			Expr_Identifier *      src = (Expr_Identifier *)expr;
+			Cache_Expr_Identifier *dst = (Cache_Expr_Identifier *)node;
+			dst->name  = (Cache_Offset)w->string_pos;
+			dst->count = (u32)src->name.count;
+			memcpy(w->base + w->string_pos, src->name.data, src->name.count);
+			w->string_pos += src->name.count;
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+		{
+			Expr_Unary_Operator *      src = (Expr_Unary_Operator *)expr;
+			Cache_Expr_Unary_Operator *dst = (Cache_Expr_Unary_Operator *)node;
+			node->symbol = src->symbol;
+			next         = (Cache_Link){ src->child, &dst->child };
+		} break;
+
+		case Expr_Kind_Binary_Operator:
+		{
+			Expr_Binary_Operator *      src = (Expr_Binary_Operator *)expr;
+			Cache_Expr_Binary_Operator *dst = (Cache_Expr_Binary_Operator *)node;
+			node->symbol = src->symbol;
+			next         = (Cache_Link){ src->left, &dst->left };
+			other        = (Cache_Link){ src->right, &dst->right };
+		} break;
+
+		case Expr_Kind_Assignment:
+		{
+			Expr_Assignment *      src = (Expr_Assignment *)expr;
+			Cache_Expr_Assignment *dst = (Cache_Expr_Assignment *)node;
+			next  = (Cache_Link){ src->left, &dst->left };
+			other = (Cache_Link){ src->right, &dst->right };
+		} break;
+
+		NoDefaultCase();
+		}
+
+		if (other.expr) {
+			Cache_Link *slot = M_StackPush(&stack);
+			if (!slot) {
+				M_StackFree(&stack);
+				return false;
+			}
+			*slot = other;
+		}
+
+		if (!next.expr && stack.count)
+			next = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return true;
+}
+
+bool CacheStore(const char *path, u64 key, umem source_size, Expr *root) {
+	umem nodes = 0, strings = 0;
+	if (!CacheMeasure(root, &nodes, &strings))
+		return false;
+
+	umem size = sizeof(Cache_Header) + nodes + strings;
+	if (size > UINT32_MAX)
+		return false;
+
+	M_Arena *arena = M_ArenaAllocate(sizeof(M_Arena) + size, sizeof(M_Arena) + size);
+	u8 *     base  = arena->reserved ? M_PushSize(arena, size, M_CLEAR_MEMORY) : nullptr;
+
+	if (!base) {
+		M_ArenaFree(arena);
+		return false;
+	}
+
+	Cache_Writer writer = { 0 };
+	writer.base         = base;
+	writer.node_pos     = sizeof(Cache_Header);
+	writer.string_pos   = sizeof(Cache_Header) + nodes;
+
+	Source_File *file = SourceFind(SourceGlobal(), root->range.from);
+	writer.source_base  = file ? file->base : 0;
+
+	Cache_Header *header = (Cache_Header *)base;
+	header->magic        = CACHE_MAGIC;
+	header->version      = CACHE_VERSION;
+	header->source_hash  = key;
+	header->source_size  = source_size;
+	header->image_size   = size;
+
+	if (!CacheWriteExpr(&writer, root, &header->root)) {
+		M_ArenaFree(arena);
+		return false;
+	}
+
+	header->node_count = writer.node_count;
+
+	header->sections[Cache_Section_EXPR]   = (Cache_Section){ sizeof(Cache_Header), (u32)nodes };
+	header->sections[Cache_Section_STRING] = (Cache_Section){ (Cache_Offset)(sizeof(Cache_Header) + nodes), (u32)strings };
+
+	Assert(writer.node_pos == sizeof(Cache_Header) + nodes && writer.string_pos == size);
+
+	bool result = CacheWriteFile(path, base, size);
+
+	M_ArenaFree(arena);
+
+	return result;
+}
+
+static bool CacheSectionValid(const Cache_Image *image, Cache_Section section, umem alignment) {
+	return section.offset >= sizeof(Cache_Header) &&
+		(section.offset & (alignment - 1)) == 0 &&
+		(umem)section.offset + section.size <= image->size;
+}
+
+// Walks the tree in the order CacheWriteExpr laid it out, so every node has to start where the
+// one before it ended: links can not go backwards or share nodes, and the walk ends within the
+// section. Names have to lie in the string section and types be builtin ones.
+static bool CacheValidateNodes(const Cache_Image *image) {
+	const Cache_Header *header  = (const Cache_Header *)image->base;
+	Cache_Section       nodes   = header->sections[Cache_Section_EXPR];
+	Cache_Section       strings = header->sections[Cache_Section_STRING];
+
+	umem pos   = nodes.offset;
+	umem end   = (umem)nodes.offset + nodes.size;
+	u32  count = 0;
+	bool valid = true;
+
+	M_Stack(Cache_Offset, CACHE_STACK_LOCAL) stack;
+	M_StackInit(&stack, CACHE_STACK_MAX);
+
+	for (Cache_Offset offset = header->root; offset && valid;) {
+		const Cache_Expr *node  = CachePointer(image, offset);
+		Cache_Offset      other = 0;
+
+		if (offset != pos || end - pos < sizeof(Cache_Expr) || node->kind >= Expr_Kind_COUNT ||
+			end - pos < CacheExprSize(node->kind)) {
+			valid = false;
+			break;
+		}
+
+		if (node->type_id != CACHE_TYPE_NONE && !ExprBuiltinType(node->type_id, node->type_size, node->type_flags)) {
+			valid = false;
+			break;
+		}
+
+		pos   += CacheExprSize(node->kind);
+		count += 1;
+
+		switch (node->kind) {
+		case Expr_Kind_Literal:
+			offset = 0;
+			break;
+
+		case Expr_Kind_Identifier:
+		{
+			const Cache_Expr_Identifier *name = (const Cache_Expr_Identifier *)node;
+			valid  = name->name >= strings.offset && (umem)name->name + name->count <= (umem)strings.offset + strings.size;
+			offset = 0;
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+			offset = ((const Cache_Expr_Unary_Operator *)node)->child;
+			valid  = offset != 0;
+			break;
+
+		case Expr_Kind_Binary_Operator:
+			offset = ((const Cache_Expr_Binary_Operator *)node)->left;
+			other  = ((const Cache_Expr_Binary_Operator *)node)->right;
+			valid  = offset && other;
+			break;
+
+		case Expr_Kind_Assignment:
+			offset = ((const Cache_Expr_Assignment *)node)->left;
+			other  = ((const Cache_Expr_Assignment *)node)->right;
+			valid  = offset && other;
+			break;
+
+		NoDefaultCase();
+		}
+
+		if (other && valid) {
+			Cache_Offset *slot = M_StackPush(&stack);
+			valid = slot != nullptr;
+			if (slot)
+				*slot = other;
+		}
+
+		if (!offset && stack.count)
+			offset = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return valid && pos == end && count == header->node_count;
+}
+
+static bool CacheValidate(const Cache_Image *image, u64 key, umem source_size) {
+	if (image->size < sizeof(Cache_Header))
+		return false;
+
+	const Cache_Header * header   = (const Cache_Header *)image->base;
+	const Cache_Section *sections = header->sections;
+
+	if (header->magic != CACHE_MAGIC ||
+		header->version != CACHE_VERSION ||
+		header->source_hash != key ||
+		header->source_size != source_size ||
+		header->image_size != image->size)
+		return false;
+
+	if (!CacheSectionValid(image, sections[Cache_Section_EXPR], _Alignof(Cache_Expr_Literal)) ||
+		!CacheSectionValid(image, sections[Cache_Section_STRING], 1) ||
+		header->root != sections[Cache_Section_EXPR].offset)
+		return false;
+
+	return CacheValidateNodes(image);
+}
+
+//
+//
+//
+
+static void CacheTypeDump(Dump_Buffer *out, const Cache_Expr *node) {
+	switch (node->type_id) {
+	case Expr_Type_Id_INTEGER:
+		if (node->type_flags & EXPR_TYPE_INTEGER_IS_BOOL) {
+			DumpText(out, "bool");
+		} else {
+			DumpChar(out, (node->type_flags & EXPR_TYPE_INTEGER_IS_SIGNED) ? 's' : 'u');
+			DumpUnsigned(out, node->type_size << 3);
+		}
+		break;
+	case Expr_Type_Id_FLOAT:
+		DumpChar(out, 'r');
+		DumpUnsigned(out, node->type_size << 3);
+		break;
+	}
+}
+
+void CacheDump(Dump_Buffer *out, const Cache_Image *image, Cache_Offset offset) {
+	static const char *ExprKindNames[] = {
+		"Literal", "Identifier", "Unary Operator", "Binary Operator", "Assignment"
+	};
+
+	DumpPushFrame(out, CachePointer(image, offset), 0);
+
+	Dump_Frame frame;
+	while (DumpPopFrame(out, &frame)) {
+		const Cache_Expr *node = frame.node;
+
+		DumpIndent(out, frame.depth);
+		DumpChar(out, '.');
+		DumpText(out, ExprKindNames[node->kind]);
+
+		switch (node->kind) {
+		case Expr_Kind_Literal:
+		{
+			const Cache_Expr_Literal *expr = (const Cache_Expr_Literal *)node;
+			DumpChar(out, '(');
+			if (node->type_id == Expr_Type_Id_FLOAT)
+				DumpFloat(out, expr->value.floating);
+			else
+				DumpUnsigned(out, expr->value.integer);
+			DumpText(out, ") ");
+		} break;
+
+		case Expr_Kind_Identifier:
+		{
+			const Cache_Expr_Identifier *expr = (const Cache_Expr_Identifier *)node;
+			DumpChar(out, '(');
+			DumpString(out, CacheString(image, expr->name, expr->count));
+			DumpText(out, ") ");
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+		{
+			const Cache_Expr_Unary_Operator *expr = (const Cache_Expr_Unary_Operator *)node;
+			DumpChar(out, '(');
+			DumpText(out, ExprSymbolName(node->symbol));
+			DumpText(out, ") ");
+			DumpPushFrame(out, CachePointer(image, expr->child), frame.depth + 1);
+		} break;
+
+		case Expr_Kind_Binary_Operator:
+		{
+			const Cache_Expr_Binary_Operator *expr = (const Cache_Expr_Binary_Operator *)node;
+			DumpChar(out, '(');
+			DumpText(out, ExprSymbolName(node->symbol));
+			DumpText(out, ") ");
+			DumpPushFrame(out, CachePointer(image, expr->right), frame.depth + 1);
+			DumpPushFrame(out, CachePointer(image, expr->left), frame.depth + 1);
+		} break;
+
+		case Expr_Kind_Assignment:
+		{
+			const Cache_Expr_Assignment *expr = (const Cache_Expr_Assignment *)node;
+			DumpText(out, "(=)");
+			DumpPushFrame(out, CachePointer(image, expr->right), frame.depth + 1);
+			DumpPushFrame(out, CachePointer(image, expr->left), frame.depth + 1);
+		} break;
+		}
+
+		CacheTypeDump(out, node);
+		DumpChar(out, '\n');
+	}
+}
+
+bool CacheParse(Cache_Image *image, const char *dir, String stream, String source, M_Pool *pool) {
+	char path[1024];
+
+	u64 key = CacheKey(stream);
+	CachePath(path, sizeof(path), dir, key);
+
+	if (CacheOpen(image, path, key, stream.count))
+		return true;
+
+	Expr *root = Parse(stream, source, pool);
+	if (!root || !CacheStore(path, key, stream.count, root))
+		return false;
+
+	return CacheOpen(image, path, key, stream.count);
+}
+
+//
+//
+//
+
+#if PLATFORM_WINDOWS == 1
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#pragma warning(pop)
+
+bool CacheWriteFile(const char *path, const u8 *data, umem size) {
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.%lu.tmp", path, GetCurrentProcessId());
+
+	HANDLE file = CreateFileA(temp, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	BOOL  result  = WriteFile(file, data, (DWORD)size, &written, nullptr) && written == size;
+	CloseHandle(file);
+
+	// Readers only ever see complete images
+	if (result)
+		result = MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING);
+	if (!result)
+		DeleteFileA(temp);
+
+	return result;
+}
+
+bool CacheOpen(Cache_Image *image, const char *path, u64 key, umem source_size) {
+	memset(image, 0, sizeof(*image));
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (umem)size.QuadPart < sizeof(Cache_Header)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+
+	if (!mapping)
+		return false;
+
+	image->base   = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	image->size   = (umem)size.QuadPart;
+	image->handle = mapping;
+
+	if (!image->base || !CacheValidate(image, key, source_size)) {
+		CacheClose(image);
+		return false;
+	}
+
+	return true;
+}
+
+void CacheClose(Cache_Image *image) {
+	if (image->base)
+		UnmapViewOfFile(image->base);
+	if (image->handle)
+		CloseHandle(image->handle);
+	memset(image, 0, sizeof(*image));
+}
+
+#endif
+
+#if PLATFORM_LINUX == 1 || PLATFORM_MAC == 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool CacheWriteFile(const char *path, const u8 *data, umem size) {
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+
+	int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	bool result = true;
+	for (umem written = 0; written < size; ) {
+		ssize_t count = write(fd, data + written, size - written);
+		if (count <= 0) {
+			result = false;
+			break;
+		}
+		written += count;
+	}
+	close(fd);
+
+	// Readers only ever see complete images
+	if (result)
+		result = rename(temp, path) == 0;
+	if (!result)
+		unlink(temp);
+
+	return result;
+}
+
+bool CacheOpen(Cache_Image *image, const char *path, u64 key, umem source_size) {
+	memset(image, 0, sizeof(*image));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Cache_Header)) {
+		close(fd);
+		return false;
+	}
+
+	void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+		return false;
+
+	image->base = base;
+	image->size = st.st_size;
+
+	if (!CacheValidate(image, key, source_size)) {
+		CacheClose(image);
+		return false;
+	}
+
+	return true;
+}
+
+void CacheClose(Cache_Image *image) {
+	if (image->base)
+		munmap(image->base, image->size);
+	memset(image, 0, sizeof(*image));
+}
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+#include "Parser.h"
+
+//
+// Position independent image of a parsed tree. All links are offsets from the
+// start of the image, so a mapped cache file is used in place without fixups.
+//
+
+#define CACHE_MAGIC     0x4341435a // "ZCAC"
+#define CACHE_VERSION   3
+#define CACHE_TYPE_NONE 0xff
+
+typedef u32 Cache_Offset; // 0 is null
+
+typedef enum Cache_Section_Kind {
+	Cache_Section_EXPR,
+	Cache_Section_STRING,
+
+	Cache_Section_COUNT
+} Cache_Section_Kind;
+
+typedef struct Cache_Section {
+	Cache_Offset offset;
+	u32          size;
+} Cache_Section;
+
+typedef struct Cache_Header {
+	u32           magic;
+	u32           version;
+	u64           source_hash;
+	u64           source_size;
+	u64           image_size;
+	Cache_Offset  root;
+	u32           node_count;
+	Cache_Section sections[Cache_Section_COUNT];
+} Cache_Header;
+
+typedef struct Cache_Expr {
+	u8  kind;
+	u8  type_id;
+	u8  type_size;
+	u8  type_flags;
+	u32 symbol;
+	u32 from;   // relative to the start of the source, global locations differ between runs
+	u32 length;
+} Cache_Expr;
+
+typedef struct Cache_Expr_Literal {
+	Cache_Expr base;
+	union {
+		u64    integer;
+		r64    floating;
+	} value;
+} Cache_Expr_Literal;
+
+typedef struct Cache_Expr_Identifier {
+	Cache_Expr   base;
+	Cache_Offset name;
+	u32          count;
+} Cache_Expr_Identifier;
+
+typedef struct Cache_Expr_Unary_Operator {
+	Cache_Expr   base;
+	Cache_Offset child;
+	u32          reserved;
+} Cache_Expr_Unary_Operator;
+
+typedef struct Cache_Expr_Binary_Operator {
+	Cache_Expr   base;
+	Cache_Offset left;
+	Cache_Offset right;
+} Cache_Expr_Binary_Operator;
+
+typedef struct Cache_Expr_Assignment {
+	Cache_Expr   base;
+	Cache_Offset left;
+	Cache_Offset right;
+} Cache_Expr_Assignment;
+
+typedef struct Cache_Image {
+	u8 * base;
+	umem size;
+	void *handle;
+} Cache_Image;
+
+inproc const void *CachePointer(const Cache_Image *image, Cache_Offset offset) {
+	return offset ? image->base + offset : nullptr;
+}
+
+#define CacheGet(image, type, offset) ((const Cache_Expr_##type *)CachePointer(image, offset))
+
+inproc String CacheString(const Cache_Image *image, Cache_Offset offset, u32 count) {
+	return (String){ .count = count, .data = image->base + offset };
+}
+
+inproc Cache_Offset CacheRoot(const Cache_Image *image) {
+	return ((const Cache_Header *)image->base)->root;
+}
+
+u64   CacheKey(String stream);
+void  CachePath(char *buffer, umem size, const char *dir, u64 key);
+
+// Written to a temporary file next to `path` and renamed over it, readers only ever see complete files
+bool  CacheWriteFile(const char *path, const u8 *data, umem size);
+
+bool  CacheStore(const char *path, u64 key, umem source_size, Expr *root);
+// False unless the image was stored for `key` and its sections and every node check out, a
+// damaged file is never walked
+bool  CacheOpen(Cache_Image *image, const char *path, u64 key, umem source_size);
+void  CacheClose(Cache_Image *image);
+void  CacheDump(Dump_Buffer *out, const Cache_Image *image, Cache_Offset offset);
+
+// Maps the cached tree of `stream` from `dir`, on a miss the stream is parsed and stored first
+bool  CacheParse(Cache_Image *image, const char *dir, String stream, String source, M_Pool *pool);
@@ -0,0 +1,305 @@
+#include "Diagnostic.h"
+#include "Hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *DiagKindNames[] = { "info", "warning", "error", "fatal" };
+static_assert(ArrayCount(DiagKindNames) == Diag_Kind_COUNT, "");
+
+// Text output has always shown fatal errors as plain errors
+static const char *DiagKindTextNames[] = { "info", "warning", "error", "error" };
+static_assert(ArrayCount(DiagKindTextNames) == Diag_Kind_COUNT, "");
+
+#define DIAG_BUFFER_SIZE MegaBytes(64)
+#define DIAG_SEEN_MIN    1024
+
+// Batches of the default sink, small enough for diagnostics to show up while a run goes on
+#define DIAG_DEFAULT_FLUSH KiloBytes(16)
+
+void DiagInit(Diag_Sink *sink, Diag_Format format, FILE *out, FILE *err, umem flush_size) {
+	memset(sink, 0, sizeof(*sink));
+
+	sink->format     = format;
+	sink->flush_size = Min(flush_size, DIAG_BUFFER_SIZE / 2);
+
+	sink->streams[0].file   = out;
+	sink->streams[0].buffer = M_ArenaAllocate(DIAG_BUFFER_SIZE, 0);
+
+	u32 problems = 0;
+	if (err != out) {
+		sink->streams[1].file   = err;
+		sink->streams[1].buffer = M_ArenaAllocate(DIAG_BUFFER_SIZE, 0);
+		problems = 1;
+	}
+
+	sink->stream_of[Diag_Kind_INFO]    = 0;
+	sink->stream_of[Diag_Kind_WARNING] = problems;
+	sink->stream_of[Diag_Kind_ERROR]   = problems;
+	sink->stream_of[Diag_Kind_FATAL]   = problems;
+
+	MutexInit(&sink->lock);
+}
+
+void DiagFree(Diag_Sink *sink) {
+	DiagFlush(sink);
+
+	for (int index = 0; index < ArrayCount(sink->streams); ++index) {
+		if (sink->streams[index].buffer)
+			M_ArenaFree(sink->streams[index].buffer);
+	}
+
+	if (sink->seen_arena)
+		M_ArenaFree(sink->seen_arena);
+
+	MutexFree(&sink->lock);
+	memset(sink, 0, sizeof(*sink));
+}
+
+void DiagLimit(Diag_Sink *sink, Diag_Kind kind, u32 limit) {
+	MutexLock(&sink->lock);
+	sink->limit[kind] = limit;
+	MutexUnlock(&sink->lock);
+}
+
+//
+//
+//
+
+static void DiagWrite(Diag_Stream *stream) {
+	M_Arena *buffer = stream->buffer;
+	umem     size   = buffer->position - sizeof(M_Arena);
+
+	if (size) {
+		fwrite((u8 *)buffer + sizeof(M_Arena), 1, size, stream->file);
+		fflush(stream->file);
+		M_ArenaReset(buffer);
+	}
+}
+
+static void DiagAppend(Diag_Stream *stream, const void *data, umem size) {
+	if (stream->buffer->position + size > stream->buffer->reserved)
+		DiagWrite(stream);
+
+	u8 *dst = M_PushSize(stream->buffer, size, 0);
+	if (dst) {
+		memcpy(dst, data, size);
+	} else {
+		// Only a message larger than the whole buffer gets here
+		fwrite(data, 1, size, stream->file);
+	}
+}
+
+static void DiagAppendString(Diag_Stream *stream, const char *str) {
+	DiagAppend(stream, str, strlen(str));
+}
+
+static void DiagAppendJson(Diag_Stream *stream, String str) {
+	static const char Hex[] = "0123456789abcdef";
+
+	u8 * data  = str.data;
+	imem begin = 0;
+
+	for (imem index = 0; index < str.count; ++index) {
+		u8 byte = data[index];
+		if (byte >= 0x20 && byte != '"' && byte != '\\')
+			continue;
+
+		DiagAppend(stream, data + begin, index - begin);
+		begin = index + 1;
+
+		char escape[8] = { '\\', (char)byte };
+		umem size      = 2;
+
+		switch (byte) {
+		case '"':  break;
+		case '\\': break;
+		case '\n': escape[1] = 'n'; break;
+		case '\r': escape[1] = 'r'; break;
+		case '\t': escape[1] = 't'; break;
+		default:
+			memcpy(escape, "\\u00", 4);
+			escape[4] = Hex[byte >> 4];
+			escape[5] = Hex[byte & 15];
+			size = 6;
+			break;
+		}
+
+		DiagAppend(stream, escape, size);
+	}
+
+	DiagAppend(stream, data + begin, str.count - begin);
+}
+
+static void DiagFormat(Diag_Sink *sink, Diag_Stream *stream, const Diag *diag) {
+	char number[128];
+
+	if (sink->format == Diag_Format_TEXT) {
+		DiagAppend(stream, diag->source.data, diag->source.count);
+		snprintf(number, sizeof(number), "(%zu,%zu): %s: ", (size_t)diag->row, (size_t)diag->column, DiagKindTextNames[diag->kind]);
+		DiagAppendString(stream, number);
+		DiagAppend(stream, diag->message.data, diag->message.count);
+		DiagAppendString(stream, "\n");
+		return;
+	}
+
+	DiagAppendString(stream, "{\"kind\":\"");
+	DiagAppendString(stream, DiagKindNames[diag->kind]);
+	DiagAppendString(stream, "\",\"source\":\"");
+	DiagAppendJson(stream, diag->source);
+	snprintf(number, sizeof(number), "\",\"row\":%zu,\"column\":%zu,\"from\":%zu,\"to\":%zu,\"message\":\"",
+		(size_t)diag->row, (size_t)diag->column, (size_t)diag->from, (size_t)diag->to);
+	DiagAppendString(stream, number);
+	DiagAppendJson(stream, diag->message);
+	DiagAppendString(stream, "\"}\n");
+}
+
+// Returns false when the hash was already present
+static bool DiagRemember(Diag_Sink *sink, u64 hash) {
+	if (!hash) hash = 1; // zero marks an empty slot
+
+	if ((sink->seen_count + 1) * 2 > sink->seen_mask + 1 || !sink->seen) {
+		u32      count = sink->seen ? (sink->seen_mask + 1) * 2 : DIAG_SEEN_MIN;
+		umem     size  = sizeof(u64) * count;
+		M_Arena *arena = M_ArenaAllocate(size + sizeof(M_Arena), size + sizeof(M_Arena));
+		u64 *    table = M_PushSize(arena, size, M_CLEAR_MEMORY);
+
+		// Without room to grow everything counts as new
+		if (!table) {
+			M_ArenaFree(arena);
+			if (!sink->seen) return true;
+		} else {
+			for (u32 index = 0; sink->seen && index <= sink->seen_mask; ++index) {
+				u64 old = sink->seen[index];
+				if (!old) continue;
+				u32 pos = (u32)old & (count - 1);
+				while (table[pos]) pos = (pos + 1) & (count - 1);
+				table[pos] = old;
+			}
+
+			if (sink->seen_arena)
+				M_ArenaFree(sink->seen_arena);
+
+			sink->seen_arena = arena;
+			sink->seen       = table;
+			sink->seen_mask  = count - 1;
+		}
+	}
+
+	for (u32 pos = (u32)hash & sink->seen_mask;; pos = (pos + 1) & sink->seen_mask) {
+		if (sink->seen[pos] == hash)
+			return false;
+
+		if (!sink->seen[pos]) {
+			sink->seen[pos]   = hash;
+			sink->seen_count += 1;
+			return true;
+		}
+	}
+}
+
+void DiagReport(Diag_Sink *sink, const Diag *diag) {
+	u64 hash = HashBytes(diag->message.data, diag->message.count, diag->kind);
+	hash = HashBytes(diag->source.data, diag->source.count, hash);
+	hash = HashBytes(&diag->from, sizeof(diag->from), hash);
+	hash = HashBytes(&diag->to, sizeof(diag->to), hash);
+
+	MutexLock(&sink->lock);
+
+	if (!DiagRemember(sink, hash)) {
+		sink->duplicates += 1;
+	} else if (sink->limit[diag->kind] && sink->reported[diag->kind] >= sink->limit[diag->kind] && diag->kind != Diag_Kind_FATAL) {
+		sink->suppressed[diag->kind] += 1;
+	} else {
+		Diag_Stream *stream = &sink->streams[sink->stream_of[diag->kind]];
+
+		sink->reported[diag->kind] += 1;
+		DiagFormat(sink, stream, diag);
+
+		if (stream->buffer->position - sizeof(M_Arena) >= sink->flush_size)
+			DiagWrite(stream);
+	}
+
+	MutexUnlock(&sink->lock);
+}
+
+void DiagFlush(Diag_Sink *sink) {
+	MutexLock(&sink->lock);
+	for (int index = 0; index < ArrayCount(sink->streams); ++index) {
+		if (sink->streams[index].file)
+			DiagWrite(&sink->streams[index]);
+	}
+	MutexUnlock(&sink->lock);
+}
+
+void DiagFinish(Diag_Sink *sink) {
+	MutexLock(&sink->lock);
+
+	Diag_Stream *stream = &sink->streams[sink->stream_of[Diag_Kind_ERROR]];
+	char         line[256];
+
+	if (sink->format == Diag_Format_TEXT) {
+		for (int kind = 0; kind < Diag_Kind_COUNT; ++kind) {
+			if (sink->suppressed[kind]) {
+				snprintf(line, sizeof(line), "%u more %s diagnostics not shown\n", sink->suppressed[kind], DiagKindNames[kind]);
+				DiagAppendString(stream, line);
+			}
+		}
+
+		if (sink->duplicates) {
+			snprintf(line, sizeof(line), "%u repeated diagnostics not shown\n", sink->duplicates);
+			DiagAppendString(stream, line);
+		}
+	} else {
+		DiagAppendString(stream, "{\"kind\":\"summary\"");
+		for (int kind = 0; kind < Diag_Kind_COUNT; ++kind) {
+			snprintf(line, sizeof(line), ",\"%s\":%u", DiagKindNames[kind], sink->reported[kind] + sink->suppressed[kind]);
+			DiagAppendString(stream, line);
+		}
+		DiagAppendString(stream, ",\"suppressed\":{");
+		for (int kind = 0; kind < Diag_Kind_COUNT; ++kind) {
+			snprintf(line, sizeof(line), "%s\"%s\":%u", kind ? "," : "", DiagKindNames[kind], sink->suppressed[kind]);
+			DiagAppendString(stream, line);
+		}
+		snprintf(line, sizeof(line), "},\"duplicates\":%u}\n", sink->duplicates);
+		DiagAppendString(stream, line);
+	}
+
+	MutexUnlock(&sink->lock);
+
+	DiagFlush(sink);
+}
+
+//
+//
+//
+
+static Diag_Sink DefaultSink;
+static u32       DefaultState; // 0 not set up, 1 being set up, 2 ready
+
+static void DiagFlushDefault(void) {
+	DiagFlush(&DefaultSink);
+}
+
+bool DiagInitDefault(Diag_Format format, FILE *out, FILE *err, umem flush_size) {
+	if (AtomicCompareExchange32(&DefaultState, 0, 1) != 0)
+		return false;
+
+	DiagInit(&DefaultSink, format, out, err, flush_size);
+	atexit(DiagFlushDefault);
+	AtomicCompareExchange32(&DefaultState, 1, 2);
+	return true;
+}
+
+Diag_Sink *DiagDefault(void) {
+	if (AtomicLoad32(&DefaultState) == 2)
+		return &DefaultSink;
+
+	DiagInitDefault(Diag_Format_TEXT, stdout, stderr, DIAG_DEFAULT_FLUSH);
+
+	while (AtomicLoad32(&DefaultState) != 2) {
+		// another thread is setting it up
+	}
+
+	return &DefaultSink;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "Memory.h"
+#include "Thread.h"
+
+#include <stdio.h>
+
+typedef enum Diag_Kind {
+	Diag_Kind_INFO,
+	Diag_Kind_WARNING,
+	Diag_Kind_ERROR,
+	Diag_Kind_FATAL,
+
+	Diag_Kind_COUNT
+} Diag_Kind;
+
+typedef enum Diag_Format {
+	Diag_Format_TEXT, // source(row,column): kind: message
+	Diag_Format_JSON, // one object per line
+} Diag_Format;
+
+typedef struct Diag {
+	Diag_Kind kind;
+	String    source;
+	umem      row;
+	umem      column;
+	umem      from;
+	umem      to;
+	String    message;
+} Diag;
+
+// Longer messages are truncated
+#define DIAG_MESSAGE_MAX 2048
+
+typedef struct Diag_Stream {
+	FILE *   file;
+	M_Arena *buffer;
+} Diag_Stream;
+
+// Collects formatted diagnostics in memory and writes them out in batches. Repeats of a
+// diagnostic already reported are dropped, and each kind can be capped, both are counted
+// and summed up by DiagFinish. All functions may be called from any thread.
+typedef struct Diag_Sink {
+	Diag_Format format;
+	Diag_Stream streams[2];              // info, everything else, both may share one file
+	u32         stream_of[Diag_Kind_COUNT];
+	umem        flush_size;              // buffered bytes that trigger a write, 0 writes every diagnostic
+
+	u32         limit[Diag_Kind_COUNT];  // 0 for no limit
+	u32         reported[Diag_Kind_COUNT];
+	u32         suppressed[Diag_Kind_COUNT];
+	u32         duplicates;
+
+	M_Arena *   seen_arena;              // hashes of reported diagnostics, open addressing
+	u64 *       seen;
+	u32         seen_count;
+	u32         seen_mask;
+
+	Mutex       lock;
+} Diag_Sink;
+
+void       DiagInit(Diag_Sink *sink, Diag_Format format, FILE *out, FILE *err, umem flush_size);
+void       DiagFree(Diag_Sink *sink);
+void       DiagLimit(Diag_Sink *sink, Diag_Kind kind, u32 limit);
+
+void       DiagReport(Diag_Sink *sink, const Diag *diag);
+void       DiagFlush(Diag_Sink *sink);
+void       DiagFinish(Diag_Sink *sink); // writes the summary and flushes
+
+// Text to stdout and stderr unless DiagInitDefault came first. Written in batches, whatever
+// is left goes out at exit.
+Diag_Sink *DiagDefault(void);
+
+// Sets up the sink DiagDefault returns the way DiagInit does, false when it is already in
+// use. Call it before anything is reported.
+bool       DiagInitDefault(Diag_Format format, FILE *out, FILE *err, umem flush_size);
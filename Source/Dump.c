@@ -0,0 +1,158 @@
+#include "Dump.h"
+
+#define DUMP_STACK_MAX (MegaBytes(256) / sizeof(Dump_Frame))
+
+void DumpInit(Dump_Buffer *out, FILE *file) {
+	memset(out, 0, sizeof(*out));
+	out->file  = file;
+	out->arena = M_ArenaAllocate(DUMP_MAX_SIZE, DUMP_FLUSH_SIZE);
+
+	if (!out->arena->reserved) {
+		out->failed = true;
+		return;
+	}
+
+	out->start  = (u8 *)out->arena + sizeof(M_Arena);
+	out->cursor = out->start;
+	out->end    = (u8 *)out->arena + out->arena->committed;
+}
+
+void DumpInitFixed(Dump_Buffer *out, FILE *file, void *memory, umem size) {
+	memset(out, 0, sizeof(*out));
+	out->file   = file;
+	out->start  = memory;
+	out->cursor = out->start;
+	out->end    = out->start + size;
+}
+
+void DumpFree(Dump_Buffer *out) {
+	DumpFlush(out);
+
+	if (out->arena)
+		M_ArenaFree(out->arena);
+	if (out->spill.arena)
+		M_ArrayFree(&out->spill);
+
+	out->arena = nullptr;
+	out->start = out->cursor = out->end = nullptr;
+}
+
+void DumpFlush(Dump_Buffer *out) {
+	if (out->file && out->cursor != out->start) {
+		fwrite(out->start, 1, out->cursor - out->start, out->file);
+		out->cursor = out->start;
+	}
+}
+
+String DumpContents(Dump_Buffer *out) {
+	return (String){ out->cursor - out->start, out->start };
+}
+
+void DumpWrite(Dump_Buffer *out, const void *data, umem size) {
+	if ((umem)(out->end - out->cursor) < size)
+		DumpFlush(out);
+
+	// Without a file the arena doubles, with one it only grows for a single large write
+	if ((umem)(out->end - out->cursor) < size && out->arena && out->arena->reserved) {
+		M_Arena *arena = out->arena;
+		umem     need  = (out->cursor - (u8 *)arena) + size;
+		umem     want  = Clamp(need, arena->reserved, arena->committed * 2);
+
+		if (M_EnsureCommit(arena, want) || M_EnsureCommit(arena, need))
+			out->end = (u8 *)arena + arena->committed;
+	}
+
+	if ((umem)(out->end - out->cursor) >= size) {
+		memcpy(out->cursor, data, size);
+		out->cursor += size;
+	} else if (out->file) {
+		fwrite(data, 1, size, out->file);
+	} else {
+		out->failed = true;
+	}
+}
+
+void DumpText(Dump_Buffer *out, const char *text) {
+	DumpBytes(out, text, strlen(text));
+}
+
+void DumpIndent(Dump_Buffer *out, umem depth) {
+	static const char Spaces[] = "                                ";
+
+	for (umem count = depth * 4; count;) {
+		umem length = Min(count, sizeof(Spaces) - 1);
+		DumpBytes(out, Spaces, length);
+		count -= length;
+	}
+}
+
+void DumpUnsigned(Dump_Buffer *out, u64 value) {
+	char  digits[20];
+	char *first = digits + sizeof(digits);
+
+	do {
+		*--first = (char)('0' + value % 10);
+		value   /= 10;
+	} while (value);
+
+	DumpBytes(out, first, digits + sizeof(digits) - first);
+}
+
+void DumpFloat(Dump_Buffer *out, r64 value) {
+	char text[32];
+	int  length = snprintf(text, sizeof(text), "%.17g", value);
+	DumpBytes(out, text, (umem)Clamp(0, (int)sizeof(text) - 1, length));
+}
+
+void DumpVarint(Dump_Buffer *out, u64 value) {
+	u8   bytes[10];
+	umem count = 0;
+
+	while (value >= 0x80) {
+		bytes[count++] = (u8)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[count++] = (u8)value;
+
+	DumpBytes(out, bytes, count);
+}
+
+void DumpFixed64(Dump_Buffer *out, u64 value) {
+	u8 bytes[8];
+	for (int index = 0; index < 8; ++index)
+		bytes[index] = (u8)(value >> (index * 8));
+	DumpBytes(out, bytes, sizeof(bytes));
+}
+
+void DumpPushFrame(Dump_Buffer *out, const void *node, umem depth) {
+	Dump_Frame frame = { node, depth };
+
+	if (out->depth < DUMP_STACK_LOCAL) {
+		out->local[out->depth++] = frame;
+		return;
+	}
+
+	if (!out->spill.arena && !M_ArrayInit(&out->spill, DUMP_STACK_MAX)) {
+		out->spill.arena = nullptr;
+		out->failed      = true;
+		return;
+	}
+
+	Dump_Frame *slot = M_ArrayPush(&out->spill);
+	if (!slot) {
+		out->failed = true;
+		return;
+	}
+
+	*slot       = frame;
+	out->depth += 1;
+}
+
+bool DumpPopFrame(Dump_Buffer *out, Dump_Frame *frame) {
+	if (!out->depth)
+		return false;
+
+	out->depth -= 1;
+	*frame = out->depth < DUMP_STACK_LOCAL ? out->local[out->depth] : *M_ArrayPop(&out->spill);
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "Array.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Output buffer for the token and tree dumpers. Bytes collect in memory and go to `file` in
+// one fwrite once the buffer is full or flushed. Without a file nothing is written, the dump
+// stays in memory for golden tests to compare against. Integers and strings are formatted
+// by hand, floats go through snprintf to keep the %.17g text golden files already have.
+//
+// The buffer either lives on its own arena, which grows up to DUMP_MAX_SIZE, or in memory
+// the caller gives, which is how short debug dumps avoid reserving anything.
+
+#ifndef DUMP_MAX_SIZE
+#define DUMP_MAX_SIZE MegaBytes(1024)
+#endif
+
+// Initial size of the arena, and how much of it is written at once when there is a file
+#define DUMP_FLUSH_SIZE KiloBytes(64)
+
+// Frames of the work stack that fit in the buffer itself, deeper trees spill to an array
+#define DUMP_STACK_LOCAL 64
+
+typedef struct Dump_Frame {
+	const void *node;
+	umem        depth;
+} Dump_Frame;
+
+typedef struct Dump_Buffer {
+	u8 *        start;
+	u8 *        cursor;
+	u8 *        end;
+	M_Arena *   arena; // null for memory given by the caller
+	FILE *      file;
+	bool        failed; // ran out of memory, the dump is cut short
+
+	// Work stack of the non-recursive dumpers
+	Dump_Frame  local[DUMP_STACK_LOCAL];
+	imem        depth;
+	M_Array(Dump_Frame) spill;
+} Dump_Buffer;
+
+void   DumpInit(Dump_Buffer *out, FILE *file);
+void   DumpInitFixed(Dump_Buffer *out, FILE *file, void *memory, umem size);
+void   DumpFree(Dump_Buffer *out); // flushes first
+void   DumpFlush(Dump_Buffer *out);
+
+// Everything not written to the file yet, all of the dump when there is none
+String DumpContents(Dump_Buffer *out);
+
+// Slow path of DumpBytes, for when the bytes do not fit what is left of the buffer
+void   DumpWrite(Dump_Buffer *out, const void *data, umem size);
+
+inproc void DumpBytes(Dump_Buffer *out, const void *data, umem size) {
+	if ((umem)(out->end - out->cursor) < size) {
+		DumpWrite(out, data, size);
+		return;
+	}
+	memcpy(out->cursor, data, size);
+	out->cursor += size;
+}
+
+inproc void DumpChar(Dump_Buffer *out, char c) {
+	if (out->cursor == out->end) {
+		DumpWrite(out, &c, 1);
+		return;
+	}
+	*out->cursor++ = (u8)c;
+}
+
+inproc void DumpString(Dump_Buffer *out, String str) {
+	DumpBytes(out, str.data, (umem)str.count);
+}
+
+void   DumpText(Dump_Buffer *out, const char *text);
+void   DumpIndent(Dump_Buffer *out, umem depth); // four spaces per level
+void   DumpUnsigned(Dump_Buffer *out, u64 value);
+void   DumpFloat(Dump_Buffer *out, r64 value);
+
+// Binary forms: LEB128 for counts and small numbers, 8 little endian bytes for values
+void   DumpVarint(Dump_Buffer *out, u64 value);
+void   DumpFixed64(Dump_Buffer *out, u64 value);
+
+void   DumpPushFrame(Dump_Buffer *out, const void *node, umem depth);
+bool   DumpPopFrame(Dump_Buffer *out, Dump_Frame *frame);
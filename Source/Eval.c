@@ -0,0 +1,664 @@
+#include "Eval.h"
+#include "Hash.h"
+#include "Array.h"
+
+#include <string.h>
+
+#if COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+static Value ValueInteger(u64 integer) {
+	Value value   = { Value_Kind_INTEGER };
+	value.integer = integer;
+	return value;
+}
+
+static Value ValueFloat(r64 floating) {
+	Value value    = { Value_Kind_FLOAT };
+	value.floating = floating;
+	return value;
+}
+
+static r64 ValueToFloat(Value value) {
+	return value.kind == Value_Kind_FLOAT ? value.floating : (r64)value.integer;
+}
+
+//
+//
+//
+
+// A tree walk that waits for the children of `expr`, a binary operator keeps the type of its
+// left side until the right one is there
+typedef struct Frame_Walk {
+	Expr *     expr;
+	Expr_Type *left;
+	bool       has_left;
+} Frame_Walk;
+
+#define FRAME_STACK_LOCAL 64
+#define FRAME_STACK_MAX   (MegaBytes(256) / sizeof(Frame_Walk))
+
+typedef struct Frame_Resolver {
+	Frame_Layout *layout;
+	Parser *      parser;
+	u32 *         table; // slot + 1, 0 is empty
+	u64 *         hashes;
+	u32           mask;
+	bool          changed;
+	bool          valid;
+
+	M_Stack(Frame_Walk, FRAME_STACK_LOCAL) stack;
+} Frame_Resolver;
+
+// Adds the names in a tree to `count`, false when the tree is too deep to walk
+static bool FrameCountNames(Expr *root, u32 *count) {
+	M_Stack(Expr *, FRAME_STACK_LOCAL) stack;
+	M_StackInit(&stack, FRAME_STACK_MAX);
+
+	// Follows the left side and keeps the right one for later
+	for (Expr *expr = root; expr;) {
+		Expr *other = nullptr;
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+			expr = nullptr;
+			break;
+
+		case Expr_Kind_Identifier:
+			*count += 1;
+			expr    = nullptr;
+			break;
+
+		case Expr_Kind_Unary_Operator:
+			expr = ((Expr_Unary_Operator *)expr)->child;
+			break;
+
+		case Expr_Kind_Binary_Operator:
+			other = ((Expr_Binary_Operator *)expr)->right;
+			expr  = ((Expr_Binary_Operator *)expr)->left;
+			break;
+
+		case Expr_Kind_Assignment:
+			other = ((Expr_Assignment *)expr)->right;
+			expr  = ((Expr_Assignment *)expr)->left;
+			break;
+
+		NoDefaultCase();
+		}
+
+		if (other) {
+			Expr **slot = M_StackPush(&stack);
+			if (!slot) {
+				M_StackFree(&stack);
+				return false;
+			}
+			*slot = other;
+		}
+
+		if (!expr && stack.count)
+			expr = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return true;
+}
+
+static u32 FrameIntern(Frame_Resolver *resolver, String name) {
+	Frame_Layout *layout = resolver->layout;
+
+	u64 hash = HashString(name);
+	u32 pos  = (u32)hash & resolver->mask;
+
+	for (;;) {
+		u32 index = resolver->table[pos];
+
+		if (index == 0) {
+			u32         slot_index = layout->slot_count++;
+			Frame_Slot *slot       = &layout->slots[slot_index];
+			slot->name     = name;
+			slot->type     = nullptr;
+			slot->offset   = 0;
+			slot->assigned = false;
+
+			resolver->table[pos]          = slot_index + 1;
+			resolver->hashes[slot_index] = hash;
+			return slot_index;
+		}
+
+		Frame_Slot *slot = &layout->slots[index - 1];
+		if (resolver->hashes[index - 1] == hash && slot->name.count == name.count &&
+			memcmp(slot->name.data, name.data, name.count) == 0)
+			return index - 1;
+
+		pos = (pos + 1) & resolver->mask;
+	}
+}
+
+static Expr_Type *FrameWiden(Expr_Type *have, Expr_Type *type) {
+	if (!have) return type;
+	if (!type) return have;
+	return ExprBinaryType(have, type);
+}
+
+// Types the name on the left of an assignment from what is assigned to it
+static Expr_Type *FrameResolveAssignment(Frame_Resolver *resolver, Expr_Assignment *assign, Expr_Type *type) {
+	if (assign->left->kind != Expr_Kind_Identifier) {
+		if (resolver->valid && resolver->parser)
+			Error(resolver->parser, assign->left->range, "left side of an assignment must be a name");
+		resolver->valid = false;
+		return type;
+	}
+
+	Expr_Identifier *name = (Expr_Identifier *)assign->left;
+	if (name->slot == EXPR_SLOT_NONE)
+		name->slot = FrameIntern(resolver, name->name);
+
+	Frame_Slot *slot  = &resolver->layout->slots[name->slot];
+	Expr_Type * wider = FrameWiden(slot->type, type);
+
+	if (wider != slot->type) {
+		slot->type        = wider;
+		resolver->changed = true;
+	}
+
+	slot->assigned     = true;
+	assign->left->type = slot->type;
+	return slot->type;
+}
+
+// Recomputes the types of a tree bottom up from the current slot types. Slot types only
+// ever widen, so repeating this over all statements settles after a few rounds.
+static void FrameResolveExpr(Frame_Resolver *resolver, Expr *root) {
+	Frame_Layout *layout = resolver->layout;
+	Expr_Type *   type   = nullptr;
+	Expr *        expr   = root;
+
+	// While `expr` is set it is descended into, then `type` goes up to the operator waiting for it
+	for (;;) {
+		if (expr) {
+			switch (expr->kind) {
+			case Expr_Kind_Literal:
+			{
+				type = expr->type;
+				expr = nullptr;
+				break;
+			}
+
+			case Expr_Kind_Identifier:
+			{
+				Expr_Identifier *name = (Expr_Identifier *)expr;
+				if (name->slot == EXPR_SLOT_NONE)
+					name->slot = FrameIntern(resolver, name->name);
+				expr->type = layout->slots[name->slot].type;
+				type       = expr->type;
+				expr       = nullptr;
+				break;
+			}
+
+			case Expr_Kind_Unary_Operator:
+			case Expr_Kind_Binary_Operator:
+			case Expr_Kind_Assignment:
+			{
+				Frame_Walk *walk = M_StackPush(&resolver->stack);
+				if (!walk) {
+					if (resolver->valid && resolver->parser)
+						Error(resolver->parser, expr->range, "expression is too deeply nested");
+					resolver->valid       = false;
+					resolver->stack.count = 0;
+					return;
+				}
+
+				walk->expr     = expr;
+				walk->has_left = false;
+
+				if (expr->kind == Expr_Kind_Unary_Operator)
+					expr = ((Expr_Unary_Operator *)expr)->child;
+				else if (expr->kind == Expr_Kind_Binary_Operator)
+					expr = ((Expr_Binary_Operator *)expr)->left;
+				else
+					expr = ((Expr_Assignment *)expr)->right;
+				break;
+			}
+
+			NoDefaultCase();
+			}
+			continue;
+		}
+
+		if (!resolver->stack.count)
+			break;
+
+		Frame_Walk *walk = M_StackTop(&resolver->stack);
+		Expr *      node = walk->expr;
+
+		switch (node->kind) {
+		case Expr_Kind_Unary_Operator:
+		{
+			type = ExprUnaryType(type);
+			break;
+		}
+
+		case Expr_Kind_Binary_Operator:
+		{
+			if (!walk->has_left) {
+				walk->left     = type;
+				walk->has_left = true;
+				expr           = ((Expr_Binary_Operator *)node)->right;
+				continue;
+			}
+			type = ExprBinaryType(walk->left, type);
+			break;
+		}
+
+		case Expr_Kind_Assignment:
+		{
+			type = FrameResolveAssignment(resolver, (Expr_Assignment *)node, type);
+			break;
+		}
+
+		NoDefaultCase();
+		}
+
+		node->type = type;
+		resolver->stack.count -= 1;
+	}
+}
+
+bool FrameResolve(Frame_Layout *layout, Parser *parser, Expr_Array statements, M_Pool *pool) {
+	memset(layout, 0, sizeof(*layout));
+
+	u32 name_count = 0;
+	for (imem index = 0; index < statements.count; ++index) {
+		if (!FrameCountNames(statements.data[index], &name_count)) {
+			if (parser)
+				Error(parser, statements.data[index]->range, "expression is too deeply nested");
+			return false;
+		}
+	}
+
+	u32 table_size = 16;
+	while (table_size < name_count * 2)
+		table_size *= 2;
+
+	Frame_Resolver resolver = { 0 };
+	resolver.layout = layout;
+	resolver.parser = parser;
+	resolver.valid  = true;
+	resolver.mask   = table_size - 1;
+	resolver.table  = M_PoolPush(pool, sizeof(u32) * table_size, _Alignof(u32), M_CLEAR_MEMORY);
+	resolver.hashes = M_PoolPush(pool, sizeof(u64) * (name_count + 1), _Alignof(u64), 0);
+	layout->slots   = M_PoolPush(pool, sizeof(Frame_Slot) * (name_count + 1), _Alignof(Frame_Slot), 0);
+	M_StackInit(&resolver.stack, FRAME_STACK_MAX);
+
+	// Names that are never assigned a typed value are inputs, once they get their default
+	// type the names computed from them can settle as well
+	for (bool untyped = true; untyped;) {
+		do {
+			resolver.changed = false;
+			for (imem index = 0; index < statements.count; ++index)
+				FrameResolveExpr(&resolver, statements.data[index]);
+		} while (resolver.changed);
+
+		untyped = false;
+		for (u32 index = 0; index < layout->slot_count; ++index) {
+			if (!layout->slots[index].type) {
+				layout->slots[index].type = &ExprBuiltinUnsigned64.base;
+				untyped = true;
+			}
+		}
+	}
+
+	M_StackFree(&resolver.stack);
+
+	// Sizes are powers of two, placing the largest first keeps every slot aligned
+	u32 *order = M_PoolPush(pool, sizeof(u32) * (layout->slot_count + 1), _Alignof(u32), 0);
+	for (u32 index = 0; index < layout->slot_count; ++index) {
+		u32 size = layout->slots[index].type->runtime_size;
+		u32 pos  = index;
+		while (pos && layout->slots[order[pos - 1]].type->runtime_size < size) {
+			order[pos] = order[pos - 1];
+			pos -= 1;
+		}
+		order[pos] = index;
+	}
+
+	layout->alignment = 1;
+	for (u32 index = 0; index < layout->slot_count; ++index) {
+		Frame_Slot *slot = &layout->slots[order[index]];
+		u32         size = slot->type->runtime_size;
+
+		Assert((size & (size - 1)) == 0);
+		Assert((layout->size & (size - 1)) == 0);
+
+		slot->offset  = layout->size;
+		layout->size += size;
+		if (size > layout->alignment)
+			layout->alignment = size;
+	}
+
+	layout->size = (layout->size + layout->alignment - 1) & ~(layout->alignment - 1);
+	return resolver.valid;
+}
+
+u8 *FrameAllocate(Frame_Layout *layout, M_Pool *pool) {
+	return M_PoolPush(pool, layout->size ? layout->size : 1, layout->alignment, M_CLEAR_MEMORY);
+}
+
+Value FrameLoad(Frame_Layout *layout, u8 *frame, u32 index) {
+	Frame_Slot *slot = &layout->slots[index];
+	u8 *        data = frame + slot->offset;
+
+	if (slot->type->id == Expr_Type_Id_FLOAT) {
+		Value value = { Value_Kind_FLOAT };
+		memcpy(&value.floating, data, sizeof(r64));
+		return value;
+	}
+
+	Expr_Type_Integer *type  = (Expr_Type_Integer *)slot->type;
+	Value              value = { Value_Kind_INTEGER };
+
+	if (type->flags & EXPR_TYPE_INTEGER_IS_SIGNED) {
+		switch (type->base.runtime_size) {
+		case 1: value.integer = (u64)(i64)*(i8 *)data; break;
+		case 2: value.integer = (u64)(i64)*(i16 *)data; break;
+		case 4: value.integer = (u64)(i64)*(i32 *)data; break;
+		case 8: value.integer = *(u64 *)data; break;
+		NoDefaultCase();
+		}
+	} else {
+		switch (type->base.runtime_size) {
+		case 1: value.integer = *(u8 *)data; break;
+		case 2: value.integer = *(u16 *)data; break;
+		case 4: value.integer = *(u32 *)data; break;
+		case 8: value.integer = *(u64 *)data; break;
+		NoDefaultCase();
+		}
+	}
+
+	return value;
+}
+
+void FrameStore(Frame_Layout *layout, u8 *frame, u32 index, Value value) {
+	Frame_Slot *slot = &layout->slots[index];
+	u8 *        data = frame + slot->offset;
+
+	// The frame has no room for a missing value, a failed evaluation leaves the slot as it was
+	if (value.kind == Value_Kind_NONE)
+		return;
+
+	if (slot->type->id == Expr_Type_Id_FLOAT) {
+		r64 floating = value.kind == Value_Kind_FLOAT ? value.floating : (r64)value.integer;
+		memcpy(data, &floating, sizeof(r64));
+		return;
+	}
+
+	u64 integer = value.kind == Value_Kind_INTEGER ? value.integer : (u64)value.floating;
+
+	switch (slot->type->runtime_size) {
+	case 1: *(u8 *)data  = (u8)integer; break;
+	case 2: *(u16 *)data = (u16)integer; break;
+	case 4: *(u32 *)data = (u32)integer; break;
+	case 8: *(u64 *)data = integer; break;
+	NoDefaultCase();
+	}
+}
+
+Value ValueConvert(Expr_Type *type, Value value) {
+	if (value.kind == Value_Kind_NONE)
+		return value;
+
+	if (type->id == Expr_Type_Id_FLOAT)
+		return ValueFloat(ValueToFloat(value));
+
+	u64 integer = value.kind == Value_Kind_INTEGER ? value.integer : (u64)value.floating;
+	u32 bits    = type->runtime_size * 8;
+
+	if (bits < 64) {
+		u64 mask = ((u64)1 << bits) - 1;
+		integer &= mask;
+		if ((((Expr_Type_Integer *)type)->flags & EXPR_TYPE_INTEGER_IS_SIGNED) && (integer >> (bits - 1)))
+			integer |= ~mask;
+	}
+
+	return ValueInteger(integer);
+}
+
+//
+//
+//
+
+static u64 EvalMultiplyHigh(u64 a, u64 b, bool is_signed) {
+	u64 hi;
+#if COMPILER_MSVC && ARCH_X64
+	_umul128(a, b, &hi);
+#elif defined(__SIZEOF_INT128__)
+	hi = (u64)(((__uint128_t)a * b) >> 64);
+#else
+	u64 a_lo = (u32)a, a_hi = a >> 32;
+	u64 b_lo = (u32)b, b_hi = b >> 32;
+	u64 p0   = a_lo * b_lo;
+	u64 p1   = a_lo * b_hi;
+	u64 p2   = a_hi * b_lo;
+	u64 mid  = (p0 >> 32) + (u32)p1 + (u32)p2;
+	hi = a_hi * b_hi + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+	// Each negative operand took away 2^64 times the other one from the unsigned product
+	if (is_signed) {
+		if ((i64)a < 0) hi -= b;
+		if ((i64)b < 0) hi -= a;
+	}
+	return hi;
+}
+
+Value EvalUnaryOperator(u32 symbol, Value value) {
+	if (value.kind == Value_Kind_NONE || symbol == '+')
+		return value;
+
+	Assert(symbol == '-');
+
+	if (value.kind == Value_Kind_FLOAT)
+		return ValueFloat(-value.floating);
+	return ValueInteger(0 - value.integer);
+}
+
+Value EvalBinaryOperator(Parser *parser, Token_Range range, u32 symbol, bool is_signed, Value left, Value right) {
+	if (left.kind == Value_Kind_NONE || right.kind == Value_Kind_NONE)
+		return (Value){ Value_Kind_NONE };
+
+	if (left.kind == Value_Kind_FLOAT || right.kind == Value_Kind_FLOAT) {
+		r64 a = ValueToFloat(left);
+		r64 b = ValueToFloat(right);
+
+		switch (symbol) {
+		case '+': return ValueFloat(a + b);
+		case '-': return ValueFloat(a - b);
+		case '*': return ValueFloat(a * b);
+		case '/': return ValueFloat(a / b);
+		}
+
+		Unreachable();
+	}
+
+	u64 a = left.integer;
+	u64 b = right.integer;
+
+	switch (symbol) {
+	case '+': return ValueInteger(a + b);
+	case '-': return ValueInteger(a - b);
+	case '*': return ValueInteger(a * b);
+	case '/':
+	{
+		if (b == 0) {
+			if (parser)
+				Error(parser, range, "division by zero");
+			return (Value){ Value_Kind_NONE };
+		}
+
+		if (is_signed) {
+			if ((i64)b == -1)
+				return ValueInteger(0 - a);
+			return ValueInteger((u64)((i64)a / (i64)b));
+		}
+
+		return ValueInteger(a / b);
+	}
+
+	case EXPR_SYMBOL_SHIFT_LEFT:
+		return ValueInteger(a << (b & 63));
+
+	case EXPR_SYMBOL_SHIFT_RIGHT:
+		if (is_signed)
+			return ValueInteger((u64)((i64)a >> (b & 63)));
+		return ValueInteger(a >> (b & 63));
+
+	case EXPR_SYMBOL_MULTIPLY_HIGH:
+		return ValueInteger(EvalMultiplyHigh(a, b, is_signed));
+	}
+
+	Unreachable();
+}
+
+// An operator waiting for its operands, a binary one keeps its left value until the right one is there
+typedef struct Eval_Frame {
+	Expr *expr;
+	Value left;
+	bool  has_left;
+} Eval_Frame;
+
+#define EVAL_STACK_LOCAL 64
+#define EVAL_STACK_MAX   (MegaBytes(256) / sizeof(Eval_Frame))
+
+Value EvalExpr(Eval_Context *ctx, Expr *root) {
+	M_Stack(Eval_Frame, EVAL_STACK_LOCAL) stack;
+	M_StackInit(&stack, EVAL_STACK_MAX);
+
+	Value value = { Value_Kind_NONE };
+	Expr *expr  = root;
+
+	// While `expr` is set it is descended into, then `value` goes up to the operator waiting for it
+	for (;;) {
+		if (expr) {
+			switch (expr->kind) {
+			case Expr_Kind_Literal:
+			{
+				Expr_Literal *literal = (Expr_Literal *)expr;
+				if (expr->type->id == Expr_Type_Id_FLOAT)
+					value = ValueFloat(literal->value.floating);
+				else
+					value = ValueInteger(literal->value.integer);
+				expr = nullptr;
+				break;
+			}
+
+			case Expr_Kind_Identifier:
+			{
+				Expr_Identifier *name = (Expr_Identifier *)expr;
+				if (ctx->frame && name->slot != EXPR_SLOT_NONE)
+					value = FrameLoad(ctx->layout, ctx->frame, name->slot);
+				else
+					value = ctx->load(ctx->user, name);
+				expr = nullptr;
+				break;
+			}
+
+			case Expr_Kind_Unary_Operator:
+			case Expr_Kind_Binary_Operator:
+			case Expr_Kind_Assignment:
+			{
+				Eval_Frame *frame = M_StackPush(&stack);
+				if (!frame) {
+					if (ctx->parser)
+						Error(ctx->parser, expr->range, "expression is too deeply nested to evaluate");
+					M_StackFree(&stack);
+					return (Value){ Value_Kind_NONE };
+				}
+
+				frame->expr     = expr;
+				frame->has_left = false;
+
+				if (expr->kind == Expr_Kind_Unary_Operator)
+					expr = ((Expr_Unary_Operator *)expr)->child;
+				else if (expr->kind == Expr_Kind_Binary_Operator)
+					expr = ((Expr_Binary_Operator *)expr)->left;
+				else
+					expr = ((Expr_Assignment *)expr)->right;
+				break;
+			}
+
+			NoDefaultCase();
+			}
+			continue;
+		}
+
+		if (!stack.count)
+			break;
+
+		Eval_Frame *frame = M_StackTop(&stack);
+		Expr *      node  = frame->expr;
+
+		switch (node->kind) {
+		case Expr_Kind_Unary_Operator:
+		{
+			value = EvalUnaryOperator(((Expr_Unary_Operator *)node)->symbol, value);
+			break;
+		}
+
+		case Expr_Kind_Binary_Operator:
+		{
+			Expr_Binary_Operator *binary = (Expr_Binary_Operator *)node;
+			if (!frame->has_left) {
+				frame->left     = value;
+				frame->has_left = true;
+				expr            = binary->right;
+				continue;
+			}
+			value = EvalBinaryOperator(ctx->parser, node->range, binary->symbol, ExprIsSigned(node), frame->left, value);
+			break;
+		}
+
+		case Expr_Kind_Assignment:
+		{
+			Expr_Assignment *assign = (Expr_Assignment *)node;
+
+			if (assign->left->kind != Expr_Kind_Identifier) {
+				if (ctx->parser)
+					Error(ctx->parser, assign->left->range, "left side of an assignment must be a name");
+				value = (Value){ Value_Kind_NONE };
+				break;
+			}
+
+			Expr_Identifier *name = (Expr_Identifier *)assign->left;
+			if (ctx->frame && name->slot != EXPR_SLOT_NONE)
+				FrameStore(ctx->layout, ctx->frame, name->slot, value);
+			else if (ctx->store)
+				ctx->store(ctx->user, name, value);
+			break;
+		}
+
+		NoDefaultCase();
+		}
+
+		stack.count -= 1;
+	}
+
+	M_StackFree(&stack);
+	return value;
+}
+
+bool ValueEquals(Value a, Value b) {
+	if (a.kind != b.kind)
+		return false;
+	if (a.kind == Value_Kind_NONE)
+		return true;
+	// bitwise, so a NaN result that stays NaN does not count as a change
+	return a.integer == b.integer;
+}
+
+void ValueDump(FILE *out, Value value) {
+	switch (value.kind) {
+	case Value_Kind_NONE:    fprintf(out, "none"); break;
+	case Value_Kind_INTEGER: fprintf(out, "%" PRIu64, value.integer); break;
+	case Value_Kind_FLOAT:   fprintf(out, "%.17g", value.floating); break;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Parser.h"
+
+typedef enum Value_Kind {
+	Value_Kind_NONE,
+	Value_Kind_INTEGER,
+	Value_Kind_FLOAT,
+} Value_Kind;
+
+typedef struct Value {
+	Value_Kind kind;
+	union {
+		u64 integer;
+		r64 floating;
+	};
+} Value;
+
+// Every distinct name gets one slot in a flat frame. Slots are laid out by decreasing
+// size so that each one is naturally aligned without padding between them.
+typedef struct Frame_Slot {
+	String     name;
+	Expr_Type *type;
+	u32        offset;
+	bool       assigned;
+} Frame_Slot;
+
+typedef struct Frame_Layout {
+	Frame_Slot *slots;
+	u32         slot_count;
+	u32         size;
+	u32         alignment;
+} Frame_Layout;
+
+typedef struct Eval_Context {
+	Parser *      parser; // diagnostics, may be null
+	Frame_Layout *layout; // resolved names load and store directly in the frame when set
+	u8 *          frame;
+	void *        user;
+	Value (*load)(void *user, Expr_Identifier *name);
+	void  (*store)(void *user, Expr_Identifier *name, Value value);
+} Eval_Context;
+
+// Assigns a slot to every name and types the identifiers from what gets assigned to them,
+// names that are only read become u64 inputs
+bool  FrameResolve(Frame_Layout *layout, Parser *parser, Expr_Array statements, M_Pool *pool);
+u8 *  FrameAllocate(Frame_Layout *layout, M_Pool *pool);
+Value FrameLoad(Frame_Layout *layout, u8 *frame, u32 slot);
+void  FrameStore(Frame_Layout *layout, u8 *frame, u32 slot, Value value);
+
+// What a load from a slot of `type` gives after `value` was stored to it
+Value ValueConvert(Expr_Type *type, Value value);
+
+// Values of unknown inputs are NONE and propagate as NONE, runtime errors are reported and also give NONE.
+// The walk keeps its own stack, a tree too deep even for that is reported and gives NONE.
+Value EvalExpr(Eval_Context *ctx, Expr *expr);
+
+// The operators of EvalExpr on values that are already there, for backends that do not walk
+// trees. Division by zero is reported to `parser` when it is set and gives NONE.
+Value EvalUnaryOperator(u32 symbol, Value value);
+Value EvalBinaryOperator(Parser *parser, Token_Range range, u32 symbol, bool is_signed, Value left, Value right);
+
+bool  ValueEquals(Value a, Value b);
+void  ValueDump(FILE *out, Value value);
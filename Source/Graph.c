@@ -0,0 +1,564 @@
+#include "Graph.h"
+#include "Hash.h"
+#include "Array.h"
+
+#include <string.h>
+
+static u32 GraphIntern(Graph *graph, String name, bool insert) {
+	u64 hash = HashString(name);
+	u32 slot = (u32)hash & graph->slot_mask;
+
+	for (;;) {
+		u32 index = graph->slots[slot];
+
+		if (index == 0) {
+			if (!insert)
+				return GRAPH_NO_STATEMENT;
+
+			Graph_Variable *var = &graph->variables[graph->variable_count];
+			var->name           = name;
+			var->hash           = hash;
+			var->value          = (Value){ Value_Kind_NONE };
+			var->definition     = GRAPH_NO_STATEMENT;
+			var->reader_first   = 0;
+			var->reader_count   = 0;
+			var->visit          = GRAPH_NO_STATEMENT;
+
+			graph->slots[slot] = ++graph->variable_count;
+			return graph->variable_count - 1;
+		}
+
+		Graph_Variable *var = &graph->variables[index - 1];
+		if (var->hash == hash && var->name.count == name.count &&
+			memcmp(var->name.data, name.data, name.count) == 0)
+			return index - 1;
+
+		slot = (slot + 1) & graph->slot_mask;
+	}
+}
+
+u32 GraphFind(Graph *graph, String name) {
+	return GraphIntern(graph, name, false);
+}
+
+// Pending right sides of a tree walk that fit on the C stack, deeper trees spill to an array
+#define GRAPH_STACK_LOCAL 64
+#define GRAPH_STACK_MAX   (MegaBytes(256) / sizeof(Expr *))
+
+// Adds the names in a tree to `count`, false when the tree is too deep to walk
+static bool GraphCountNames(Expr *root, u32 *count) {
+	M_Stack(Expr *, GRAPH_STACK_LOCAL) stack;
+	M_StackInit(&stack, GRAPH_STACK_MAX);
+
+	// Follows the left side and keeps the right one for later
+	for (Expr *expr = root; expr;) {
+		Expr *other = nullptr;
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+			expr = nullptr;
+			break;
+
+		case Expr_Kind_Identifier:
+			*count += 1;
+			expr    = nullptr;
+			break;
+
+		case Expr_Kind_Unary_Operator:
+			expr = ((Expr_Unary_Operator *)expr)->child;
+			break;
+
+		case Expr_Kind_Binary_Operator:
+			other = ((Expr_Binary_Operator *)expr)->right;
+			expr  = ((Expr_Binary_Operator *)expr)->left;
+			break;
+
+		case Expr_Kind_Assignment:
+			other = ((Expr_Assignment *)expr)->right;
+			expr  = ((Expr_Assignment *)expr)->left;
+			break;
+
+		NoDefaultCase();
+		}
+
+		if (other) {
+			Expr **slot = M_StackPush(&stack);
+			if (!slot) {
+				M_StackFree(&stack);
+				return false;
+			}
+			*slot = other;
+		}
+
+		if (!expr && stack.count)
+			expr = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return true;
+}
+
+// Visits the names read by a statement from left to right. On the first pass each name is
+// resolved to its variable, kept in the slot of the identifier for GraphLoad, and edges are
+// only counted. On the second pass they are written into the reader lists. The stamp drops
+// repeated reads of the same name within one statement. False when the statement nests an
+// assignment or is too deep to walk, both reported on the first pass.
+static bool GraphVisitReads(Graph *graph, Expr *root, u32 statement, u32 stamp, bool fill) {
+	M_Stack(Expr *, GRAPH_STACK_LOCAL) stack;
+	M_StackInit(&stack, GRAPH_STACK_MAX);
+
+	bool valid = true;
+
+	for (Expr *expr = root; expr;) {
+		Expr *other = nullptr;
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+		{
+			expr = nullptr;
+		} break;
+
+		case Expr_Kind_Identifier:
+		{
+			Expr_Identifier *name = (Expr_Identifier *)expr;
+			if (!fill)
+				name->slot = GraphIntern(graph, name->name, true);
+
+			Graph_Variable *var = &graph->variables[name->slot];
+			if (var->visit != stamp) {
+				var->visit = stamp;
+				if (fill)
+					graph->readers[var->reader_first + var->reader_count] = statement;
+				var->reader_count += 1;
+			}
+			expr = nullptr;
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+		{
+			expr = ((Expr_Unary_Operator *)expr)->child;
+		} break;
+
+		case Expr_Kind_Binary_Operator:
+		{
+			other = ((Expr_Binary_Operator *)expr)->right;
+			expr  = ((Expr_Binary_Operator *)expr)->left;
+		} break;
+
+		case Expr_Kind_Assignment:
+		{
+			if (!fill)
+				Error(graph->parser, expr->range, "assignment can not be nested inside an expression");
+			valid = false;
+			expr  = nullptr;
+		} break;
+
+		NoDefaultCase();
+		}
+
+		if (other) {
+			Expr **slot = M_StackPush(&stack);
+			if (!slot) {
+				if (!fill)
+					Error(graph->parser, root->range, "expression is too deeply nested");
+				M_StackFree(&stack);
+				return false;
+			}
+			*slot = other;
+		}
+
+		if (!expr && stack.count)
+			expr = *M_StackPop(&stack);
+	}
+
+	M_StackFree(&stack);
+	return valid;
+}
+
+static bool GraphAddStatement(Graph *graph, Expr *expr, u32 stamp) {
+	if (expr->kind != Expr_Kind_Assignment) {
+		Warning(graph->parser, expr->range, "expression result is not assigned to anything, ignored");
+		return false;
+	}
+
+	Expr_Assignment *assign = (Expr_Assignment *)expr;
+
+	if (assign->left->kind != Expr_Kind_Identifier) {
+		Error(graph->parser, assign->left->range, "left side of an assignment must be a name");
+		return false;
+	}
+
+	Expr_Identifier *name = (Expr_Identifier *)assign->left;
+	u32              target = GraphIntern(graph, name->name, true);
+	Graph_Variable * var    = &graph->variables[target];
+
+	if (var->definition != GRAPH_NO_STATEMENT) {
+		Graph_Statement *previous = &graph->statements[var->definition];
+		Error(graph->parser, assign->left->range, "\"" StrFmt "\" is already assigned", StrArg(var->name));
+		Info(graph->parser, previous->assign->left->range, "previous assignment is here");
+		return false;
+	}
+
+	u32 index = graph->statement_count;
+	if (!GraphVisitReads(graph, assign->right, index, stamp, false))
+		return false;
+
+	Graph_Statement *statement = &graph->statements[index];
+	statement->assign = assign;
+	statement->target = target;
+	statement->order  = GRAPH_NO_STATEMENT;
+	statement->inputs = 0;
+	statement->wave   = 0;
+	statement->queued = false;
+
+	name->slot      = target;
+	var->definition = index;
+	graph->statement_count += 1;
+	return true;
+}
+
+// Marks the statements Kahn's algorithm left out that lie on a cycle, the others only read
+// something that does. Tarjan's algorithm over the left out statements with an explicit
+// stack: a statement is on a cycle when its component has more than one statement, or when
+// it reads its own target.
+static void GraphFindCycles(Graph *graph, bool *cyclic, M_Pool *pool) {
+	u32   count    = graph->statement_count;
+	u32 * number   = M_PoolPush(pool, sizeof(u32) * count, _Alignof(u32), 0);
+	u32 * low      = M_PoolPush(pool, sizeof(u32) * count, _Alignof(u32), 0);
+	u32 * edge     = M_PoolPush(pool, sizeof(u32) * count, _Alignof(u32), 0);
+	u32 * calls    = M_PoolPush(pool, sizeof(u32) * count, _Alignof(u32), 0);
+	u32 * stack    = M_PoolPush(pool, sizeof(u32) * count, _Alignof(u32), 0);
+	bool *stacked  = M_PoolPush(pool, sizeof(bool) * count, _Alignof(bool), M_CLEAR_MEMORY);
+	u32   numbered = 0;
+	u32   depth    = 0;
+	u32   top      = 0;
+
+	for (u32 index = 0; index < count; ++index) {
+		number[index] = GRAPH_NO_STATEMENT;
+		cyclic[index] = false;
+	}
+
+	for (u32 root = 0; root < count; ++root) {
+		if (graph->statements[root].order != GRAPH_NO_STATEMENT || number[root] != GRAPH_NO_STATEMENT)
+			continue;
+
+		number[root]   = low[root] = numbered++;
+		edge[root]     = 0;
+		stacked[root]  = true;
+		stack[top++]   = root;
+		calls[depth++] = root;
+
+		while (depth) {
+			u32             current = calls[depth - 1];
+			Graph_Variable *var     = &graph->variables[graph->statements[current].target];
+
+			if (edge[current] < var->reader_count) {
+				u32 reader = graph->readers[var->reader_first + edge[current]++];
+
+				if (reader == current) {
+					cyclic[current] = true;
+				} else if (graph->statements[reader].order != GRAPH_NO_STATEMENT) {
+					continue;
+				} else if (number[reader] == GRAPH_NO_STATEMENT) {
+					number[reader]  = low[reader] = numbered++;
+					edge[reader]    = 0;
+					stacked[reader] = true;
+					stack[top++]    = reader;
+					calls[depth++]  = reader;
+				} else if (stacked[reader]) {
+					low[current] = Min(low[current], number[reader]);
+				}
+				continue;
+			}
+
+			depth -= 1;
+			if (depth)
+				low[calls[depth - 1]] = Min(low[calls[depth - 1]], low[current]);
+
+			if (low[current] == number[current]) {
+				u32 first = top;
+				while (stack[--first] != current) {}
+
+				for (u32 at = first; at < top; ++at) {
+					stacked[stack[at]] = false;
+					if (top - first > 1)
+						cyclic[stack[at]] = true;
+				}
+				top = first;
+			}
+		}
+	}
+}
+
+bool GraphBuild(Graph *graph, Parser *parser, Expr_Array list, M_Pool *pool) {
+	memset(graph, 0, sizeof(*graph));
+	graph->parser = parser;
+
+	u32 name_count = 0;
+	for (imem index = 0; index < list.count; ++index) {
+		if (!GraphCountNames(list.data[index], &name_count)) {
+			Error(parser, list.data[index]->range, "expression is too deeply nested");
+			return false;
+		}
+	}
+
+	u32 slot_count = 16;
+	while (slot_count < name_count * 2)
+		slot_count *= 2;
+
+	graph->slot_mask  = slot_count - 1;
+	graph->slots      = M_PoolPush(pool, sizeof(u32) * slot_count, _Alignof(u32), M_CLEAR_MEMORY);
+	graph->variables  = M_PoolPush(pool, sizeof(Graph_Variable) * (name_count + 1), _Alignof(Graph_Variable), 0);
+	graph->statements = M_PoolPush(pool, sizeof(Graph_Statement) * (list.count + 1), _Alignof(Graph_Statement), 0);
+
+	bool valid = true;
+
+	for (imem index = 0; index < list.count; ++index) {
+		if (!GraphAddStatement(graph, list.data[index], (u32)index) && list.data[index]->kind == Expr_Kind_Assignment)
+			valid = false;
+	}
+
+	// Reader lists are stored back to back, counted on the first pass and filled on the second
+	u32 edge_count = 0;
+	for (u32 index = 0; index < graph->variable_count; ++index) {
+		Graph_Variable *var = &graph->variables[index];
+		var->reader_first   = edge_count;
+		edge_count         += var->reader_count;
+		var->reader_count   = 0;
+		var->visit          = GRAPH_NO_STATEMENT;
+	}
+
+	graph->readers = M_PoolPush(pool, sizeof(u32) * (edge_count + 1), _Alignof(u32), 0);
+
+	for (u32 index = 0; index < graph->statement_count; ++index) {
+		Graph_Statement *statement = &graph->statements[index];
+		GraphVisitReads(graph, statement->assign->right, index, index, true);
+	}
+
+	for (u32 index = 0; index < graph->variable_count; ++index) {
+		Graph_Variable *var = &graph->variables[index];
+		if (var->definition == GRAPH_NO_STATEMENT)
+			continue;
+		for (u32 edge = 0; edge < var->reader_count; ++edge)
+			graph->statements[graph->readers[var->reader_first + edge]].inputs += 1;
+	}
+
+	// Kahn's algorithm, the order array doubles as the work queue
+	graph->order = M_PoolPush(pool, sizeof(u32) * (graph->statement_count + 1), _Alignof(u32), 0);
+	graph->heap  = M_PoolPush(pool, sizeof(u32) * (graph->statement_count + 1), _Alignof(u32), 0);
+
+	for (u32 index = 0; index < graph->statement_count; ++index) {
+		if (graph->statements[index].inputs == 0)
+			graph->order[graph->order_count++] = index;
+	}
+
+	for (u32 head = 0; head < graph->order_count; ++head) {
+		Graph_Statement *statement = &graph->statements[graph->order[head]];
+		statement->order = head;
+
+		Graph_Variable *var = &graph->variables[statement->target];
+		for (u32 edge = 0; edge < var->reader_count; ++edge) {
+			Graph_Statement *reader = &graph->statements[graph->readers[var->reader_first + edge]];
+			reader->wave = Max(reader->wave, statement->wave + 1);
+			if (--reader->inputs == 0)
+				graph->order[graph->order_count++] = graph->readers[var->reader_first + edge];
+		}
+	}
+
+	// Regroup the order by wave with a counting sort, the heap is free to hold the copy.
+	// Waves only ever follow what they read, so the result is still a topological order.
+	for (u32 index = 0; index < graph->order_count; ++index)
+		graph->wave_count = Max(graph->wave_count, graph->statements[graph->order[index]].wave + 1);
+
+	graph->waves = M_PoolPush(pool, sizeof(u32) * (graph->wave_count + 1), _Alignof(u32), M_CLEAR_MEMORY);
+
+	for (u32 index = 0; index < graph->order_count; ++index)
+		graph->waves[graph->statements[graph->order[index]].wave + 1] += 1;
+	for (u32 wave = 0; wave < graph->wave_count; ++wave)
+		graph->waves[wave + 1] += graph->waves[wave];
+
+	for (u32 index = 0; index < graph->order_count; ++index) {
+		Graph_Statement *statement = &graph->statements[graph->order[index]];
+		statement->order = graph->waves[statement->wave]++;
+		graph->heap[statement->order] = graph->order[index];
+	}
+
+	for (u32 wave = graph->wave_count; wave > 0; --wave)
+		graph->waves[wave] = graph->waves[wave - 1];
+	graph->waves[0] = 0;
+
+	memcpy(graph->order, graph->heap, sizeof(u32) * graph->order_count);
+
+	if (graph->order_count != graph->statement_count) {
+		valid = false;
+
+		M_Temp temp   = M_PoolBeginTemporaryMemory(pool);
+		// Scratch for finding the cycles is given back along with this
+		bool * cyclic = M_PoolPush(pool, sizeof(bool) * graph->statement_count, _Alignof(bool), 0);
+		GraphFindCycles(graph, cyclic, pool);
+
+		for (u32 index = 0; index < graph->statement_count; ++index) {
+			Graph_Statement *statement = &graph->statements[index];
+			if (statement->order == GRAPH_NO_STATEMENT) {
+				Error(parser, statement->assign->base.range, "\"" StrFmt "\" %s",
+					StrArg(graph->variables[statement->target].name), cyclic[index] ? "depends on itself" : "depends on a cycle");
+			}
+		}
+
+		M_PoolEndTemporaryMemory(pool, &temp);
+	}
+
+	return valid;
+}
+
+// Every name a statement reads was resolved to its variable by GraphBuild
+static Value GraphLoad(void *user, Expr_Identifier *name) {
+	Graph *graph = user;
+	Assert(name->slot < graph->variable_count);
+	return graph->variables[name->slot].value;
+}
+
+static bool GraphEvaluate(Graph *graph, u32 index) {
+	Graph_Statement *statement = &graph->statements[index];
+	Graph_Variable * var       = &graph->variables[statement->target];
+
+	Eval_Context ctx = { graph->parser, nullptr, nullptr, graph, GraphLoad, nullptr };
+	Value value      = EvalExpr(&ctx, statement->assign->right);
+
+	if (ValueEquals(var->value, value))
+		return false;
+
+	var->value = value;
+	return true;
+}
+
+static void GraphForgetQueued(Graph *graph) {
+	graph->heap_count = 0;
+	for (u32 index = 0; index < graph->statement_count; ++index)
+		graph->statements[index].queued = false;
+}
+
+void GraphEvaluateAll(Graph *graph) {
+	for (u32 index = 0; index < graph->order_count; ++index)
+		GraphEvaluate(graph, graph->order[index]);
+	GraphForgetQueued(graph);
+}
+
+// Smaller waves are not worth waking up the other workers for
+#define GRAPH_PARALLEL_MIN_WAVE 512
+#define GRAPH_PARALLEL_GRAIN    128
+
+typedef struct Graph_Wave {
+	Graph *graph;
+	u32 *  statements;
+} Graph_Wave;
+
+static void GraphEvaluateRange(void *user, u32 first, u32 count) {
+	Graph_Wave *wave = user;
+	for (u32 index = first; index < first + count; ++index)
+		GraphEvaluate(wave->graph, wave->statements[index]);
+}
+
+void GraphEvaluateParallel(Graph *graph, Task_Pool *pool) {
+	for (u32 wave = 0; wave < graph->wave_count; ++wave) {
+		Graph_Wave work  = { graph, graph->order + graph->waves[wave] };
+		u32        count = graph->waves[wave + 1] - graph->waves[wave];
+
+		if (count < GRAPH_PARALLEL_MIN_WAVE || pool->worker_count < 2) {
+			GraphEvaluateRange(&work, 0, count);
+		} else {
+			TaskRun(pool, count, GRAPH_PARALLEL_GRAIN, GraphEvaluateRange, &work);
+		}
+	}
+	GraphForgetQueued(graph);
+}
+
+static void GraphHeapPush(Graph *graph, u32 index) {
+	Graph_Statement *statements = graph->statements;
+	u32 *            heap       = graph->heap;
+
+	if (statements[index].queued || statements[index].order == GRAPH_NO_STATEMENT)
+		return;
+	statements[index].queued = true;
+
+	u32 pos = graph->heap_count++;
+	while (pos) {
+		u32 parent = (pos - 1) / 2;
+		if (statements[heap[parent]].order <= statements[index].order)
+			break;
+		heap[pos] = heap[parent];
+		pos       = parent;
+	}
+	heap[pos] = index;
+}
+
+static u32 GraphHeapPop(Graph *graph) {
+	Graph_Statement *statements = graph->statements;
+	u32 *            heap       = graph->heap;
+
+	u32 top  = heap[0];
+	u32 last = heap[--graph->heap_count];
+	u32 pos  = 0;
+
+	for (;;) {
+		u32 child = pos * 2 + 1;
+		if (child >= graph->heap_count)
+			break;
+		if (child + 1 < graph->heap_count && statements[heap[child + 1]].order < statements[heap[child]].order)
+			child += 1;
+		if (statements[last].order <= statements[heap[child]].order)
+			break;
+		heap[pos] = heap[child];
+		pos       = child;
+	}
+	heap[pos] = last;
+
+	statements[top].queued = false;
+	return top;
+}
+
+static void GraphQueueReaders(Graph *graph, u32 variable) {
+	Graph_Variable *var = &graph->variables[variable];
+	for (u32 edge = 0; edge < var->reader_count; ++edge)
+		GraphHeapPush(graph, graph->readers[var->reader_first + edge]);
+}
+
+bool GraphSet(Graph *graph, String name, Value value) {
+	u32 index = GraphFind(graph, name);
+	if (index == GRAPH_NO_STATEMENT)
+		return false;
+
+	Graph_Variable *var = &graph->variables[index];
+	if (var->definition != GRAPH_NO_STATEMENT)
+		return false;
+
+	if (!ValueEquals(var->value, value)) {
+		var->value = value;
+		GraphQueueReaders(graph, index);
+	}
+
+	return true;
+}
+
+Value GraphGet(Graph *graph, String name) {
+	u32 index = GraphFind(graph, name);
+	if (index == GRAPH_NO_STATEMENT)
+		return (Value){ Value_Kind_NONE };
+	return graph->variables[index].value;
+}
+
+u32 GraphUpdate(Graph *graph) {
+	u32 evaluated = 0;
+
+	// Statements come out in topological order, so each one runs at most once
+	// and only after everything it reads has settled
+	while (graph->heap_count) {
+		u32 index = GraphHeapPop(graph);
+		evaluated += 1;
+
+		if (GraphEvaluate(graph, index))
+			GraphQueueReaders(graph, graph->statements[index].target);
+	}
+
+	return evaluated;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Eval.h"
+#include "Task.h"
+
+// Dependency graph over a list of `name = expression` statements.
+// Each variable is defined by at most one statement; variables that no statement
+// defines are inputs and are set from outside with GraphSet. After an input changes,
+// GraphUpdate re-evaluates only the statements downstream of it, in topological order,
+// and stops propagating along any path whose value came out unchanged.
+//
+// Statements are also grouped into waves: a statement's wave is one past the latest wave of
+// the statements defining what it reads. Variables have a single definition, so nothing in a
+// wave writes what another statement of the same wave reads or writes, and a whole wave can
+// run in parallel once the previous one has finished.
+
+#define GRAPH_NO_STATEMENT ((u32)-1)
+
+typedef struct Graph_Variable {
+	String name;
+	u64    hash;
+	Value  value;
+	u32    definition;   // statement index, GRAPH_NO_STATEMENT for inputs
+	u32    reader_first; // into Graph.readers
+	u32    reader_count;
+	u32    visit;        // last statement that read this variable, used to drop duplicate edges
+} Graph_Variable;
+
+typedef struct Graph_Statement {
+	Expr_Assignment *assign;
+	u32              target;
+	u32              order;  // topological position, GRAPH_NO_STATEMENT if rejected, on a cycle or after one
+	u32              inputs; // distinct defined variables read, used during sorting
+	u32              wave;
+	bool             queued;
+} Graph_Statement;
+
+typedef struct Graph {
+	Parser *         parser;
+
+	Graph_Variable * variables;
+	u32              variable_count;
+	u32 *            slots; // open addressing, variable index + 1, 0 is empty
+	u32              slot_mask;
+
+	Graph_Statement *statements;
+	u32              statement_count;
+
+	u32 *            readers; // statement indices, grouped per variable
+	u32 *            order;   // statement indices in evaluation order, grouped by wave
+	u32              order_count;
+	u32 *            waves;   // wave i is order[waves[i]] up to order[waves[i + 1]]
+	u32              wave_count;
+
+	u32 *            heap;    // pending statements, min-heap on Graph_Statement.order
+	u32              heap_count;
+} Graph;
+
+// Resolves every name to its variable and keeps the index in the slot of the identifier, so
+// the statements can not be resolved to a frame as well
+bool  GraphBuild(Graph *graph, Parser *parser, Expr_Array statements, M_Pool *pool);
+void  GraphEvaluateAll(Graph *graph);
+
+// Same values as GraphEvaluateAll. Diagnostics of statements in the same wave may come out in any order.
+void  GraphEvaluateParallel(Graph *graph, Task_Pool *pool);
+
+u32   GraphFind(Graph *graph, String name);
+bool  GraphSet(Graph *graph, String name, Value value);
+Value GraphGet(Graph *graph, String name);
+u32   GraphUpdate(Graph *graph);
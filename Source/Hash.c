@@ -0,0 +1,43 @@
+#include "Hash.h"
+
+#include <string.h>
+
+// MurmurHash64A, 8 bytes per step
+u64 HashBytes(const void *data, umem size, u64 seed) {
+	const u64 m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+
+	u64 h = seed ^ (size * m);
+
+	const u8 *pos  = (const u8 *)data;
+	const u8 *last = pos + (size & ~(umem)7);
+
+	for (; pos != last; pos += 8) {
+		u64 k;
+		memcpy(&k, pos, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	switch (size & 7) {
+	case 7: h ^= (u64)pos[6] << 48;
+	case 6: h ^= (u64)pos[5] << 40;
+	case 5: h ^= (u64)pos[4] << 32;
+	case 4: h ^= (u64)pos[3] << 24;
+	case 3: h ^= (u64)pos[2] << 16;
+	case 2: h ^= (u64)pos[1] << 8;
+	case 1: h ^= (u64)pos[0];
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
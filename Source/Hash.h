@@ -0,0 +1,8 @@
+#pragma once
+#include "Platform.h"
+
+u64 HashBytes(const void *data, umem size, u64 seed);
+
+inproc u64 HashString(String str) {
+	return HashBytes(str.data, str.count, 0);
+}
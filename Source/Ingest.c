@@ -0,0 +1,608 @@
+#include "Ingest.h"
+#include "Thread.h"
+
+#include <string.h>
+
+static String IngestPath(const char *path) {
+	return (String){ (imem)strlen(path), (u8 *)path };
+}
+
+static void IngestDeliver(Ingest_File *file, Ingest_Proc proc, void *user, Ingest_Stats *stats) {
+	if (file->error) {
+		stats->failed += 1;
+	} else {
+		stats->files += 1;
+		stats->bytes += (u64)file->content.count;
+	}
+	proc(user, file);
+}
+
+//
+//
+//
+
+#if PLATFORM_WINDOWS == 1
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#pragma warning(pop)
+
+static Ingest_File IngestReadFile(const char **paths, u32 index, M_Pool *pool) {
+	Ingest_File file = { index, IngestPath(paths[index]) };
+
+	HANDLE handle = CreateFileA(paths[index], GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		file.error = (int)GetLastError();
+		return file;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size)) {
+		file.error = (int)GetLastError();
+		CloseHandle(handle);
+		return file;
+	}
+
+	u8 * buffer = M_PoolPush(pool, size.QuadPart ? (umem)size.QuadPart : 1, 1, 0);
+	umem done   = 0;
+
+	if (!buffer) {
+		file.error = ERROR_NOT_ENOUGH_MEMORY;
+		CloseHandle(handle);
+		return file;
+	}
+
+	while (done < (umem)size.QuadPart) {
+		DWORD count = 0;
+		if (!ReadFile(handle, buffer + done, (DWORD)Min((umem)size.QuadPart - done, MegaBytes(1024)), &count, nullptr)) {
+			file.error = (int)GetLastError();
+			break;
+		}
+		if (!count) // the file got shorter
+			break;
+		done += count;
+	}
+
+	CloseHandle(handle);
+
+	file.content = (String){ (imem)done, buffer };
+	return file;
+}
+
+#endif
+
+#if PLATFORM_LINUX == 1 || PLATFORM_MAC == 1
+#include <errno.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static Ingest_File IngestReadFile(const char **paths, u32 index, M_Pool *pool) {
+	Ingest_File file = { index, IngestPath(paths[index]) };
+
+	int fd = open(paths[index], O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		file.error = errno;
+		return file;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		file.error = errno;
+		close(fd);
+		return file;
+	}
+
+	u8 * buffer = M_PoolPush(pool, st.st_size ? (umem)st.st_size : 1, 1, 0);
+	umem done   = 0;
+
+	if (!buffer) {
+		file.error = ENOMEM;
+		close(fd);
+		return file;
+	}
+
+	while (done < (umem)st.st_size) {
+		ssize_t count = pread(fd, buffer + done, (umem)st.st_size - done, (off_t)done);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0) {
+			file.error = errno;
+			break;
+		}
+		if (!count) // the file got shorter
+			break;
+		done += count;
+	}
+
+	close(fd);
+
+	file.content = (String){ (imem)done, buffer };
+	return file;
+}
+
+#endif
+
+//
+//
+//
+
+#if PLATFORM_LINUX == 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+typedef struct Ingest_Ring {
+	int                  fd;
+	u32                  entries;
+	u32                  pending; // written to the submission queue, not yet passed to the kernel
+
+	u32 *                sq_head;
+	u32 *                sq_tail;
+	u32 *                sq_mask;
+	u32 *                sq_array;
+	struct io_uring_sqe *sqes;
+
+	u32 *                cq_head;
+	u32 *                cq_tail;
+	u32 *                cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *               sq_ring;
+	umem                 sq_ring_size;
+	void *               cq_ring;
+	umem                 cq_ring_size;
+	umem                 sqes_size;
+} Ingest_Ring;
+
+static void IngestRingFree(Ingest_Ring *ring) {
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+}
+
+// Opens and reads need kernel 5.6, older ones set up a ring but fail these operations
+static bool IngestRingSupported(Ingest_Ring *ring) {
+	union {
+		struct io_uring_probe probe;
+		u8                    storage[sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)];
+	} probe;
+	memset(&probe, 0, sizeof(probe));
+
+	if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, &probe.probe, 256) < 0)
+		return false;
+
+	return probe.probe.last_op >= IORING_OP_READ &&
+		(probe.probe.ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+		(probe.probe.ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+static bool IngestRingInit(Ingest_Ring *ring, u32 entries) {
+	memset(ring, 0, sizeof(*ring));
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	// Refused outright under seccomp, with kernel.io_uring_disabled and before 5.1
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0)
+		return false;
+
+	ring->entries      = params.sq_entries;
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size    = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single)
+		ring->sq_ring_size = ring->cq_ring_size = Max(ring->sq_ring_size, ring->cq_ring_size);
+
+	ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = nullptr;
+		IngestRingFree(ring);
+		return false;
+	}
+
+	ring->cq_ring = single ? ring->sq_ring :
+		mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	if (ring->cq_ring == MAP_FAILED) {
+		ring->cq_ring = nullptr;
+		IngestRingFree(ring);
+		return false;
+	}
+
+	ring->sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = nullptr;
+		IngestRingFree(ring);
+		return false;
+	}
+
+	u8 *sq = ring->sq_ring;
+	u8 *cq = ring->cq_ring;
+
+	ring->sq_head  = (u32 *)(sq + params.sq_off.head);
+	ring->sq_tail  = (u32 *)(sq + params.sq_off.tail);
+	ring->sq_mask  = (u32 *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (u32 *)(sq + params.sq_off.array);
+	ring->cq_head  = (u32 *)(cq + params.cq_off.head);
+	ring->cq_tail  = (u32 *)(cq + params.cq_off.tail);
+	ring->cq_mask  = (u32 *)(cq + params.cq_off.ring_mask);
+	ring->cqes     = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	if (!IngestRingSupported(ring)) {
+		IngestRingFree(ring);
+		return false;
+	}
+
+	return true;
+}
+
+// Every file in flight has at most one operation queued, the queue never fills up
+static struct io_uring_sqe *IngestRingQueue(Ingest_Ring *ring, u8 opcode, int fd, u32 slot) {
+	u32 tail  = *ring->sq_tail;
+	u32 index = tail & *ring->sq_mask;
+
+	Assert(tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) < ring->entries);
+
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode    = opcode;
+	sqe->fd        = fd;
+	sqe->user_data = slot;
+
+	ring->sq_array[index] = index;
+	ring->pending        += 1;
+	return sqe;
+}
+
+// Publishes what IngestRingQueue wrote, the kernel only looks at entries before the tail
+static void IngestRingPublish(Ingest_Ring *ring) {
+	__atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static bool IngestRingEnter(Ingest_Ring *ring, u32 wait) {
+	for (;;) {
+		long result = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+		if (result >= 0) {
+			ring->pending -= (u32)result;
+			if (!ring->pending || !wait)
+				return true;
+			continue;
+		}
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			return false;
+		// Completions come back while a signal interrupts the wait, the caller looks at them first
+		if (errno == EINTR && wait && __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) != *ring->cq_head)
+			return true;
+		ThreadYield();
+	}
+}
+
+typedef struct Ingest_Slot {
+	u32  index;
+	int  fd;    // -1 while the open is in flight
+	u8 * buffer;
+	umem size;
+	umem done;
+} Ingest_Slot;
+
+static void IngestRingOpen(Ingest_Ring *ring, const char *path, u32 slot) {
+	struct io_uring_sqe *sqe = IngestRingQueue(ring, IORING_OP_OPENAT, AT_FDCWD, slot);
+	sqe->addr       = (u64)(umem)path;
+	sqe->open_flags = O_RDONLY | O_CLOEXEC;
+	IngestRingPublish(ring);
+}
+
+static void IngestRingRead(Ingest_Ring *ring, Ingest_Slot *slot, u32 index) {
+	struct io_uring_sqe *sqe = IngestRingQueue(ring, IORING_OP_READ, slot->fd, index);
+	sqe->addr = (u64)(umem)(slot->buffer + slot->done);
+	sqe->len  = (u32)Min(slot->size - slot->done, MegaBytes(1024));
+	sqe->off  = slot->done;
+	IngestRingPublish(ring);
+}
+
+// Returns whether the slot's file is done, successfully or not
+static bool IngestRingComplete(Ingest_Ring *ring, Ingest_Slot *slot, u32 index, int result, M_Pool *pool, Ingest_File *file) {
+	if (result == -EINTR || result == -EAGAIN) {
+		if (slot->fd < 0)
+			IngestRingOpen(ring, (const char *)file->path.data, index);
+		else
+			IngestRingRead(ring, slot, index);
+		return false;
+	}
+
+	if (result < 0) {
+		file->error = -result;
+	} else if (slot->fd < 0) {
+		slot->fd = result;
+
+		struct stat st;
+		if (fstat(slot->fd, &st) != 0) {
+			file->error = errno;
+		} else {
+			slot->size   = (umem)st.st_size;
+			slot->buffer = M_PoolPush(pool, slot->size ? slot->size : 1, 1, 0);
+			if (!slot->buffer) {
+				file->error = ENOMEM;
+			} else if (slot->size) {
+				IngestRingRead(ring, slot, index);
+				return false;
+			}
+		}
+	} else if (result) {
+		slot->done += (umem)result;
+		if (slot->done < slot->size) {
+			IngestRingRead(ring, slot, index);
+			return false;
+		}
+	}
+	// A read of 0 bytes before the end means the file got shorter, it ends there
+
+	if (slot->fd >= 0)
+		close(slot->fd);
+	if (!file->error)
+		file->content = (String){ (imem)slot->done, slot->buffer };
+	return true;
+}
+
+static bool IngestWithRing(const char **paths, u32 count, M_Pool *pool, Ingest_Proc proc, void *user, Ingest_Stats *stats) {
+	Ingest_Ring ring;
+	if (!IngestRingInit(&ring, INGEST_QUEUE_DEPTH))
+		return false;
+
+	stats->uring = true;
+
+	Ingest_Slot slots[INGEST_QUEUE_DEPTH];
+	u32         free_slots[INGEST_QUEUE_DEPTH];
+	Ingest_File ready[INGEST_QUEUE_DEPTH]; // each slot finishes at most once per pass over the completions
+	u32         free_count = 0;
+	u32         next       = 0;
+	bool        failed     = false;
+
+	for (u32 slot = Min(ring.entries, INGEST_QUEUE_DEPTH); slot--;)
+		free_slots[free_count++] = slot;
+	u32 slot_count = free_count;
+
+	while (next < count || free_count < slot_count) {
+		while (next < count && free_count) {
+			u32 slot = free_slots[--free_count];
+			slots[slot] = (Ingest_Slot){ .index = next, .fd = -1 };
+			IngestRingOpen(&ring, paths[next], slot);
+			next += 1;
+		}
+
+		if (!IngestRingEnter(&ring, 1)) {
+			failed = true;
+			break;
+		}
+
+		u32 ready_count = 0;
+		u32 head        = *ring.cq_head;
+		u32 tail        = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail; ++head) {
+			struct io_uring_cqe *cqe  = &ring.cqes[head & *ring.cq_mask];
+			u32                  slot = (u32)cqe->user_data;
+			Ingest_File          file = { slots[slot].index, IngestPath(paths[slots[slot].index]) };
+
+			if (IngestRingComplete(&ring, &slots[slot], slot, cqe->res, pool, &file)) {
+				ready[ready_count++]     = file;
+				free_slots[free_count++] = slot;
+			}
+		}
+
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+		// Queue the next opens before handing files over, so the disk is busy while they are parsed
+		while (next < count && free_count) {
+			u32 slot = free_slots[--free_count];
+			slots[slot] = (Ingest_Slot){ .index = next, .fd = -1 };
+			IngestRingOpen(&ring, paths[next], slot);
+			next += 1;
+		}
+
+		failed = !IngestRingEnter(&ring, 0);
+
+		for (u32 index = 0; index < ready_count; ++index)
+			IngestDeliver(&ready[index], proc, user, stats);
+
+		if (failed)
+			break;
+	}
+
+	if (failed) {
+		// The ring broke down, files it still had are read here instead. Operations already
+		// queued may yet land in their buffers, which stay allocated in the pool.
+		for (u32 index = 0; index < free_count; ++index)
+			slots[free_slots[index]].index = count;
+		for (u32 slot = 0; slot < slot_count; ++slot) {
+			if (slots[slot].index >= count)
+				continue;
+			if (slots[slot].fd >= 0)
+				close(slots[slot].fd);
+			Ingest_File file = IngestReadFile(paths, slots[slot].index, pool);
+			IngestDeliver(&file, proc, user, stats);
+		}
+		for (; next < count; ++next) {
+			Ingest_File file = IngestReadFile(paths, next, pool);
+			IngestDeliver(&file, proc, user, stats);
+		}
+	}
+
+	IngestRingFree(&ring);
+	return true;
+}
+
+#endif
+
+//
+//
+//
+
+typedef struct Ingest_Readers {
+	const char **paths;
+	u32          count;
+	volatile u32 next;       // first file no one has claimed
+	Mutex        lock;       // guards done_count
+	Condition    finished;   // signalled when done_count grows
+	Ingest_File *done;       // read files in the order they finished
+	u32          done_count;
+} Ingest_Readers;
+
+typedef struct Ingest_Reader {
+	Ingest_Readers *shared;
+	M_Pool          pool; // the caller's pool is not shared between threads, it takes these over at the end
+	Thread          thread;
+} Ingest_Reader;
+
+static bool IngestClaim(Ingest_Readers *shared, u32 *index) {
+	if (AtomicLoad32(&shared->next) >= shared->count)
+		return false;
+	*index = AtomicAdd32(&shared->next, 1) - 1;
+	return *index < shared->count;
+}
+
+static void IngestFinish(Ingest_Readers *shared, Ingest_File *file) {
+	MutexLock(&shared->lock);
+	shared->done[shared->done_count++] = *file;
+	ConditionWakeAll(&shared->finished);
+	MutexUnlock(&shared->lock);
+}
+
+static void IngestReaderMain(void *argument) {
+	Ingest_Reader * reader = argument;
+	Ingest_Readers *shared = reader->shared;
+
+	for (u32 index; IngestClaim(shared, &index);) {
+		Ingest_File file = IngestReadFile(shared->paths, index, &reader->pool);
+		IngestFinish(shared, &file);
+	}
+}
+
+static void IngestWithReaders(const char **paths, u32 count, M_Pool *pool, Ingest_Proc proc, void *user, Ingest_Stats *stats) {
+	// Readers fill pools of their own, which would get around a budget, so this thread reads alone
+	u32  reader_count = pool->budget ? 0 : Min(INGEST_READER_COUNT, count);
+	umem size         = sizeof(Ingest_File) * count + sizeof(Ingest_Reader) * reader_count;
+
+	M_Arena *arena = M_ArenaAllocate(sizeof(M_Arena) + size + 64, sizeof(M_Arena) + size + 64);
+	Ingest_Readers shared = { paths, count };
+	Ingest_Reader *readers = nullptr;
+
+	if (arena->reserved) {
+		shared.done = M_PushArray(arena, Ingest_File, count, 0);
+		readers     = M_PushArray(arena, Ingest_Reader, reader_count, M_CLEAR_MEMORY);
+	}
+
+	// Without memory for the bookkeeping, read one file after the other
+	if (!shared.done || !readers) {
+		for (u32 index = 0; index < count; ++index) {
+			Ingest_File file = IngestReadFile(paths, index, pool);
+			IngestDeliver(&file, proc, user, stats);
+		}
+		M_ArenaFree(arena);
+		return;
+	}
+
+	MutexInit(&shared.lock);
+	ConditionInit(&shared.finished);
+
+	u32 started = 0;
+	for (; started < reader_count; ++started) {
+		Ingest_Reader *reader = &readers[started];
+		reader->shared = &shared;
+		M_PoolInit(&reader->pool, pool->cap);
+		if (!ThreadStart(&reader->thread, IngestReaderMain, reader)) {
+			M_PoolFree(&reader->pool);
+			break;
+		}
+	}
+
+	// Hand over what the readers finished, read files here while nothing is ready
+	for (u32 delivered = 0; delivered < count;) {
+		MutexLock(&shared.lock);
+		u32 ready = shared.done_count;
+		MutexUnlock(&shared.lock);
+
+		if (delivered < ready) {
+			for (; delivered < ready; ++delivered)
+				IngestDeliver(&shared.done[delivered], proc, user, stats);
+			continue;
+		}
+
+		u32 index;
+		if (IngestClaim(&shared, &index)) {
+			Ingest_File file = IngestReadFile(paths, index, pool);
+			IngestFinish(&shared, &file);
+			continue;
+		}
+
+		// Every file is claimed, the rest is still being read by the readers
+		MutexLock(&shared.lock);
+		while (shared.done_count == delivered)
+			ConditionWait(&shared.finished, &shared.lock);
+		MutexUnlock(&shared.lock);
+	}
+
+	for (u32 index = 0; index < started; ++index) {
+		ThreadJoin(&readers[index].thread);
+		M_PoolAdopt(pool, &readers[index].pool);
+	}
+
+	ConditionFree(&shared.finished);
+	MutexFree(&shared.lock);
+	M_ArenaFree(arena);
+}
+
+//
+//
+//
+
+void IngestFiles(const char **paths, u32 count, M_Pool *pool, Ingest_Proc proc, void *user, Ingest_Stats *stats) {
+	Ingest_Stats local;
+	if (!stats)
+		stats = &local;
+	memset(stats, 0, sizeof(*stats));
+
+	if (!count)
+		return;
+
+#if PLATFORM_LINUX == 1
+	if (IngestWithRing(paths, count, pool, proc, user, stats))
+		return;
+#endif
+
+	IngestWithReaders(paths, count, pool, proc, user, stats);
+}
+
+typedef struct Ingest_Parse {
+	M_Pool *    pool;
+	Expr_Array *files;
+} Ingest_Parse;
+
+static void IngestParseFile(void *user, Ingest_File *file) {
+	Ingest_Parse *parse = user;
+	if (file->error)
+		return;
+
+	Parser parser;
+	ParserInit(&parser, file->content, file->path, parse->pool);
+	parse->files[file->index] = ParseStatements(&parser);
+}
+
+void IngestParse(const char **paths, u32 count, M_Pool *pool, Expr_Array *files, Ingest_Stats *stats) {
+	memset(files, 0, sizeof(*files) * count);
+
+	Ingest_Parse parse = { pool, files };
+	IngestFiles(paths, count, pool, IngestParseFile, &parse, stats);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Parser.h"
+#include "Pool.h"
+
+// Reads many files at once and hands each one over as soon as its bytes are in, while the
+// reads of the others are still under way. On Linux opens and reads go through io_uring,
+// up to INGEST_QUEUE_DEPTH files in flight, and the calling thread only blocks when it has
+// nothing to hand over. Where io_uring is missing or refused, and on other platforms, a set
+// of reader threads opens and reads the files with pread instead.
+//
+// Either way the callback runs on the thread that called IngestFiles, one file at a time,
+// in the order the reads finish. The contents stay in the pool given to IngestFiles.
+
+#ifndef INGEST_QUEUE_DEPTH
+#define INGEST_QUEUE_DEPTH 64
+#endif
+
+// Reads block in the fallback, so there are more readers than cores
+#ifndef INGEST_READER_COUNT
+#define INGEST_READER_COUNT 16
+#endif
+
+typedef struct Ingest_File {
+	u32    index; // into the paths given to IngestFiles
+	String path;
+	String content;
+	int    error; // errno of the failed open or read (GetLastError on Windows), 0 when the file was read
+} Ingest_File;
+
+typedef void (*Ingest_Proc)(void *user, Ingest_File *file);
+
+typedef struct Ingest_Stats {
+	u64  bytes;
+	u32  files;
+	u32  failed;
+	bool uring; // false when the reader threads did the work
+} Ingest_Stats;
+
+// Returns once every file has been handed to `proc`, stats may be null
+void IngestFiles(const char **paths, u32 count, M_Pool *pool, Ingest_Proc proc, void *user, Ingest_Stats *stats);
+
+// IngestFiles with ParseStatements as the callback, files[i] gets the statements of paths[i]
+// and stays empty when the file could not be read
+void IngestParse(const char **paths, u32 count, M_Pool *pool, Expr_Array *files, Ingest_Stats *stats);
@@ -0,0 +1,563 @@
+#include "Ir.h"
+#include "Hash.h"
+#include "Array.h"
+
+#include <string.h>
+
+// An operator waiting for the values of its operands, a binary one keeps its left value
+// until the right one is there
+typedef struct Ir_Frame {
+	Expr *expr;
+	u32   left;
+	bool  has_left;
+} Ir_Frame;
+
+#define IR_STACK_LOCAL 64
+#define IR_STACK_MAX   (MegaBytes(256) / sizeof(Ir_Frame))
+
+typedef struct Ir_Lowerer {
+	Ir_Program *     program;
+	Frame_Layout *   layout;
+	Ir_Instruction * instructions;
+	u32              count;
+	u32              capacity;
+	u32 *            table;   // instruction index + 1, 0 is empty
+	u32              mask;
+	u32 *            current; // per slot, the value it holds, IR_VALUE_NONE until loaded or after a store that may fail
+	bool             valid;
+
+	M_Stack(Ir_Frame, IR_STACK_LOCAL) stack;
+} Ir_Lowerer;
+
+static bool IrIsConstant(Ir_Lowerer *lowerer, u32 value) {
+	return lowerer->instructions[value].op == Ir_Op_CONSTANT;
+}
+
+static u32 IrFailure(Ir_Lowerer *lowerer, u32 value) {
+	return lowerer->instructions[value].flags & IR_MAY_FAIL;
+}
+
+static u64 IrHash(const Ir_Instruction *ins) {
+	u64 key[6] = {
+		(u64)ins->op << 32 | ins->symbol,
+		(u64)ins->a << 32 | ins->b,
+		ins->slot,
+		(u64)(umem)ins->type,
+		(u64)ins->constant.kind,
+		ins->constant.integer,
+	};
+	return HashBytes(key, sizeof(key), 0);
+}
+
+static bool IrSame(const Ir_Instruction *a, const Ir_Instruction *b) {
+	return a->op == b->op && a->symbol == b->symbol && a->slot == b->slot && a->a == b->a && a->b == b->b &&
+		a->type == b->type && a->constant.kind == b->constant.kind && a->constant.integer == b->constant.integer;
+}
+
+// Loads and stores depend on where they are, and divisions that may fail have to report each
+// time, everything else is numbered: an equal instruction emitted before is used instead
+static u32 IrEmit(Ir_Lowerer *lowerer, Ir_Instruction *ins) {
+	bool numbered = ins->op != Ir_Op_LOAD && ins->op != Ir_Op_STORE && !(ins->flags & IR_TRAPS);
+	u32  pos      = 0;
+
+	if (numbered) {
+		pos = (u32)IrHash(ins) & lowerer->mask;
+
+		for (u32 index; (index = lowerer->table[pos]) != 0; pos = (pos + 1) & lowerer->mask) {
+			if (IrSame(&lowerer->instructions[index - 1], ins)) {
+				lowerer->program->stats.merged += 1;
+				return index - 1;
+			}
+		}
+	}
+
+	Assert(lowerer->count < lowerer->capacity);
+
+	u32 index = lowerer->count++;
+	lowerer->instructions[index] = *ins;
+
+	if (numbered)
+		lowerer->table[pos] = index + 1;
+	return index;
+}
+
+static u32 IrConstant(Ir_Lowerer *lowerer, Expr_Type *type, Value value, Token_Range range) {
+	Ir_Instruction ins = { Ir_Op_CONSTANT };
+	ins.type     = type;
+	ins.constant = value;
+	ins.range    = range;
+	return IrEmit(lowerer, &ins);
+}
+
+// The value a read of `slot` gives after `value` was stored to it
+static u32 IrConvert(Ir_Lowerer *lowerer, u32 slot, u32 value, Token_Range range) {
+	Expr_Type *     type = lowerer->layout->slots[slot].type;
+	Ir_Instruction *from = &lowerer->instructions[value];
+
+	if (from->op == Ir_Op_CONSTANT)
+		return IrConstant(lowerer, type, ValueConvert(type, from->constant), range);
+
+	// Doubles stay doubles and 8 byte slots keep all 64 bits, in the others only what was
+	// loaded or converted for the same type already fits
+	if (type->id == Expr_Type_Id_FLOAT) {
+		if (from->type->id == Expr_Type_Id_FLOAT)
+			return value;
+	} else if (from->type->id != Expr_Type_Id_FLOAT) {
+		if (type->runtime_size == 8)
+			return value;
+		if ((from->op == Ir_Op_LOAD || from->op == Ir_Op_CONVERT) && from->type == type)
+			return value;
+	}
+
+	Ir_Instruction ins = { Ir_Op_CONVERT };
+	ins.a     = value;
+	ins.type  = type;
+	ins.range = range;
+	return IrEmit(lowerer, &ins);
+}
+
+static u32 IrLowerLeaf(Ir_Lowerer *lowerer, Expr *expr) {
+	if (expr->kind == Expr_Kind_Literal) {
+		Expr_Literal *literal = (Expr_Literal *)expr;
+		Value         value   = { Value_Kind_INTEGER };
+
+		if (expr->type->id == Expr_Type_Id_FLOAT) {
+			value.kind     = Value_Kind_FLOAT;
+			value.floating = literal->value.floating;
+		} else {
+			value.integer  = literal->value.integer;
+		}
+
+		return IrConstant(lowerer, expr->type, value, expr->range);
+	}
+
+	u32 slot = ((Expr_Identifier *)expr)->slot;
+	if (slot == EXPR_SLOT_NONE) {
+		lowerer->valid = false;
+		return IR_VALUE_NONE;
+	}
+
+	if (lowerer->current[slot] != IR_VALUE_NONE) {
+		lowerer->program->stats.forwarded += 1;
+		return lowerer->current[slot];
+	}
+
+	Ir_Instruction ins = { Ir_Op_LOAD };
+	ins.slot  = slot;
+	ins.type  = lowerer->layout->slots[slot].type;
+	ins.range = expr->range;
+
+	lowerer->current[slot] = IrEmit(lowerer, &ins);
+	return lowerer->current[slot];
+}
+
+static u32 IrLowerUnary(Ir_Lowerer *lowerer, Expr_Unary_Operator *unary, u32 a) {
+	Expr *expr = &unary->base;
+
+	if (unary->symbol == '+')
+		return a;
+
+	if (IrIsConstant(lowerer, a))
+		return IrConstant(lowerer, expr->type, EvalUnaryOperator(unary->symbol, lowerer->instructions[a].constant), expr->range);
+
+	Ir_Instruction ins = { Ir_Op_UNARY };
+	ins.flags  = IrFailure(lowerer, a);
+	ins.symbol = unary->symbol;
+	ins.a      = a;
+	ins.type   = expr->type;
+	ins.range  = expr->range;
+	return IrEmit(lowerer, &ins);
+}
+
+static u32 IrLowerBinary(Ir_Lowerer *lowerer, Expr_Binary_Operator *binary, u32 a, u32 b) {
+	Expr *expr      = &binary->base;
+	bool  is_signed = ExprIsSigned(expr);
+
+	// Without a parser a division by zero is not reported, it stays for the run to report
+	if (IrIsConstant(lowerer, a) && IrIsConstant(lowerer, b)) {
+		Value value = EvalBinaryOperator(nullptr, expr->range, binary->symbol, is_signed,
+			lowerer->instructions[a].constant, lowerer->instructions[b].constant);
+		if (value.kind != Value_Kind_NONE)
+			return IrConstant(lowerer, expr->type, value, expr->range);
+	}
+
+	// Operands in one order, so that a + b and b + a get the same number. Only for integers,
+	// with two NaNs the one on the left is what comes out, and that decides the sign of it.
+	bool commutes = binary->symbol == '+' || binary->symbol == '*' || binary->symbol == EXPR_SYMBOL_MULTIPLY_HIGH;
+	if (commutes && expr->type->id == Expr_Type_Id_INTEGER && a > b) {
+		u32 swap = a;
+		a = b;
+		b = swap;
+	}
+
+	Ir_Instruction ins = { Ir_Op_BINARY };
+	ins.flags  = IrFailure(lowerer, a) | IrFailure(lowerer, b);
+	ins.symbol = binary->symbol;
+	ins.a      = a;
+	ins.b      = b;
+	ins.type   = expr->type;
+	ins.range  = expr->range;
+
+	if (binary->symbol == '/' && expr->type->id != Expr_Type_Id_FLOAT &&
+		!(IrIsConstant(lowerer, b) && lowerer->instructions[b].constant.integer != 0))
+		ins.flags |= IR_MAY_FAIL | IR_TRAPS;
+
+	return IrEmit(lowerer, &ins);
+}
+
+static u32 IrLowerAssignment(Ir_Lowerer *lowerer, Expr_Assignment *assign, u32 value) {
+	if (assign->left->kind != Expr_Kind_Identifier || ((Expr_Identifier *)assign->left)->slot == EXPR_SLOT_NONE) {
+		lowerer->valid = false;
+		return IR_VALUE_NONE;
+	}
+
+	u32 slot = ((Expr_Identifier *)assign->left)->slot;
+	u32 held = IR_VALUE_NONE;
+
+	if (!IrFailure(lowerer, value)) {
+		held = IrConvert(lowerer, slot, value, assign->left->range);
+		if (held == lowerer->current[slot]) {
+			lowerer->program->stats.dead_stores += 1;
+			return value;
+		}
+	}
+
+	Ir_Instruction ins = { Ir_Op_STORE };
+	ins.flags = IrFailure(lowerer, value);
+	ins.slot  = slot;
+	ins.a     = value;
+	ins.type  = lowerer->layout->slots[slot].type;
+	ins.range = assign->base.range;
+	IrEmit(lowerer, &ins);
+
+	// The slot keeps its old value when NONE is stored, the next read has to look
+	lowerer->current[slot] = held;
+	return value;
+}
+
+// Operands are lowered left to right before their operator, as the tree evaluator runs them.
+// Lowering stops at the first statement that has no place in the frame.
+static u32 IrLowerExpr(Ir_Lowerer *lowerer, Expr *root) {
+	u32   value = IR_VALUE_NONE;
+	Expr *expr  = root;
+
+	// While `expr` is set it is descended into, then `value` goes up to the operator waiting for it
+	for (;;) {
+		if (expr) {
+			lowerer->program->stats.nodes += 1;
+
+			if (expr->kind == Expr_Kind_Literal || expr->kind == Expr_Kind_Identifier) {
+				value = IrLowerLeaf(lowerer, expr);
+				expr  = nullptr;
+			} else {
+				Ir_Frame *frame = M_StackPush(&lowerer->stack);
+				if (!frame) {
+					lowerer->valid = false;
+					break;
+				}
+
+				frame->expr     = expr;
+				frame->has_left = false;
+
+				switch (expr->kind) {
+				case Expr_Kind_Unary_Operator:  expr = ((Expr_Unary_Operator *)expr)->child; break;
+				case Expr_Kind_Binary_Operator: expr = ((Expr_Binary_Operator *)expr)->left; break;
+				case Expr_Kind_Assignment:      expr = ((Expr_Assignment *)expr)->right; break;
+				NoDefaultCase();
+				}
+			}
+			continue;
+		}
+
+		if (!lowerer->valid || !lowerer->stack.count)
+			break;
+
+		Ir_Frame *frame = M_StackTop(&lowerer->stack);
+		Expr *    node  = frame->expr;
+
+		switch (node->kind) {
+		case Expr_Kind_Unary_Operator:
+		{
+			value = IrLowerUnary(lowerer, (Expr_Unary_Operator *)node, value);
+			break;
+		}
+
+		case Expr_Kind_Binary_Operator:
+		{
+			if (!frame->has_left) {
+				frame->left     = value;
+				frame->has_left = true;
+				expr            = ((Expr_Binary_Operator *)node)->right;
+				continue;
+			}
+			value = IrLowerBinary(lowerer, (Expr_Binary_Operator *)node, frame->left, value);
+			break;
+		}
+
+		case Expr_Kind_Assignment:
+		{
+			value = IrLowerAssignment(lowerer, (Expr_Assignment *)node, value);
+			break;
+		}
+
+		NoDefaultCase();
+		}
+
+		lowerer->stack.count -= 1;
+	}
+
+	lowerer->stack.count = 0;
+	return lowerer->valid ? value : IR_VALUE_NONE;
+}
+
+// Walks back from the end, so by the time a store comes up everything after it is known: it
+// is dead when a store that can not fail follows before any live load of the slot. Operands
+// of live instructions are live, and so are stores still standing and divisions that may fail.
+// False when there is no memory for the marks.
+static bool IrSweep(Ir_Lowerer *lowerer, M_Pool *pool) {
+	Ir_Program *program = lowerer->program;
+	u32         count   = lowerer->count;
+
+	u8 *live        = M_PoolPush(pool, count + 1, 1, M_CLEAR_MEMORY);
+	u8 *overwritten = M_PoolPush(pool, lowerer->layout->slot_count + 1, 1, M_CLEAR_MEMORY);
+	u32 *remap      = M_PoolPush(pool, sizeof(u32) * (count + 1), _Alignof(u32), 0);
+
+	if (!live || !overwritten || !remap)
+		return false;
+
+	if (program->result != IR_VALUE_NONE)
+		live[program->result] = true;
+
+	for (u32 index = count; index-- > 0;) {
+		Ir_Instruction *ins = &lowerer->instructions[index];
+
+		if (ins->op == Ir_Op_STORE) {
+			if (overwritten[ins->slot]) {
+				program->stats.dead_stores += 1;
+				continue;
+			}
+			live[index] = true;
+			if (!(ins->flags & IR_MAY_FAIL))
+				overwritten[ins->slot] = true;
+		}
+
+		if (ins->flags & IR_TRAPS)
+			live[index] = true;
+
+		if (!live[index])
+			continue;
+
+		switch (ins->op) {
+		case Ir_Op_CONSTANT: break;
+		case Ir_Op_LOAD:     overwritten[ins->slot] = false; break;
+		case Ir_Op_CONVERT:  live[ins->a] = true; break;
+		case Ir_Op_UNARY:    live[ins->a] = true; break;
+		case Ir_Op_BINARY:   live[ins->a] = true; live[ins->b] = true; break;
+		case Ir_Op_STORE:    live[ins->a] = true; break;
+		NoDefaultCase();
+		}
+	}
+
+	// Operands come before their users, so the survivors move down in place
+	u32 kept = 0;
+	for (u32 index = 0; index < count; ++index) {
+		if (!live[index]) {
+			if (lowerer->instructions[index].op != Ir_Op_STORE)
+				program->stats.dead += 1;
+			continue;
+		}
+
+		Ir_Instruction *ins = &lowerer->instructions[kept];
+		*ins = lowerer->instructions[index];
+
+		if (ins->op != Ir_Op_CONSTANT && ins->op != Ir_Op_LOAD)
+			ins->a = remap[ins->a];
+		if (ins->op == Ir_Op_BINARY)
+			ins->b = remap[ins->b];
+
+		remap[index] = kept++;
+	}
+
+	if (program->result != IR_VALUE_NONE)
+		program->result = remap[program->result];
+	program->count = kept;
+	return true;
+}
+
+bool IrLower(Ir_Program *program, Frame_Layout *layout, Expr_Array statements, M_Pool *pool) {
+	memset(program, 0, sizeof(*program));
+	program->layout = layout;
+	program->result = IR_VALUE_NONE;
+
+	// A node gives at most one instruction, an assignment a store and a conversion
+	umem capacity = 1;
+	for (imem index = 0; index < statements.count; ++index) {
+		umem nodes = ExprNodeCount(statements.data[index]);
+		if (!nodes)
+			return false;
+		capacity += nodes * 2;
+	}
+
+	program->instructions = M_PoolPush(pool, sizeof(Ir_Instruction) * capacity, _Alignof(Ir_Instruction), 0);
+	if (!program->instructions)
+		return false;
+
+	u32 table_size = 16;
+	while (table_size < capacity * 2)
+		table_size *= 2;
+
+	// Only the instructions outlive lowering
+	M_Temp temp = M_PoolBeginTemporaryMemory(pool);
+
+	Ir_Lowerer lowerer = { 0 };
+	lowerer.program      = program;
+	lowerer.layout       = layout;
+	lowerer.instructions = program->instructions;
+	lowerer.capacity     = (u32)capacity;
+	lowerer.mask         = table_size - 1;
+	lowerer.table        = M_PoolPush(pool, sizeof(u32) * table_size, _Alignof(u32), M_CLEAR_MEMORY);
+	lowerer.current      = M_PoolPush(pool, sizeof(u32) * (layout->slot_count + 1), _Alignof(u32), 0);
+	lowerer.valid        = lowerer.table && lowerer.current;
+
+	if (!lowerer.valid) {
+		M_PoolEndTemporaryMemory(pool, &temp);
+		return false;
+	}
+
+	memset(lowerer.current, 0xff, sizeof(u32) * layout->slot_count);
+	M_StackInit(&lowerer.stack, IR_STACK_MAX);
+
+	for (imem index = 0; index < statements.count && lowerer.valid; ++index)
+		program->result = IrLowerExpr(&lowerer, statements.data[index]);
+
+	M_StackFree(&lowerer.stack);
+
+	if (lowerer.valid)
+		lowerer.valid = IrSweep(&lowerer, pool);
+
+	M_PoolEndTemporaryMemory(pool, &temp);
+	return lowerer.valid;
+}
+
+Value IrRun(Ir_Program *program, Parser *parser, u8 *frame, Value *values) {
+	Frame_Layout *layout = program->layout;
+
+	for (u32 index = 0; index < program->count; ++index) {
+		Ir_Instruction *ins = &program->instructions[index];
+
+		switch (ins->op) {
+		case Ir_Op_CONSTANT:
+		{
+			values[index] = ins->constant;
+		} break;
+
+		case Ir_Op_LOAD:
+		{
+			values[index] = FrameLoad(layout, frame, ins->slot);
+		} break;
+
+		case Ir_Op_CONVERT:
+		{
+			values[index] = ValueConvert(ins->type, values[ins->a]);
+		} break;
+
+		case Ir_Op_UNARY:
+		{
+			values[index] = EvalUnaryOperator(ins->symbol, values[ins->a]);
+		} break;
+
+		case Ir_Op_BINARY:
+		{
+			bool is_signed = ins->type->id == Expr_Type_Id_INTEGER &&
+				(((Expr_Type_Integer *)ins->type)->flags & EXPR_TYPE_INTEGER_IS_SIGNED);
+			values[index] = EvalBinaryOperator(parser, ins->range, ins->symbol, is_signed, values[ins->a], values[ins->b]);
+		} break;
+
+		case Ir_Op_STORE:
+		{
+			FrameStore(layout, frame, ins->slot, values[ins->a]);
+			values[index] = (Value){ Value_Kind_NONE };
+		} break;
+
+		NoDefaultCase();
+		}
+	}
+
+	if (program->result == IR_VALUE_NONE)
+		return (Value){ Value_Kind_NONE };
+	return values[program->result];
+}
+
+static void IrDumpValue(Dump_Buffer *out, u32 value) {
+	DumpText(out, " %");
+	DumpUnsigned(out, value);
+}
+
+static void IrDumpSlot(Dump_Buffer *out, Frame_Layout *layout, u32 slot) {
+	DumpText(out, " #");
+	DumpUnsigned(out, slot);
+	DumpText(out, " (");
+	DumpString(out, layout->slots[slot].name);
+	DumpChar(out, ')');
+}
+
+void IrDump(Dump_Buffer *out, Ir_Program *program) {
+	for (u32 index = 0; index < program->count; ++index) {
+		Ir_Instruction *ins = &program->instructions[index];
+
+		if (ins->op != Ir_Op_STORE) {
+			DumpChar(out, '%');
+			DumpUnsigned(out, index);
+			DumpText(out, " = ");
+		}
+
+		switch (ins->op) {
+		case Ir_Op_CONSTANT:
+		{
+			DumpText(out, "const ");
+			if (ins->constant.kind == Value_Kind_FLOAT)
+				DumpFloat(out, ins->constant.floating);
+			else
+				DumpUnsigned(out, ins->constant.integer);
+		} break;
+
+		case Ir_Op_LOAD:
+		{
+			DumpText(out, "load");
+			IrDumpSlot(out, program->layout, ins->slot);
+		} break;
+
+		case Ir_Op_CONVERT:
+		{
+			DumpText(out, "convert");
+			IrDumpValue(out, ins->a);
+		} break;
+
+		case Ir_Op_UNARY:
+		{
+			DumpText(out, ExprSymbolName(ins->symbol));
+			IrDumpValue(out, ins->a);
+		} break;
+
+		case Ir_Op_BINARY:
+		{
+			DumpText(out, ExprSymbolName(ins->symbol));
+			IrDumpValue(out, ins->a);
+			IrDumpValue(out, ins->b);
+			if (ins->flags & IR_TRAPS)
+				DumpText(out, " !");
+		} break;
+
+		case Ir_Op_STORE:
+		{
+			DumpText(out, "store");
+			IrDumpSlot(out, program->layout, ins->slot);
+			IrDumpValue(out, ins->a);
+		} break;
+
+		NoDefaultCase();
+		}
+
+		DumpChar(out, '\n');
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Eval.h"
+#include "Dump.h"
+
+//
+// Straight-line SSA form of statements over a resolved frame. Every instruction defines one
+// value, numbered by its position, and only reads values defined before it. Loads and stores
+// are the only instructions that touch the frame, so a backend runs the instructions front
+// to back with one register per value, or translates them one by one.
+//
+// Values are numbered while lowering: an instruction that computes what an earlier one
+// already did is not emitted again and its users read the earlier value, across statements
+// as well. A name read after an assignment takes the assigned value without a load. Once
+// all statements are in, stores that a later store overwrites before anything reads the slot
+// are dropped, and so is every instruction whose value nothing live reads.
+//
+// Values mean what they mean to the tree evaluator: 64 bit integers or doubles, or NONE out
+// of a failed division, which makes everything computed from it NONE as well. Storing NONE
+// leaves a slot as it was, so a later store only kills an earlier one when it can not be
+// NONE, and a name read after a store that may be NONE is loaded again. Divisions that may
+// fail are never merged or dropped, every division by zero is still reported, in order.
+//
+
+typedef enum Ir_Op {
+	Ir_Op_CONSTANT,
+	Ir_Op_LOAD,     // slot
+	Ir_Op_CONVERT,  // a, as a slot of the instruction's type holds it once stored, see ValueConvert
+	Ir_Op_UNARY,    // symbol a
+	Ir_Op_BINARY,   // a symbol b, the symbols of Expr_Binary_Operator
+	Ir_Op_STORE,    // slot = a, the value of a store is NONE
+
+	Ir_Op_COUNT
+} Ir_Op;
+
+enum Ir_Flags {
+	IR_MAY_FAIL = 0x1, // the value may be NONE
+	IR_TRAPS    = 0x2, // an integer division by something that may be zero
+};
+
+#define IR_VALUE_NONE ((u32)-1)
+
+typedef struct Ir_Instruction {
+	u8          op;
+	u8          flags;
+	u32         symbol;
+	u32         slot;
+	u32         a;
+	u32         b;
+	Expr_Type * type;     // of the value, of the slot for LOAD and STORE
+	Value       constant;
+	Token_Range range;    // of the node it came from, where a division reports
+} Ir_Instruction;
+
+typedef struct Ir_Stats {
+	u32 nodes;       // lowered
+	u32 merged;      // instructions not emitted because an earlier one computes the same
+	u32 forwarded;   // reads served from an earlier store or load
+	u32 dead_stores; // overwritten or storing what the slot already holds
+	u32 dead;        // other instructions nothing read
+} Ir_Stats;
+
+typedef struct Ir_Program {
+	Frame_Layout *   layout;
+	Ir_Instruction * instructions;
+	u32              count;
+	u32              result; // value of the last statement, IR_VALUE_NONE without statements
+	Ir_Stats         stats;
+} Ir_Program;
+
+// Lowers statements that went through FrameResolve. False when one of them has no place in
+// the frame, an assignment to something other than a name or a name without a slot, which
+// FrameResolve has reported already, and when counting or walking the nodes or a push to a
+// pool with a budget runs out of memory. The instructions are pushed to `pool`.
+bool  IrLower(Ir_Program *program, Frame_Layout *layout, Expr_Array statements, M_Pool *pool);
+
+// Runs the program over `frame`, which ends up as EvalExpr over each statement in order would
+// leave it, with the same diagnostics. `values` holds program->count registers. Returns the
+// value of the last statement.
+Value IrRun(Ir_Program *program, Parser *parser, u8 *frame, Value *values);
+
+// One instruction per line, "%index = op operands", with a trailing ! on divisions that may fail
+void  IrDump(Dump_Buffer *out, Ir_Program *program);
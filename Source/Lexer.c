@@ -1,196 +1,178 @@
 #include "Lexer.h"
+#include "LexerTables.h"
+#include "Number.h"
+#include "Thread.h"
+#include "Utf8.h"
 
-#include <string.h>
 #include <stdlib.h>
+#include <string.h>
 
 static const char *TokenKindNames[] = {
-	"True", "False", "Integer", "Plus", "Minus", "Multiply", "Divide", "BracketOpen", "BracketClose", "Equals", "Identifier"
+	"True", "False", "Integer", "Float", "Plus", "Minus", "Multiply", "Divide", "BracketOpen", "BracketClose", "Equals", "Identifier"
 };
 
 static_assert(ArrayCount(TokenKindNames) == Token_Kind_END, "");
 
-static int UTF8Advance(u8 *beg, u8 *end) {
-	u32 codepoint = *beg;
-
-	int advance;
-	if ((codepoint & 0x80) == 0x00) {
-		advance = 1;
-	} else if ((codepoint & 0xe0) == 0xc0) {
-		advance = 2;
-	} else if ((codepoint & 0xf0) == 0xe0) {
-		advance = 3;
-	} else if ((codepoint & 0xF8) == 0xf0) {
-		advance = 4;
-	}
+static void LexPlace(Lexer *l, const Source_File *file) {
+	l->offset   = file ? file->base : 0;
+	l->limit    = file ? (umem)file->base + file->span - 1 : (Source_Loc)-1;
+	l->mark.pos = l->offset;
+	l->mark.row = 1;
+}
 
-	if (beg + advance < end) {
-		end = beg + advance;
-	}
+void LexInit(Lexer *l, String input, const Source_File *file, M_Pool *pool) {
+	memset(l, 0, sizeof(*l));
+	LexPlace(l, file);
 
-	// Validate and set actual advance
-	advance = 1;
-	u8 *pos = beg + 1;
-	for (; pos < end; ++pos) {
-		if (((*pos) & 0xc0) != 0x80)
-			break; // invalid continuation character
-		advance += 1;
-	}
+	// Lexing stops at the first invalid sequence, everything before it still makes tokens
+	umem valid  = Utf8Validate(input.data, input.count, nullptr);
 
-	return advance;
+	l->first    = input.data;
+	l->last     = input.data + valid;
+	l->cursor   = l->first;
+	l->pool     = pool;
+	l->end      = input.data + input.count;
+	l->invalid  = l->last != l->end;
 }
 
-typedef enum Lex_Prod {
-	Lex_Prod_None,
-	Lex_Prod_Reset,
-	Lex_Prod_Token,
-	Lex_Prod_Integer,
-	Lex_Prod_Symbol,
-	Lex_Prod_Identifier,
-} Lex_Prod;
-
-typedef enum Lex_State {
-	Lex_State_Error,
-	Lex_State_Whitespace,
-	Lex_State_Plus,
-	Lex_State_Minus,
-	Lex_State_Multiply,
-	Lex_State_Divide,
-	Lex_State_Bracket_Open,
-	Lex_State_Bracket_Close,
-	Lex_State_Equals,
-	Lex_State_Integer,
-	Lex_State_Identifier,
-	Lex_State_Identifier_Cont1,
-	Lex_State_Identifier_Cont2,
-	Lex_State_Identifier_Cont3,
-
-	Lex_State_COUNT
-} Lex_State;
-
-static_assert(Lex_State_COUNT <= 256, "");
-
-static Lex_State  TransitionTable[Lex_State_COUNT][255];
-static Lex_Prod   ProductionTable[Lex_State_COUNT][Lex_State_COUNT];
-static Token_Kind TokenKindMap[Lex_State_COUNT];
-
-static void LexUpdateTransition(const Lex_State *const entries, int count, Lex_State next, u8 ch) {
-	for (int i = 0; i < count; ++i) {
-		Lex_State entry = entries[i];
-		TransitionTable[entry][ch] = next;
-	}
+void LexInitStream(Lexer *l, Lex_Refill refill, void *context, umem chunk, Source_File *file, M_Pool *pool) {
+	memset(l, 0, sizeof(*l));
+	LexPlace(l, file);
+
+	l->file     = file;
+	l->refill   = refill;
+	l->context  = context;
+	l->chunk    = chunk;
+	l->pool     = pool;
+
+	// The window only grows past `chunk` while a single token is longer than what is left of it,
+	// so it is bounded by chunk size plus the longest token
+	l->window   = M_ArenaAllocate(chunk + LEX_MAX_TOKEN_SIZE, chunk);
+	l->first    = (u8 *)l->window + sizeof(M_Arena);
+	l->last     = l->first;
+	l->end      = l->first;
+	l->cursor   = l->first;
 }
 
-static void LexUpdateTransitionRange(const Lex_State *const entries, int count, Lex_State next, u8 first, u8 last) {
-	for (u8 i = first; i <= last; ++i) {
-		LexUpdateTransition(entries, count, next, i);
+void LexFree(Lexer *l) {
+	if (l->window) {
+		M_ArenaFree(l->window);
+		l->window = nullptr;
 	}
 }
 
-void LexInitTable(void) {
-	const u8 Whitespaces[] = " \t\n\r\v\f";
+static void LexError(Lexer *l, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(l->error, sizeof(l->error), fmt, args);
+	va_end(args);
+}
+
+// Moves the limit of a stream up to at least `to`, false once its file can not grow
+static bool LexClaim(Lexer *l, umem to) {
+	if (!l->file || !SourceGrow(SourceGlobal(), l->file, to - l->file->base))
+		return false;
+	l->limit = (umem)l->file->base + l->file->span - 1;
+	return true;
+}
 
-	// Single Byte Tokens
-	for (int i = 0; i < Lex_State_COUNT; ++i) {
-		for (int j = 0; j < ArrayCount(Whitespaces); ++j) {
-			TransitionTable[i][Whitespaces[j]] = Lex_State_Whitespace;
+static void LexAdvanceMark(Lexer *l, u8 *to) {
+	u8 *pos = l->first + (l->mark.pos - l->offset);
+	for (; pos < to; ++pos) {
+		if (*pos != '\n') {
+			l->mark.column += 1;
+		} else {
+			l->mark.column = 0;
+			l->mark.row += 1;
 		}
+	}
+	l->mark.pos = l->offset + (to - l->first);
+}
 
-		TransitionTable[i]['+'] = Lex_State_Plus;
-		TransitionTable[i]['-'] = Lex_State_Minus;
-		TransitionTable[i]['*'] = Lex_State_Multiply;
-		TransitionTable[i]['/'] = Lex_State_Divide;
-		TransitionTable[i]['('] = Lex_State_Bracket_Open;
-		TransitionTable[i][')'] = Lex_State_Bracket_Close;
-		TransitionTable[i]['='] = Lex_State_Equals;
+// Slides the bytes of the token being scanned to the front of the window and reads the next chunk behind it
+static bool LexRefill(Lexer *l, u8 **beg, u8 **end) {
+	if (l->invalid) {
+		LexError(l, "invalid UTF-8");
+		return false;
 	}
 
-	const Lex_State IntegerEntries[] = {
-		Lex_State_Plus, Lex_State_Minus, Lex_State_Multiply, Lex_State_Divide, 
-		Lex_State_Bracket_Open, Lex_State_Bracket_Close,
-		Lex_State_Whitespace, Lex_State_Integer
-	};
-
-	LexUpdateTransitionRange(IntegerEntries, ArrayCount(IntegerEntries), Lex_State_Integer, '0', '9');
-
-	const Lex_State IdentifierEntries[] = {
-		Lex_State_Plus, Lex_State_Minus, Lex_State_Multiply, Lex_State_Divide,
-		Lex_State_Bracket_Open, Lex_State_Bracket_Close, Lex_State_Equals,
-		Lex_State_Whitespace, Lex_State_Identifier
-	};
-
-	LexUpdateTransition(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, '_');
-	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, 'a', 'z');
-	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, 'A', 'Z');
-
-	const Lex_State IdentifierMids[] = { Lex_State_Identifier };
-	LexUpdateTransitionRange(IdentifierMids, ArrayCount(IdentifierMids), Lex_State_Identifier, '0', '9');
-
-	// 2 byte unicode
-	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier_Cont1, 192, 223);
-
-	// 3 bytes unicode
-	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier_Cont2, 224, 239);
-
-	// 4 bytes unicode
-	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier_Cont3, 240, 247);
-
-	// continuation bytes
-	const Lex_State IdentifierContEntries[] = { Lex_State_Identifier_Cont1 };
-	LexUpdateTransitionRange(IdentifierContEntries, ArrayCount(IdentifierContEntries), Lex_State_Identifier, 128, 191);
-
-	const Lex_State IdentifierCont1Entries[] = { Lex_State_Identifier_Cont2 };
-	LexUpdateTransitionRange(IdentifierCont1Entries, ArrayCount(IdentifierCont1Entries), Lex_State_Identifier_Cont1, 128, 191);
-
-	const Lex_State IdentifierCont2Entries[] = { Lex_State_Identifier_Cont3 };
-	LexUpdateTransitionRange(IdentifierCont2Entries, ArrayCount(IdentifierCont2Entries), Lex_State_Identifier_Cont2, 128, 191);
-
-	for (int i = 0; i < Lex_State_COUNT; ++i) {
-		ProductionTable[i][Lex_State_Error]         = Lex_Prod_Token;
-		ProductionTable[Lex_State_Whitespace][i]    = Lex_Prod_Reset;
-		ProductionTable[Lex_State_Identifier][i]    = Lex_Prod_Identifier;
-		ProductionTable[Lex_State_Integer][i]       = Lex_Prod_Integer;
-		ProductionTable[Lex_State_Plus][i]          = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Minus][i]         = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Multiply][i]      = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Divide][i]        = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Bracket_Open][i]  = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Bracket_Close][i] = Lex_Prod_Symbol;
-		ProductionTable[Lex_State_Equals][i]        = Lex_Prod_Symbol;
+	if (!l->refill || !l->window->reserved)
+		return false;
+
+	LexAdvanceMark(l, *beg);
+
+	umem keep = l->last - *beg;
+	umem need = keep + l->chunk;
+
+	if (!M_EnsureCommit(l->window, sizeof(M_Arena) + need)) {
+		LexError(l, "token is too long");
+		return false;
 	}
 
-	ProductionTable[Lex_State_Identifier][Lex_State_Identifier]       = Lex_Prod_None;
-	ProductionTable[Lex_State_Identifier][Lex_State_Identifier_Cont1] = Lex_Prod_None;
-	ProductionTable[Lex_State_Identifier][Lex_State_Identifier_Cont2] = Lex_Prod_None;
-	ProductionTable[Lex_State_Identifier][Lex_State_Identifier_Cont3] = Lex_Prod_None;
-	ProductionTable[Lex_State_Integer][Lex_State_Integer]             = Lex_Prod_None;
-
-	for (int i = 0; i < Lex_State_COUNT; ++i)
-		TokenKindMap[i] = Token_Kind_END;
-
-	TokenKindMap[Lex_State_Plus]          = Token_Kind_Plus;
-	TokenKindMap[Lex_State_Minus]         = Token_Kind_Minus;
-	TokenKindMap[Lex_State_Multiply]      = Token_Kind_Multiply;
-	TokenKindMap[Lex_State_Divide]        = Token_Kind_Divide;
-	TokenKindMap[Lex_State_Bracket_Open]  = Token_Kind_Bracket_Open;
-	TokenKindMap[Lex_State_Bracket_Close] = Token_Kind_Bracket_Close;
-	TokenKindMap[Lex_State_Equals]        = Token_Kind_Equals;
-	TokenKindMap[Lex_State_Integer]       = Token_Kind_Integer;
-	TokenKindMap[Lex_State_Identifier]    = Token_Kind_Identifier;
-}
+	memmove(l->first, *beg, keep);
+	l->offset += *beg - l->first;
 
-void LexInit(Lexer *l, String input, M_Pool *pool) {
-	l->first    = input.data;
-	l->last     = input.data + input.count;
-	l->cursor   = l->first;
-	l->pool     = pool;
-	l->error[0] = 0;
+	umem read = l->refill(l->context, l->first + keep, l->chunk);
+
+	l->last = l->first + keep + read;
+	l->end  = l->last;
+	*beg    = l->first;
+	*end    = l->first + keep;
+
+	// A sequence cut off by the previous chunk is validated again as a whole. Its bytes are
+	// part of the token being scanned, so they are still in the window.
+	u8 * check = *end - l->pending;
+	Assert(check >= *beg);
+
+	umem valid = Utf8Validate(check, l->last - check, read ? &l->pending : nullptr);
+
+	if (check + valid != l->last) {
+		l->last    = check + valid;
+		l->invalid = true;
+
+		if (l->last <= *end) {
+			*end = l->last;
+			LexError(l, "invalid UTF-8");
+			return false;
+		}
+	}
+
+	return read != 0;
 }
 
-static void LexError(Lexer *l, const char *fmt, ...) {
-	va_list args;
-	va_start(args, fmt);
-	vsnprintf(l->error, sizeof(l->error), fmt, args);
-	va_end(args);
+void LexLocation(Lexer *l, umem pos, umem *row, umem *column) {
+	// Outside of streaming mode the mark stays at the start of the input
+	Lex_Location loc = l->mark;
+
+	if (l->refill) {
+		if (pos < l->mark.pos) {
+			// Already slid out of the window, only recently produced tokens can be located
+			loc = l->mark;
+			for (uint i = 0; i < ArrayCount(l->recent); ++i) {
+				if (l->recent[i].pos == pos) {
+					loc = l->recent[i];
+					break;
+				}
+			}
+			*row    = loc.row;
+			*column = loc.column;
+			return;
+		}
+	}
+
+	umem last = l->offset + (l->end - l->first);
+	u8 * data = l->first - l->offset;
+	for (; loc.pos < pos && loc.pos < last; ++loc.pos) {
+		if (data[loc.pos] != '\n') {
+			loc.column += 1;
+		} else {
+			loc.column = 0;
+			loc.row += 1;
+		}
+	}
+
+	*row    = loc.row;
+	*column = loc.column;
 }
 
 bool LexNext(Lexer *l, Token *token) {
@@ -200,77 +182,146 @@ bool LexNext(Lexer *l, Token *token) {
 	u8 *beg = l->cursor;
 	u8 *end = beg;
 
-	for (; end < l->last; ++end) {
-		Lex_State next = TransitionTable[curr][*end];
+	for (;;) {
+		for (; end < l->last; ++end) {
+			Lex_State next = LexTransition[curr][LexCharClass[*end]];
 
-		prod = ProductionTable[curr][next];
+			prod = LexProduction[curr][next];
 
-		if (prod > Lex_Prod_Reset) {
-			break;
+			if (prod > Lex_Prod_Reset) {
+				break;
+			}
+
+			if (prod == Lex_Prod_Reset)
+				beg = end;
+
+			curr = next;
+
+			// Identifiers are the long tokens, all the more with multi byte characters in them.
+			// Every byte that keeps one going continues it, so there is nothing to produce.
+			if (curr == Lex_State_Identifier) {
+				while (end + 1 < l->last && LexTransition[Lex_State_Identifier][LexCharClass[end[1]]] == Lex_State_Identifier)
+					end += 1;
+			}
 		}
 
-		if (prod == Lex_Prod_Reset)
-			beg = end;
+		if (end < l->last)
+			break;
 
-		curr = next;
+		if (!LexRefill(l, &beg, &end)) {
+			if (l->error[0]) {
+				token->kind  = Token_Kind_END;
+				token->range = (Token_Range){ (Source_Loc)Min(l->offset + (end - l->first), l->limit), 0 };
+				return false;
+			}
+
+			// End of input terminates the last token as if followed by whitespace
+			prod = LexProduction[curr][Lex_State_Whitespace];
+			break;
+		}
 	}
 
 	l->cursor    = end;
 
-	token->kind  = TokenKindMap[curr];
-	token->range = (Token_Range){ beg - l->first, end - l->first };
+	token->kind  = LexTokenKind[curr];
+	umem from    = l->offset + (beg - l->first);
+	umem to      = l->offset + (end - l->first);
+
+	// Only streams can run out of their locations, files are given all they need up front.
+	// Past what the location space can give, everything sits on the last location.
+	if (to > l->limit && !LexClaim(l, to)) {
+		from = Min(from, l->limit);
+		to   = Min(to, l->limit);
+	}
+
+	token->range = (Token_Range){ (Source_Loc)from, (u32)(to - from) };
 
 	memset(&token->value, 0, sizeof(token->value));
 
-	if (curr == Lex_State_Error) {
-		int advance = UTF8Advance(l->cursor, l->last);
+	if (l->refill && curr != Lex_State_Whitespace) {
+		LexAdvanceMark(l, beg);
+		l->recent[l->recent_index] = l->mark;
+		l->recent_index = (l->recent_index + 1) % ArrayCount(l->recent);
+	}
+
+	if (prod == Lex_Prod_Error) {
+		token->kind = Token_Kind_END;
+
+		if (end == l->last) {
+			token->range = (Token_Range){ RangeEnd(token->range), 0 };
+			LexError(l, "unexpected end of input");
+			return false;
+		}
+
+		int advance = (int)Min(Utf8SequenceLength(*l->cursor), (umem)(l->last - l->cursor));
+		token->range = (Token_Range){ RangeEnd(token->range), (u32)advance };
 		LexError(l, "bad character: \"%.*s\"", advance, l->cursor);
 		l->cursor += advance;
 		return false;
 	}
 
 	if (prod == Lex_Prod_Integer) {
-		u8 *start = beg;
+		Number_Status status = NumberParseInteger(beg, end, &token->value.integer);
 
-		while (start < end && *start == '0') {
-			start += 1;
+		if (status == Number_Status_NO_DIGITS) {
+			token->kind = Token_Kind_END;
+			LexError(l, "integer literal has no digits");
+			return false;
 		}
 
-		int count = (int)(end - start);
-
-		if (count > 255) {
+		if (status == Number_Status_OVERFLOW) {
 			token->kind = Token_Kind_END;
 			LexError(l, "integer literal is too big");
 			return false;
 		}
 
-		char buff[256];
-		memcpy(buff, start, count);
-		buff[count] = 0;
+		return true;
+	}
 
-		char *endptr = nullptr;
-		u64 value    = strtoull(buff, &endptr, 10);
+	if (prod == Lex_Prod_Float) {
+		Number_Status status = NumberParseFloat(beg, end, &token->value.floating);
 
-		if (endptr != buff + count || errno == ERANGE) {
+		if (status == Number_Status_NO_DIGITS) {
 			token->kind = Token_Kind_END;
-			LexError(l, "integer literal is too big");
+			LexError(l, "floating point literal is malformed");
 			return false;
 		}
 
-		token->value.integer = value;
+		if (status == Number_Status_OVERFLOW) {
+			token->kind = Token_Kind_END;
+			LexError(l, "floating point literal is too big");
+			return false;
+		}
 
 		return true;
 	}
 
 	if (prod == Lex_Prod_Symbol) {
-		Assert(token->range.to - token->range.from == 1);
+		Assert(token->range.length == 1);
 		token->value.symbol = *beg;
 		return true;
 	}
 
 	if (prod == Lex_Prod_Identifier) {
 		umem count = end - beg;
-		u8 * data  = M_PoolPush(l->pool, count + 1, 1, 0);
+
+		// Keywords carry nothing but their kind, there is no text to keep
+		if (count >= LEX_KEYWORD_MIN_LENGTH && count <= LEX_KEYWORD_MAX_LENGTH) {
+			const Lex_Keyword *keyword = &LexKeywords[LexKeywordHash(beg, count, LEX_KEYWORD_FIRST, LEX_KEYWORD_LAST, LEX_KEYWORD_MASK)];
+			if (keyword->length == count && memcmp(keyword->text, beg, count) == 0) {
+				token->kind          = keyword->kind;
+				token->value.integer = keyword->kind == Token_Kind_True;
+				return true;
+			}
+		}
+
+		u8 *data = M_PoolPush(l->pool, count + 1, 1, 0);
+		if (!data) {
+			token->kind  = Token_Kind_END;
+			l->exhausted = true;
+			LexError(l, "out of memory");
+			return false;
+		}
 
 		memcpy(data, beg, count);
 		data[count] = 0;
@@ -282,33 +333,313 @@ bool LexNext(Lexer *l, Token *token) {
 	return true;
 }
 
-void LexDump(FILE *out, const Token *token) {
-	const char *name = TokenKindNames[token->kind];
-	fprintf(out, ".%s ", name);
+void LexDump(Dump_Buffer *out, const Token *token) {
+	DumpChar(out, '.');
+	DumpText(out, TokenKindNames[token->kind]);
+	DumpChar(out, ' ');
 
 	switch (token->kind) {
+	case Token_Kind_True:
+		DumpText(out, "true");
+		break;
+	case Token_Kind_False:
+		DumpText(out, "false");
+		break;
 	case Token_Kind_Integer:
-		fprintf(out, "%zu", token->value.integer);
+		DumpUnsigned(out, token->value.integer);
+		break;
+	case Token_Kind_Float:
+		DumpFloat(out, token->value.floating);
 		break;
 	case Token_Kind_Identifier:
-		fprintf(out, StrFmt, StrArg(token->value.string));
+		DumpString(out, token->value.string);
 		break;
 	case Token_Kind_Plus:
 	case Token_Kind_Minus:
 	case Token_Kind_Multiply:
 	case Token_Kind_Divide:
-		fprintf(out, "%c", (char)token->value.symbol);
+		DumpChar(out, (char)token->value.symbol);
 		break;
 	case Token_Kind_Bracket_Open:
-		fprintf(out, "(");
+		DumpChar(out, '(');
 		break;
 	case Token_Kind_Bracket_Close:
-		fprintf(out, ")");
+		DumpChar(out, ')');
 		break;
 	case Token_Kind_Equals:
-		fprintf(out, "=");
+		DumpChar(out, '=');
+		break;
+	}
+
+	DumpChar(out, '\n');
+}
+
+void LexDumpBinary(Dump_Buffer *out, const Token *token) {
+	DumpChar(out, (char)token->kind);
+
+	switch (token->kind) {
+	case Token_Kind_Integer:
+	case Token_Kind_Float:
+		DumpFixed64(out, token->value.integer);
+		break;
+	case Token_Kind_Identifier:
+		DumpVarint(out, (u64)token->value.string.count);
+		DumpString(out, token->value.string);
 		break;
 	}
+}
+
+//
+//
+//
+
+struct Lex_Piece {
+	u32      index;
+	u32 *    first_failure; // lowest index of a failed piece, shared by all pieces
+	String   input;
+	umem     offset; // global location of the first byte
+	M_Pool   pool;
+	M_Arena *arena;
+	Token *  data;
+	imem     count;
+	Token *  target; // where the tokens go when joining
+	bool     failed;
+	Token    error_token;
+	char     error[1024];
+	Thread   thread;
+};
+
+// Commit the token buffer in large steps, every commit is a system call that
+// serializes with the other threads on the address space lock
+#define LEX_PARALLEL_COMMIT MegaBytes(4)
+
+static void LexPieceRun(void *argument) {
+	Lex_Piece *piece = argument;
+
+	// At most one token per byte, the reservation is only address space
+	umem reserve = (piece->input.count + 1) * sizeof(Token) + sizeof(M_Arena);
+
+	piece->arena = M_ArenaAllocate(reserve, 0);
+	piece->data  = nullptr;
+	piece->count = 0;
+
+	// A failed allocation hands back the shared empty arena, pushing to it would write to
+	// memory every other piece that failed sees as well
+	if (!piece->arena->reserved) {
+		piece->failed = true;
+		snprintf(piece->error, sizeof(piece->error), "out of memory");
+		return;
+	}
+
+	piece->data = (Token *)M_PushSizeAligned(piece->arena, 0, _Alignof(Token), 0);
+
+	Lexer lexer;
+	LexInit(&lexer, piece->input, nullptr, &piece->pool);
+	lexer.offset   = piece->offset;
+	lexer.mark.pos = piece->offset;
+
+	umem   base  = (u8 *)piece->data - (u8 *)piece->arena;
+	Token *limit = piece->data;
+
+	for (;;) {
+		if (piece->data + piece->count == limit) {
+			umem used = base + piece->count * sizeof(Token);
+			umem want = Min(used + LEX_PARALLEL_COMMIT, piece->arena->reserved);
+
+			if (!M_EnsureCommit(piece->arena, want)) {
+				Token_Range last = piece->count ? piece->data[piece->count - 1].range : (Token_Range){ (Source_Loc)piece->offset, 0 };
+				piece->failed      = true;
+				piece->error_token = (Token){ .kind = Token_Kind_END, .range = { last.from + last.length, 0 } };
+				snprintf(piece->error, sizeof(piece->error), "out of memory");
+				AtomicMin32(piece->first_failure, piece->index);
+				return;
+			}
+
+			limit = piece->data + (want - base) / sizeof(Token);
+		}
+
+		// Nothing after an earlier error is going to be used
+		if ((piece->count & 4095) == 0 && AtomicLoad32(piece->first_failure) < piece->index)
+			return;
+
+		Token *token = &piece->data[piece->count];
+
+		if (!LexNext(&lexer, token)) {
+			piece->failed      = true;
+			piece->error_token = *token;
+			memcpy(piece->error, lexer.error, sizeof(piece->error));
+			AtomicMin32(piece->first_failure, piece->index);
+			return;
+		}
+
+		if (token->kind == Token_Kind_END)
+			break;
+
+		piece->count += 1;
+	}
+}
+
+static void LexPieceJoin(void *argument) {
+	Lex_Piece *piece = argument;
+	if (piece->count)
+		memcpy(piece->target, piece->data, sizeof(Token) * piece->count);
+	M_ArenaFree(piece->arena);
+	piece->arena = nullptr;
+}
+
+static bool LexIsSplit(u8 byte) {
+	return LexTransition[Lex_State_Whitespace][LexCharClass[byte]] == Lex_State_Whitespace;
+}
+
+bool LexParallel(Lex_Tokens *tokens, String input, const Source_File *file, u32 thread_count) {
+	memset(tokens, 0, sizeof(*tokens));
+
+	umem size = (umem)input.count;
+	if (!thread_count)
+		thread_count = ThreadCoreCount();
+	thread_count = (u32)Clamp(1, Max(size / LEX_PARALLEL_MIN_PIECE, 1), thread_count);
+
+	tokens->pieces = calloc(thread_count, sizeof(Lex_Piece));
+	if (!tokens->pieces) {
+		tokens->failed = true;
+		snprintf(tokens->error, sizeof(tokens->error), "out of memory");
+		return false;
+	}
+
+	u32  first_failure = (u32)-1;
+	umem base          = file ? file->base : 0;
+
+	// Each piece ends just after the first whitespace byte past its share of the input,
+	// pieces that find none merge into the next one
+	umem from = 0;
+	for (u32 index = 0; index < thread_count && from < size; ++index) {
+		umem to = size;
+
+		if (index + 1 < thread_count) {
+			to = Max(from, size / thread_count * (index + 1));
+			while (to < size && !LexIsSplit(input.data[to]))
+				to += 1;
+			to = Min(to + 1, size);
+		}
+
+		Lex_Piece *piece = &tokens->pieces[tokens->piece_count];
+		piece->index         = tokens->piece_count++;
+		piece->first_failure = &first_failure;
+		piece->input         = (String){ (imem)(to - from), input.data + from };
+		piece->offset        = base + from;
+		M_PoolInit(&piece->pool, MegaBytes(64));
+
+		from = to;
+	}
+
+	// The calling thread lexes the first piece itself
+	for (u32 index = 1; index < tokens->piece_count; ++index) {
+		Lex_Piece *piece = &tokens->pieces[index];
+		if (!ThreadStart(&piece->thread, LexPieceRun, piece))
+			LexPieceRun(piece);
+	}
+
+	if (tokens->piece_count)
+		LexPieceRun(&tokens->pieces[0]);
+
+	for (u32 index = 1; index < tokens->piece_count; ++index) {
+		if (tokens->pieces[index].thread.handle)
+			ThreadJoin(&tokens->pieces[index].thread);
+	}
+
+	// Everything after the first failing piece is dropped, the sequential lexer
+	// would have stopped at the same token
+	u32 used = 0;
+	for (; used < tokens->piece_count; ++used) {
+		Lex_Piece *piece = &tokens->pieces[used];
+		tokens->count += piece->count;
+
+		if (piece->failed) {
+			tokens->failed      = true;
+			tokens->error_range = piece->error_token.range;
+			memcpy(tokens->error, piece->error, sizeof(tokens->error));
+			used += 1;
+			break;
+		}
+	}
+
+	if (used == 1 && tokens->pieces[0].data) {
+		// A single piece already holds the tokens in order, the END token fits its reservation
+		Lex_Piece *piece = &tokens->pieces[0];
+		umem       end   = (u8 *)(piece->data + piece->count + 1) - (u8 *)piece->arena;
+
+		if (M_EnsureCommit(piece->arena, end)) {
+			tokens->arena = piece->arena;
+			tokens->data  = piece->data;
+			piece->arena  = nullptr;
+		}
+	}
+
+	if (!tokens->data) {
+		umem reserve  = (tokens->count + 1) * sizeof(Token) + sizeof(M_Arena);
+		tokens->arena = M_ArenaAllocate(reserve, reserve);
+		tokens->data  = (Token *)M_PushSizeAligned(tokens->arena, (tokens->count + 1) * sizeof(Token), _Alignof(Token), 0);
+
+		if (!tokens->data) {
+			tokens->failed = true;
+			tokens->count  = 0;
+			snprintf(tokens->error, sizeof(tokens->error), "out of memory");
+			LexTokensFree(tokens);
+			return false;
+		}
+
+		Token *target = tokens->data;
+		for (u32 index = 0; index < used; ++index) {
+			tokens->pieces[index].target = target;
+			target += tokens->pieces[index].count;
+		}
+
+		for (u32 index = 1; index < used; ++index) {
+			Lex_Piece *piece = &tokens->pieces[index];
+			if (!ThreadStart(&piece->thread, LexPieceJoin, piece))
+				LexPieceJoin(piece);
+		}
+
+		if (used)
+			LexPieceJoin(&tokens->pieces[0]);
+
+		for (u32 index = 1; index < used; ++index) {
+			if (tokens->pieces[index].thread.handle)
+				ThreadJoin(&tokens->pieces[index].thread);
+		}
+	}
+
+	for (u32 index = 0; index < tokens->piece_count; ++index) {
+		if (tokens->pieces[index].arena) {
+			M_ArenaFree(tokens->pieces[index].arena);
+			tokens->pieces[index].arena = nullptr;
+		}
+	}
+
+	Token *end = &tokens->data[tokens->count];
+	memset(end, 0, sizeof(*end));
+	end->kind  = Token_Kind_END;
+	end->range = tokens->failed ? tokens->error_range : (Token_Range){ (Source_Loc)(base + size), 0 };
+
+	return !tokens->failed;
+}
+
+void LexTokensFree(Lex_Tokens *tokens) {
+	for (u32 index = 0; index < tokens->piece_count; ++index) {
+		Lex_Piece *piece = &tokens->pieces[index];
+		if (piece->arena)
+			M_ArenaFree(piece->arena);
+		M_PoolFree(&piece->pool);
+	}
+
+	if (tokens->arena)
+		M_ArenaFree(tokens->arena);
+
+	free(tokens->pieces);
 
-	fprintf(out, "\n");
+	tokens->pieces      = nullptr;
+	tokens->piece_count = 0;
+	tokens->arena       = nullptr;
+	tokens->data        = nullptr;
+	tokens->count       = 0;
 }
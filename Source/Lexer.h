@@ -1,6 +1,8 @@
 #pragma once
 #include "Platform.h"
 #include "Pool.h"
+#include "Source.h"
+#include "Dump.h"
 
 #include <stdio.h>
 
@@ -8,6 +10,7 @@ typedef enum Token_Kind {
 	Token_Kind_True,
 	Token_Kind_False,
 	Token_Kind_Integer,
+	Token_Kind_Float,
 	Token_Kind_Plus,
 	Token_Kind_Minus,
 	Token_Kind_Multiply,
@@ -20,11 +23,16 @@ typedef enum Token_Kind {
 	Token_Kind_END,
 } Token_Kind;
 
+// Locations are global, see Source.h, so a range alone tells which file it is in
 typedef struct Token_Range {
-	umem from;
-	umem to;
+	Source_Loc from;
+	u32        length;
 } Token_Range;
 
+inproc Source_Loc RangeEnd(Token_Range range) {
+	return range.from + range.length;
+}
+
 typedef union Token_Value {
 	u32    symbol;
 	u64    integer;
@@ -38,15 +46,88 @@ typedef struct Token {
 	Token_Value value;
 } Token;
 
+#ifndef LEX_MAX_TOKEN_SIZE
+#define LEX_MAX_TOKEN_SIZE MegaBytes(16)
+#endif
+
+// Copies at most `size` bytes of the next chunk into `buffer`, returns 0 at the end of the stream
+typedef umem(*Lex_Refill)(void *context, u8 *buffer, umem size);
+
+typedef struct Lex_Location {
+	umem pos;
+	umem row;
+	umem column;
+} Lex_Location;
+
 typedef struct Lexer {
-	u8 *    cursor;
-	u8 *    last;
-	u8 *    first;
-	M_Pool *pool;
-	char    error[1024];
+	u8 *         cursor;
+	u8 *         last;
+	u8 *         first;
+	M_Pool *     pool;
+
+	// `first` maps to the global location `offset`, tokens past `limit` have their locations
+	// saturated at it once the file can not grow any further
+	umem         offset;
+	umem         limit;
+	Source_File *file; // of a stream, which claims more locations as it goes, see SourceGrow
+
+	// Streaming mode
+	Lex_Refill   refill;
+	void *       context;
+	M_Arena *    window;
+	umem         chunk;
+	Lex_Location mark;
+	Lex_Location recent[8];
+	uint         recent_index;
+	umem         pending; // bytes of a sequence the last chunk cut off, not validated yet
+
+	// The input is not valid UTF-8 past `last`, the lexer fails once it gets there. The data
+	// still goes on to `end`, so that locations past it can be worked out.
+	bool         invalid;
+	u8 *         end;
+
+	bool         exhausted; // the pool had no room left for a name, see M_PoolInitBudget
+	char         error[1024];
 } Lexer;
 
-void LexInitTable(void);
-void LexInit(Lexer *l, String input, M_Pool *pool);
+// `file` places the tokens in the global location space, without it locations start at 0.
+// The file of a stream has to be the one in SourceGlobal() it grows in.
+void LexInit(Lexer *l, String input, const Source_File *file, M_Pool *pool);
+void LexInitStream(Lexer *l, Lex_Refill refill, void *context, umem chunk, Source_File *file, M_Pool *pool);
+void LexFree(Lexer *l);
 bool LexNext(Lexer *l, Token *token);
-void LexDump(FILE *out, const Token *token);
+void LexLocation(Lexer *l, umem pos, umem *row, umem *column);
+void LexDump(Dump_Buffer *out, const Token *token);
+
+// Kind as one byte, then 8 value bytes for numbers or a varint length and the name for identifiers
+void LexDumpBinary(Dump_Buffer *out, const Token *token);
+
+//
+//
+//
+
+// Below this many bytes per thread the input is not split any further
+#ifndef LEX_PARALLEL_MIN_PIECE
+#define LEX_PARALLEL_MIN_PIECE MegaBytes(1)
+#endif
+
+typedef struct Lex_Piece Lex_Piece;
+
+typedef struct Lex_Tokens {
+	Token *     data;  // `count` tokens followed by a Token_Kind_END token
+	imem        count;
+
+	// Set to the first error in the input, tokens stop right before it
+	bool        failed;
+	Token_Range error_range;
+	char        error[1024];
+
+	M_Arena *   arena;
+	Lex_Piece * pieces; // own the pools holding identifier strings
+	u32         piece_count;
+} Lex_Tokens;
+
+// Splits the input after whitespace bytes, where the lexer always returns to its initial
+// state, lexes the pieces on separate threads and joins the tokens in input order
+bool LexParallel(Lex_Tokens *tokens, String input, const Source_File *file, u32 thread_count);
+void LexTokensFree(Lex_Tokens *tokens);
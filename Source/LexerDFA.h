@@ -0,0 +1,53 @@
+#pragma once
+#include "Platform.h"
+
+typedef enum Lex_Prod {
+	Lex_Prod_None,
+	Lex_Prod_Reset,
+	Lex_Prod_Error,
+	Lex_Prod_Integer,
+	Lex_Prod_Float,
+	Lex_Prod_Symbol,
+	Lex_Prod_Identifier,
+} Lex_Prod;
+
+typedef enum Lex_State {
+	Lex_State_Error,
+	Lex_State_Whitespace,
+	Lex_State_Plus,
+	Lex_State_Minus,
+	Lex_State_Multiply,
+	Lex_State_Divide,
+	Lex_State_Bracket_Open,
+	Lex_State_Bracket_Close,
+	Lex_State_Equals,
+	Lex_State_Integer_Zero,
+	Lex_State_Integer,
+	Lex_State_Integer_Hex,
+	Lex_State_Integer_Binary,
+	Lex_State_Integer_Octal,
+	Lex_State_Float_Dot,
+	Lex_State_Float_Fraction,
+	Lex_State_Float_Exponent_Mark,
+	Lex_State_Float_Exponent_Sign,
+	Lex_State_Float_Exponent,
+	Lex_State_Identifier,
+
+	Lex_State_COUNT
+} Lex_State;
+
+static_assert(Lex_State_COUNT <= 256, "");
+
+// Keywords come out of the DFA as identifiers and are told apart afterwards. LexerGen picks the
+// multipliers so that no two keywords share a slot, a word is then only ever compared against
+// the one keyword in its slot. The hash reads the length and the outer bytes only, so it costs
+// the same however many keywords there are.
+typedef struct Lex_Keyword {
+	const char *text;
+	u8          length; // 0 for empty slots
+	u8          kind;   // Token_Kind
+} Lex_Keyword;
+
+inproc u32 LexKeywordHash(const u8 *word, umem length, u32 first, u32 last, u32 mask) {
+	return ((u32)word[0] * first + (u32)word[length - 1] * last + (u32)length) & mask;
+}
@@ -0,0 +1,106 @@
+// Generated by Tools/LexerGen.c, do not edit.
+#pragma once
+#include "LexerDFA.h"
+
+#define LEX_CLASS_COUNT 21
+
+static_assert(Lex_State_COUNT == 20, "LexerTables.h is out of date, rerun Tools/LexerGen.c");
+
+static const u8 LexCharClass[256] = {
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,  1,  0,  0, // 0x00
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0x10
+	 1,  0,  0,  0,  0,  0,  0,  0,  2,  3,  4,  5,  0,  6,  7,  8, // 0x20
+	 9, 10, 11, 11, 11, 11, 11, 11, 12, 12,  0,  0,  0, 13,  0,  0, // 0x30
+	 0, 14, 15, 14, 14, 16, 14, 17, 17, 17, 17, 17, 17, 17, 17, 18, // 0x40
+	17, 17, 17, 17, 17, 17, 17, 17, 19, 17, 17,  0,  0,  0,  0, 20, // 0x50
+	 0, 14, 15, 14, 14, 16, 14, 17, 17, 17, 17, 17, 17, 17, 17, 18, // 0x60
+	17, 17, 17, 17, 17, 17, 17, 17, 19, 17, 17,  0,  0,  0,  0,  0, // 0x70
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0x80
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0x90
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xA0
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xB0
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xC0
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xD0
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xE0
+	17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, // 0xF0
+};
+
+static const u8 LexTransition[Lex_State_COUNT][LEX_CLASS_COUNT] = {
+	[Lex_State_Error              ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  0,  0,  0,  0,  8,  0,  0,  0,  0,  0,  0,  0, },
+	[Lex_State_Whitespace         ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Plus               ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Minus              ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Multiply           ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Divide             ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Bracket_Open       ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Bracket_Close      ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Equals             ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5,  9, 10, 10, 10,  8, 19, 19, 19, 19, 19, 19, 19, },
+	[Lex_State_Integer_Zero       ] = {  0,  1,  6,  7,  4,  2,  3, 14,  5, 10, 10, 10, 10,  8,  0, 12, 16,  0, 13, 11, 10, },
+	[Lex_State_Integer            ] = {  0,  1,  6,  7,  4,  2,  3, 14,  5, 10, 10, 10, 10,  8,  0,  0, 16,  0,  0,  0, 10, },
+	[Lex_State_Integer_Hex        ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 11, 11, 11, 11,  8, 11, 11, 11,  0,  0,  0, 11, },
+	[Lex_State_Integer_Binary     ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 12, 12,  0,  0,  8,  0,  0,  0,  0,  0,  0, 12, },
+	[Lex_State_Integer_Octal      ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 13, 13, 13,  0,  8,  0,  0,  0,  0,  0,  0, 13, },
+	[Lex_State_Float_Dot          ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 15, 15, 15, 15,  8,  0,  0,  0,  0,  0,  0,  0, },
+	[Lex_State_Float_Fraction     ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 15, 15, 15, 15,  8,  0,  0, 16,  0,  0,  0, 15, },
+	[Lex_State_Float_Exponent_Mark] = {  0,  1,  6,  7,  4, 17, 17,  0,  5, 18, 18, 18, 18,  8,  0,  0,  0,  0,  0,  0,  0, },
+	[Lex_State_Float_Exponent_Sign] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 18, 18, 18, 18,  8,  0,  0,  0,  0,  0,  0,  0, },
+	[Lex_State_Float_Exponent     ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 18, 18, 18, 18,  8,  0,  0,  0,  0,  0,  0, 18, },
+	[Lex_State_Identifier         ] = {  0,  1,  6,  7,  4,  2,  3,  0,  5, 19, 19, 19, 19,  8, 19, 19, 19, 19, 19, 19, 19, },
+};
+
+static const u8 LexProduction[Lex_State_COUNT][Lex_State_COUNT] = {
+	[Lex_State_Error              ] = { 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, },
+	[Lex_State_Whitespace         ] = { 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, },
+	[Lex_State_Plus               ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Minus              ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Multiply           ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Divide             ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Bracket_Open       ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Bracket_Close      ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Equals             ] = { 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, },
+	[Lex_State_Integer_Zero       ] = { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 0, 3, 0, 3, 3, 3, },
+	[Lex_State_Integer            ] = { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 0, 3, 0, 3, 3, 3, },
+	[Lex_State_Integer_Hex        ] = { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, },
+	[Lex_State_Integer_Binary     ] = { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, },
+	[Lex_State_Integer_Octal      ] = { 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3, },
+	[Lex_State_Float_Dot          ] = { 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 4, 4, 4, 4, },
+	[Lex_State_Float_Fraction     ] = { 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 4, 4, 4, },
+	[Lex_State_Float_Exponent_Mark] = { 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 4, },
+	[Lex_State_Float_Exponent_Sign] = { 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 4, },
+	[Lex_State_Float_Exponent     ] = { 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 4, },
+	[Lex_State_Identifier         ] = { 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 0, },
+};
+
+static const u8 LexTokenKind[Lex_State_COUNT] = {
+	[Lex_State_Error              ] = Token_Kind_END,
+	[Lex_State_Whitespace         ] = Token_Kind_END,
+	[Lex_State_Plus               ] = Token_Kind_Plus,
+	[Lex_State_Minus              ] = Token_Kind_Minus,
+	[Lex_State_Multiply           ] = Token_Kind_Multiply,
+	[Lex_State_Divide             ] = Token_Kind_Divide,
+	[Lex_State_Bracket_Open       ] = Token_Kind_Bracket_Open,
+	[Lex_State_Bracket_Close      ] = Token_Kind_Bracket_Close,
+	[Lex_State_Equals             ] = Token_Kind_Equals,
+	[Lex_State_Integer_Zero       ] = Token_Kind_Integer,
+	[Lex_State_Integer            ] = Token_Kind_Integer,
+	[Lex_State_Integer_Hex        ] = Token_Kind_Integer,
+	[Lex_State_Integer_Binary     ] = Token_Kind_Integer,
+	[Lex_State_Integer_Octal      ] = Token_Kind_Integer,
+	[Lex_State_Float_Dot          ] = Token_Kind_Float,
+	[Lex_State_Float_Fraction     ] = Token_Kind_Float,
+	[Lex_State_Float_Exponent_Mark] = Token_Kind_Float,
+	[Lex_State_Float_Exponent_Sign] = Token_Kind_Float,
+	[Lex_State_Float_Exponent     ] = Token_Kind_Float,
+	[Lex_State_Identifier         ] = Token_Kind_Identifier,
+};
+
+#define LEX_KEYWORD_MIN_LENGTH 4
+#define LEX_KEYWORD_MAX_LENGTH 5
+#define LEX_KEYWORD_FIRST      1
+#define LEX_KEYWORD_LAST       0
+#define LEX_KEYWORD_MASK       1
+
+static const Lex_Keyword LexKeywords[LEX_KEYWORD_MASK + 1] = {
+	[0] = { "true", 4, Token_Kind_True },
+	[1] = { "false", 5, Token_Kind_False },
+};
@@ -1,5 +1,9 @@
 ﻿#include "Parser.h"
+#include "Eval.h"
+#include "Array.h"
+#include "Perf.h"
 
+#if PLATFORM_WINDOWS == 1
 #define MICROSOFT_WINDOWS_WINBASE_H_DEFINE_INTERLOCKED_CPLUSPLUS_OVERLOADS 0
 #include <Windows.h>
 #include <consoleapi2.h>
@@ -15,3 +19,341 @@ int main(int argc, const char *argv[]) {
 
 	return 0;
 }
+
+#endif
+
+#if PLATFORM_LINUX == 1
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//
+// Filter mode: one expression per line on stdin, its value on one line of stdout. Names are
+// not kept between lines, reading one gives none. A line that reports an error, because it
+// does not lex or parse or because evaluating it fails as on a division by zero, gets its
+// diagnostics and "error" as its result, the lines after it go on as usual. Everything a line
+// allocates is rolled back once its result is written, so memory stays flat however long the
+// input runs. Lines per second and latency percentiles go to stderr at the end.
+//
+// Diagnostics go to stderr only, as text or with --json as one object per line. Each kind is
+// capped at --max-errors (0 for no limit), the rest are counted in the summary at exit.
+//
+// With --perf, every line is also measured per phase, see Perf.h. Lexing otherwise happens
+// on demand while parsing, so for numbers of its own each line is lexed once more up front.
+// Parse numbers include that second lexing.
+//
+
+#define DRIVER_READ_SIZE  MegaBytes(1)
+#define DRIVER_MAX_LINE   MegaBytes(256)
+#define DRIVER_WRITE_SIZE KiloBytes(64)
+#define DRIVER_MAX_ERRORS 100
+
+typedef struct Driver_Writer {
+	u8   data[DRIVER_WRITE_SIZE];
+	umem used;
+} Driver_Writer;
+
+static Driver_Writer Writer;
+
+static void DriverFlush(void) {
+	for (umem written = 0; written < Writer.used; ) {
+		ssize_t count = write(STDOUT_FILENO, Writer.data + written, Writer.used - written);
+		if (count <= 0)
+			break;
+		written += count;
+	}
+	Writer.used = 0;
+}
+
+static void DriverExit(void) {
+	DriverFlush();
+	DiagFinish(DiagDefault());
+}
+
+static void DriverWrite(const void *data, umem size) {
+	const u8 *from = data;
+
+	while (size) {
+		if (Writer.used == sizeof(Writer.data))
+			DriverFlush();
+
+		umem count = Min(size, sizeof(Writer.data) - Writer.used);
+		memcpy(Writer.data + Writer.used, from, count);
+		Writer.used += count;
+		from        += count;
+		size        -= count;
+	}
+}
+
+static void DriverWriteValue(Value value) {
+	char buffer[32];
+
+	switch (value.kind) {
+	case Value_Kind_NONE:
+	{
+		DriverWrite("none", 4);
+		return;
+	}
+
+	case Value_Kind_INTEGER:
+	{
+		// Filled from the back
+		u64 integer = value.integer;
+		int pos     = sizeof(buffer);
+		do {
+			buffer[--pos] = '0' + (char)(integer % 10);
+			integer /= 10;
+		} while (integer);
+		DriverWrite(buffer + pos, sizeof(buffer) - pos);
+		return;
+	}
+
+	case Value_Kind_FLOAT:
+	{
+		int length = snprintf(buffer, sizeof(buffer), "%.17g", value.floating);
+		DriverWrite(buffer, (umem)length);
+		return;
+	}
+	}
+}
+
+//
+//
+//
+
+// Log-linear buckets, 16 per power of two, so every percentile is within 1/16 of the real value
+#define DRIVER_LATENCY_BUCKETS 1024
+
+typedef struct Driver_Stats {
+	u64 lines;
+	u64 start;
+	u64 max;
+	u64 buckets[DRIVER_LATENCY_BUCKETS];
+} Driver_Stats;
+
+static u64 DriverNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (u64)now.tv_sec * 1000000000 + (u64)now.tv_nsec;
+}
+
+static u32 DriverBucket(u64 ns) {
+	if (ns < 16)
+		return (u32)ns;
+	u32 top = 63 - (u32)__builtin_clzll(ns);
+	return (top - 3) * 16 + (u32)((ns >> (top - 4)) & 15);
+}
+
+static u64 DriverBucketStart(u32 bucket) {
+	if (bucket < 16)
+		return bucket;
+	return (u64)(16 + bucket % 16) << (bucket / 16 - 1);
+}
+
+static u64 DriverPercentile(Driver_Stats *stats, r64 fraction) {
+	u64 rank = (u64)(fraction * (r64)stats->lines);
+	u64 seen = 0;
+	for (u32 bucket = 0; bucket < DRIVER_LATENCY_BUCKETS; ++bucket) {
+		seen += stats->buckets[bucket];
+		if (seen > rank)
+			return DriverBucketStart(bucket);
+	}
+	return stats->max;
+}
+
+static void DriverReport(Driver_Stats *stats) {
+	r64 seconds = (r64)(DriverNow() - stats->start) / 1e9;
+	fprintf(stderr, "%" PRIu64 " lines in %.3f s, %.0f lines/s\n", stats->lines, seconds, seconds > 0 ? (r64)stats->lines / seconds : 0.0);
+
+	if (!stats->lines)
+		return;
+
+	fprintf(stderr, "latency p50 %.2f us, p90 %.2f us, p99 %.2f us, p99.9 %.2f us, max %.2f us\n",
+		DriverPercentile(stats, 0.5) / 1e3, DriverPercentile(stats, 0.9) / 1e3, DriverPercentile(stats, 0.99) / 1e3,
+		DriverPercentile(stats, 0.999) / 1e3, stats->max / 1e3);
+}
+
+//
+//
+//
+
+static Value DriverLoad(void *user, Expr_Identifier *name) {
+	return (Value){ Value_Kind_NONE };
+}
+
+static void DriverLex(String line, M_Pool *pool, Perf *perf) {
+	PerfBegin(perf, Perf_Phase_Lex);
+
+	Lexer lexer;
+	Token token;
+	LexInit(&lexer, line, nullptr, pool);
+	while (LexNext(&lexer, &token) && token.kind != Token_Kind_END) {}
+
+	PerfEnd(perf);
+	PerfAdd(perf, Perf_Phase_Lex, line.count, 0);
+}
+
+static void DriverLine(String line, u64 number, M_Pool *pool, Driver_Stats *stats, Perf *perf) {
+	u64    start = DriverNow();
+	M_Temp temp  = M_PoolBeginTemporaryMemory(pool);
+
+	if (line.count && line.data[line.count - 1] == '\r')
+		line.count -= 1;
+
+	char name[32];
+	int  length = snprintf(name, sizeof(name), "stdin:%" PRIu64, number);
+
+	if (perf) {
+		DriverLex(line, pool, perf);
+		PerfBegin(perf, Perf_Phase_Parse);
+	}
+
+	Parser parser;
+	ParserInit(&parser, line, (String){ length, (u8 *)name }, pool);
+	Expr_Array statements = ParseStatements(&parser);
+
+	umem nodes = 0;
+	if (perf) {
+		PerfEnd(perf);
+		for (imem index = 0; index < statements.count; ++index)
+			nodes += ExprNodeCount(statements.data[index]);
+		PerfAdd(perf, Perf_Phase_Parse, line.count, nodes);
+		PerfBegin(perf, Perf_Phase_Eval);
+	}
+
+	Eval_Context ctx   = { &parser, nullptr, nullptr, nullptr, DriverLoad };
+	Value        value = { Value_Kind_NONE };
+	for (imem index = 0; index < statements.count; ++index)
+		value = EvalExpr(&ctx, statements.data[index]);
+
+	if (perf) {
+		PerfEnd(perf);
+		PerfAdd(perf, Perf_Phase_Eval, 0, nodes);
+	}
+
+	// Blank lines stay blank so output lines keep matching input lines
+	if (parser.failed || parser.exhausted || parser.errors)
+		DriverWrite("error", 5);
+	else if (statements.count)
+		DriverWriteValue(value);
+	DriverWrite("\n", 1);
+
+	if (parser.file)
+		SourceDrop(SourceGlobal(), parser.file);
+	M_PoolEndTemporaryMemory(pool, &temp);
+
+	u64 elapsed = DriverNow() - start;
+	stats->lines += 1;
+	stats->max    = Max(stats->max, elapsed);
+	stats->buckets[DriverBucket(elapsed)] += 1;
+}
+
+int main(int argc, const char *argv[]) {
+	static Perf perf;
+	bool        measure = false;
+	Diag_Format format  = Diag_Format_TEXT;
+	u32         limit   = DRIVER_MAX_ERRORS;
+
+	for (int index = 1; index < argc; ++index) {
+		const char *arg   = argv[index];
+		bool        usage = false;
+
+		if (strcmp(arg, "--perf") == 0) {
+			measure = true;
+		} else if (strcmp(arg, "--json") == 0) {
+			format = Diag_Format_JSON;
+		} else if (strncmp(arg, "--max-errors=", 13) == 0 && arg[13]) {
+			char *end;
+			limit = (u32)strtoul(arg + 13, &end, 10);
+			usage = *end != 0;
+		} else {
+			usage = true;
+		}
+
+		if (usage) {
+			fprintf(stderr, "usage: %s [--perf] [--json] [--max-errors=N] < input\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Results own stdout, so that its lines keep matching the input lines
+	DiagInitDefault(format, stderr, stderr, DRIVER_WRITE_SIZE);
+	for (int kind = Diag_Kind_INFO; kind <= Diag_Kind_ERROR; ++kind)
+		DiagLimit(DiagDefault(), kind, limit);
+
+	if (measure)
+		PerfInit(&perf);
+
+	M_Pool pool;
+	M_PoolInit(&pool, KiloBytes(128));
+
+	// Running out of memory exits, results of the lines before and the summary still go out
+	atexit(DriverExit);
+
+	static Driver_Stats stats;
+	stats.start = DriverNow();
+
+	M_Array(u8) input;
+	if (!M_ArrayInit(&input, DRIVER_MAX_LINE + DRIVER_READ_SIZE)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	// Unfinished lines are moved to the front of the buffer before the next read
+	u64  number = 0;
+	imem start  = 0;
+	bool done   = false;
+
+	while (!done) {
+		if (start) {
+			memmove(input.data, input.data + start, (umem)(input.count - start));
+			input.count -= start;
+			start        = 0;
+		}
+
+		imem scanned = input.count;
+		u8 * read_to = M_ArrayPushN(&input, DRIVER_READ_SIZE);
+		if (!read_to) {
+			fprintf(stderr, "stdin:%" PRIu64 ": line is too long\n", number + 1);
+			return 1;
+		}
+
+		ssize_t count;
+		do {
+			count = read(STDIN_FILENO, read_to, DRIVER_READ_SIZE);
+		} while (count < 0 && errno == EINTR);
+
+		input.count -= DRIVER_READ_SIZE - Max(count, 0);
+		done         = count <= 0;
+
+		for (;;) {
+			u8 *newline = memchr(input.data + scanned, '\n', (umem)(input.count - scanned));
+			if (!newline)
+				break;
+
+			String line = { newline - (input.data + start), input.data + start };
+			DriverLine(line, ++number, &pool, &stats, measure ? &perf : nullptr);
+
+			start   = newline + 1 - input.data;
+			scanned = start;
+		}
+	}
+
+	if (start < input.count)
+		DriverLine((String){ input.count - start, input.data + start }, ++number, &pool, &stats, measure ? &perf : nullptr);
+
+	DriverFlush();
+	DiagFlush(DiagDefault());
+	DriverReport(&stats);
+
+	if (measure) {
+		PerfReport(&perf, stderr);
+		PerfFree(&perf);
+	}
+
+	return 0;
+}
+
+#endif
@@ -50,6 +50,10 @@ bool M_EnsureCommit(M_Arena *arena, umem pos) {
 		return true;
 	}
 
+	if (pos > arena->reserved) {
+		return false;
+	}
+
 	pos = Max(pos, M_ARENA_COMMIT_SIZE);
 	u8 *mem = (u8 *)arena;
 
@@ -0,0 +1,529 @@
+#include "Native.h"
+#include "Hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Native_Temp {
+	u32  index;
+	bool is_float;
+} Native_Temp;
+
+// An operator waiting for the temps of its operands, a binary one keeps its left temp until
+// the right one is there
+typedef struct Native_Frame {
+	Expr *      expr;
+	Native_Temp left;
+	bool        has_left;
+} Native_Frame;
+
+#define NATIVE_STACK_LOCAL 64
+#define NATIVE_STACK_MAX   (MegaBytes(256) / sizeof(Native_Frame))
+
+typedef struct Native_Emitter {
+	Native_Text * text;
+	Frame_Layout *layout;
+	u32           temp;
+	u32 *         written;       // per slot, temp + 1 holding what this statement stored, 0 when nothing
+	u32 *         pending;       // slots stored by this statement
+	u32           pending_count;
+	bool          supported;     // cleared when the statement has to run on the tree evaluator
+	bool          failed;        // out of space
+
+	M_Stack(Native_Frame, NATIVE_STACK_LOCAL) stack;
+} Native_Emitter;
+
+static void NativePrint(Native_Emitter *emitter, const char *fmt, ...) {
+	va_list args;
+
+	va_start(args, fmt);
+	int length = vsnprintf(nullptr, 0, fmt, args);
+	va_end(args);
+
+	// One more for the terminator vsnprintf writes, it is dropped again below
+	char *dst = length >= 0 ? M_ArrayPushN(emitter->text, (imem)length + 1) : nullptr;
+	if (!dst) {
+		emitter->failed = true;
+		return;
+	}
+
+	va_start(args, fmt);
+	vsnprintf(dst, (umem)length + 1, fmt, args);
+	va_end(args);
+
+	emitter->text->count -= 1;
+}
+
+static const char *NativeSlotType(Expr_Type *type) {
+	if (type->id == Expr_Type_Id_FLOAT)
+		return "double";
+
+	bool is_signed = ((Expr_Type_Integer *)type)->flags & EXPR_TYPE_INTEGER_IS_SIGNED;
+	switch (type->runtime_size) {
+	case 1: return is_signed ? "int8_t" : "uint8_t";
+	case 2: return is_signed ? "int16_t" : "uint16_t";
+	case 4: return is_signed ? "int32_t" : "uint32_t";
+	case 8: return is_signed ? "int64_t" : "uint64_t";
+	NoDefaultCase();
+	}
+	return nullptr;
+}
+
+static Native_Temp NativeDeclare(Native_Emitter *emitter, bool is_float) {
+	Native_Temp temp = { emitter->temp++, is_float };
+	NativePrint(emitter, "\t%s t%u = ", is_float ? "double" : "uint64_t", temp.index);
+	return temp;
+}
+
+static Native_Temp NativeEmitLeaf(Native_Emitter *emitter, Expr *expr) {
+	if (expr->kind == Expr_Kind_Literal) {
+		Expr_Literal *literal  = (Expr_Literal *)expr;
+		bool          is_float = expr->type->id == Expr_Type_Id_FLOAT;
+		Native_Temp   result   = NativeDeclare(emitter, is_float);
+		// Floats go through their bits, that keeps them exact and covers infinities and NaNs
+		NativePrint(emitter, is_float ? "z_float(0x%016" PRIx64 "u);\n" : "0x%016" PRIx64 "u;\n", literal->value.integer);
+		return result;
+	}
+
+	Expr_Identifier *name = (Expr_Identifier *)expr;
+	if (name->slot == EXPR_SLOT_NONE) {
+		emitter->supported = false;
+		return (Native_Temp){ 0 };
+	}
+
+	Frame_Slot *slot     = &emitter->layout->slots[name->slot];
+	bool        is_float = slot->type->id == Expr_Type_Id_FLOAT;
+	Native_Temp result   = NativeDeclare(emitter, is_float);
+
+	// Reads after a store in the same statement see the stored value, the frame is only written at the end
+	char source[32];
+	if (emitter->written[name->slot])
+		snprintf(source, sizeof(source), "w%u", emitter->written[name->slot] - 1);
+	else
+		snprintf(source, sizeof(source), "f->s%u", name->slot);
+
+	if (is_float)
+		NativePrint(emitter, "%s;\n", source);
+	else if (((Expr_Type_Integer *)slot->type)->flags & EXPR_TYPE_INTEGER_IS_SIGNED)
+		NativePrint(emitter, "(uint64_t)(int64_t)%s;\n", source);
+	else
+		NativePrint(emitter, "(uint64_t)%s;\n", source);
+	return result;
+}
+
+static Native_Temp NativeEmitUnary(Native_Emitter *emitter, Expr_Unary_Operator *unary, Native_Temp child) {
+	if (unary->symbol == '+')
+		return child;
+
+	Assert(unary->symbol == '-');
+	Native_Temp result = NativeDeclare(emitter, child.is_float);
+	NativePrint(emitter, child.is_float ? "-t%u;\n" : "0 - t%u;\n", child.index);
+	return result;
+}
+
+static Native_Temp NativeEmitBinary(Native_Emitter *emitter, Expr_Binary_Operator *binary, Native_Temp left, Native_Temp right) {
+	if (left.is_float || right.is_float) {
+		Native_Temp result = NativeDeclare(emitter, true);
+		NativePrint(emitter, "%st%u %c %st%u;\n",
+			left.is_float ? "" : "(double)", left.index, (char)binary->symbol,
+			right.is_float ? "" : "(double)", right.index);
+		return result;
+	}
+
+	bool is_signed = ExprIsSigned(&binary->base);
+	u32  a         = left.index;
+	u32  b         = right.index;
+
+	if (binary->symbol == '/')
+		NativePrint(emitter, "\tif (!t%u) return 0;\n", b);
+
+	Native_Temp result = NativeDeclare(emitter, false);
+	switch (binary->symbol) {
+	case '+':
+	case '-':
+	case '*':
+		NativePrint(emitter, "t%u %c t%u;\n", a, (char)binary->symbol, b);
+		break;
+
+	case '/':
+		if (is_signed)
+			NativePrint(emitter, "t%u == UINT64_MAX ? 0 - t%u : (uint64_t)((int64_t)t%u / (int64_t)t%u);\n", b, a, a, b);
+		else
+			NativePrint(emitter, "t%u / t%u;\n", a, b);
+		break;
+
+	case EXPR_SYMBOL_SHIFT_LEFT:
+		NativePrint(emitter, "t%u << (t%u & 63);\n", a, b);
+		break;
+
+	case EXPR_SYMBOL_SHIFT_RIGHT:
+		if (is_signed)
+			NativePrint(emitter, "(uint64_t)((int64_t)t%u >> (t%u & 63));\n", a, b);
+		else
+			NativePrint(emitter, "t%u >> (t%u & 63);\n", a, b);
+		break;
+
+	case EXPR_SYMBOL_MULTIPLY_HIGH:
+		NativePrint(emitter, "z_mulhi(t%u, t%u, %d);\n", a, b, is_signed);
+		break;
+
+	NoDefaultCase();
+	}
+	return result;
+}
+
+static Native_Temp NativeEmitAssignment(Native_Emitter *emitter, Expr_Assignment *assign, Native_Temp value) {
+	if (assign->left->kind != Expr_Kind_Identifier || ((Expr_Identifier *)assign->left)->slot == EXPR_SLOT_NONE) {
+		emitter->supported = false;
+		return value;
+	}
+
+	// Converted the way FrameStore does it
+	u32         slot_index = ((Expr_Identifier *)assign->left)->slot;
+	Frame_Slot *slot       = &emitter->layout->slots[slot_index];
+	bool        to_float   = slot->type->id == Expr_Type_Id_FLOAT;
+	u32         written    = emitter->temp++;
+
+	NativePrint(emitter, "\t%s w%u = ", NativeSlotType(slot->type), written);
+	if (to_float)
+		NativePrint(emitter, value.is_float ? "t%u;\n" : "(double)t%u;\n", value.index);
+	else
+		NativePrint(emitter, "(%s)(%st%u);\n", NativeSlotType(slot->type), value.is_float ? "(uint64_t)" : "", value.index);
+
+	if (!emitter->written[slot_index])
+		emitter->pending[emitter->pending_count++] = slot_index;
+	emitter->written[slot_index] = written + 1;
+
+	// The value of an assignment is what was assigned, before conversion to the slot type
+	return value;
+}
+
+// Mirrors EvalExpr: integers are carried as 64 bits, floats as doubles, and a value is a
+// float when any operand is, whatever the static type of the node says. Operands are emitted
+// left to right before their operator. A tree too deep for the stack runs on the tree evaluator.
+static Native_Temp NativeEmitExpr(Native_Emitter *emitter, Expr *root) {
+	Native_Temp value = { 0 };
+	Expr *      expr  = root;
+
+	// While `expr` is set it is descended into, then `value` goes up to the operator waiting for it
+	for (;;) {
+		if (expr) {
+			if (expr->kind == Expr_Kind_Literal || expr->kind == Expr_Kind_Identifier) {
+				value = NativeEmitLeaf(emitter, expr);
+				expr  = nullptr;
+			} else {
+				Native_Frame *frame = M_StackPush(&emitter->stack);
+				if (!frame) {
+					emitter->supported = false;
+					break;
+				}
+
+				frame->expr     = expr;
+				frame->has_left = false;
+
+				switch (expr->kind) {
+				case Expr_Kind_Unary_Operator:  expr = ((Expr_Unary_Operator *)expr)->child; break;
+				case Expr_Kind_Binary_Operator: expr = ((Expr_Binary_Operator *)expr)->left; break;
+				case Expr_Kind_Assignment:      expr = ((Expr_Assignment *)expr)->right; break;
+				NoDefaultCase();
+				}
+			}
+			continue;
+		}
+
+		if (!emitter->stack.count)
+			break;
+
+		Native_Frame *frame = M_StackTop(&emitter->stack);
+		Expr *        node  = frame->expr;
+
+		switch (node->kind) {
+		case Expr_Kind_Unary_Operator:
+		{
+			value = NativeEmitUnary(emitter, (Expr_Unary_Operator *)node, value);
+			break;
+		}
+
+		case Expr_Kind_Binary_Operator:
+		{
+			if (!frame->has_left) {
+				frame->left     = value;
+				frame->has_left = true;
+				expr            = ((Expr_Binary_Operator *)node)->right;
+				continue;
+			}
+			value = NativeEmitBinary(emitter, (Expr_Binary_Operator *)node, frame->left, value);
+			break;
+		}
+
+		case Expr_Kind_Assignment:
+		{
+			value = NativeEmitAssignment(emitter, (Expr_Assignment *)node, value);
+			break;
+		}
+
+		NoDefaultCase();
+		}
+
+		emitter->stack.count -= 1;
+	}
+
+	emitter->stack.count = 0;
+	return value;
+}
+
+static const char NativePrelude[] =
+	"#include <stddef.h>\n"
+	"#include <stdint.h>\n"
+	"\n"
+	"static inline double z_float(uint64_t bits) {\n"
+	"\tunion { uint64_t bits; double value; } u = { bits };\n"
+	"\treturn u.value;\n"
+	"}\n"
+	"\n"
+	"static inline uint64_t z_mulhi(uint64_t a, uint64_t b, int is_signed) {\n"
+	"#if defined(__SIZEOF_INT128__)\n"
+	"\tuint64_t hi = (uint64_t)(((unsigned __int128)a * b) >> 64);\n"
+	"#else\n"
+	"\tuint64_t a_lo = (uint32_t)a, a_hi = a >> 32;\n"
+	"\tuint64_t b_lo = (uint32_t)b, b_hi = b >> 32;\n"
+	"\tuint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi, p2 = a_hi * b_lo;\n"
+	"\tuint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;\n"
+	"\tuint64_t hi = a_hi * b_hi + (p1 >> 32) + (p2 >> 32) + (mid >> 32);\n"
+	"#endif\n"
+	"\tif (is_signed) {\n"
+	"\t\tif ((int64_t)a < 0) hi -= b;\n"
+	"\t\tif ((int64_t)b < 0) hi -= a;\n"
+	"\t}\n"
+	"\treturn hi;\n"
+	"}\n"
+	"\n";
+
+bool NativeEmit(Native_Text *text, Frame_Layout *layout, Expr_Array statements) {
+	Native_Emitter emitter = { 0 };
+	emitter.text    = text;
+	emitter.layout  = layout;
+	emitter.written = calloc(layout->slot_count + 1, sizeof(u32));
+	emitter.pending = calloc(layout->slot_count + 1, sizeof(u32));
+
+	if (!emitter.written || !emitter.pending) {
+		free(emitter.written);
+		free(emitter.pending);
+		return false;
+	}
+
+	M_StackInit(&emitter.stack, NATIVE_STACK_MAX);
+	NativePrint(&emitter, "%s", NativePrelude);
+
+	// Slots are placed by decreasing size without padding, declaring them in offset order gives the same layout
+	u32 *order = emitter.pending;
+	for (u32 index = 0; index < layout->slot_count; ++index) {
+		u32 pos = index;
+		while (pos && layout->slots[order[pos - 1]].offset > layout->slots[index].offset) {
+			order[pos] = order[pos - 1];
+			pos -= 1;
+		}
+		order[pos] = index;
+	}
+
+	NativePrint(&emitter, "typedef struct Frame {\n");
+	for (u32 index = 0; index < layout->slot_count; ++index) {
+		Frame_Slot *slot = &layout->slots[order[index]];
+		NativePrint(&emitter, "\t%s s%u; // " StrFmt "\n", NativeSlotType(slot->type), order[index], StrArg(slot->name));
+	}
+	if (!layout->slot_count)
+		NativePrint(&emitter, "\tchar unused;\n");
+	NativePrint(&emitter, "} Frame;\n\n");
+
+	for (u32 index = 0; index < layout->slot_count; ++index)
+		NativePrint(&emitter, "_Static_assert(offsetof(Frame, s%u) == %u, \"\");\n", index, layout->slots[index].offset);
+	if (layout->slot_count)
+		NativePrint(&emitter, "_Static_assert(sizeof(Frame) == %u, \"\");\n", layout->size);
+	NativePrint(&emitter, "\n");
+
+	for (imem index = 0; index < statements.count; ++index) {
+		imem start = text->count;
+
+		emitter.temp          = 0;
+		emitter.supported     = true;
+		emitter.pending_count = 0;
+
+		NativePrint(&emitter, "static int zs%u(Frame *f) {\n", (u32)index);
+		NativeEmitExpr(&emitter, statements.data[index]);
+
+		for (u32 pending = 0; pending < emitter.pending_count; ++pending) {
+			u32 slot = emitter.pending[pending];
+			NativePrint(&emitter, "\tf->s%u = w%u;\n", slot, emitter.written[slot] - 1);
+			emitter.written[slot] = 0;
+		}
+
+		NativePrint(&emitter, "\treturn 1;\n}\n\n");
+
+		if (!emitter.supported) {
+			text->count = start;
+			NativePrint(&emitter, "static int zs%u(Frame *f) {\n\t(void)f;\n\treturn 0;\n}\n\n", (u32)index);
+		}
+	}
+
+	NativePrint(&emitter, "typedef int (*Z_Proc)(Frame *f);\n\n");
+	NativePrint(&emitter, "const unsigned z_statement_count = %u;\n\n", (u32)statements.count);
+	NativePrint(&emitter, "const Z_Proc z_statements[] = {\n");
+	for (imem index = 0; index < statements.count; ++index)
+		NativePrint(&emitter, "\tzs%u,\n", (u32)index);
+	if (!statements.count)
+		NativePrint(&emitter, "\t0,\n");
+	NativePrint(&emitter, "};\n");
+
+	M_StackFree(&emitter.stack);
+	free(emitter.written);
+	free(emitter.pending);
+	return !emitter.failed;
+}
+
+//
+//
+//
+
+#if PLATFORM_LINUX == 1 || PLATFORM_MAC == 1
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *NativeCompiler(void) {
+	const char *cc = getenv("CC");
+	return cc && *cc ? cc : "cc";
+}
+
+static bool NativeWriteFile(const char *path, const char *data, umem size) {
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	bool result = true;
+	for (umem written = 0; written < size; ) {
+		ssize_t count = write(fd, data + written, size - written);
+		if (count <= 0) {
+			result = false;
+			break;
+		}
+		written += count;
+	}
+	close(fd);
+
+	return result;
+}
+
+// Paths go into a shell command inside single quotes
+static bool NativeQuotable(const char *path) {
+	return strchr(path, '\'') == nullptr;
+}
+
+static bool NativeBuild(const char *path, Native_Text *text, const char *dir, u64 key) {
+	char source[1024], object[1024], command[4096];
+	snprintf(source, sizeof(source), "%s/%016" PRIx64 ".%ld.c", dir, key, (long)getpid());
+	snprintf(object, sizeof(object), "%s/%016" PRIx64 ".%ld.so", dir, key, (long)getpid());
+
+	if (!NativeQuotable(source) || !NativeQuotable(object))
+		return false;
+
+	if (!NativeWriteFile(source, text->data, (umem)text->count))
+		return false;
+
+	int length = snprintf(command, sizeof(command), "%s -O2 -shared -fPIC -o '%s' '%s' >/dev/null 2>&1", NativeCompiler(), object, source);
+
+	// A failing compiler and a missing one look the same, both leave the tree evaluator running
+	bool result = length > 0 && length < (int)sizeof(command) && system(command) == 0;
+	unlink(source);
+
+	// Loaders only ever see complete objects
+	if (result)
+		result = rename(object, path) == 0;
+	if (!result)
+		unlink(object);
+
+	return result;
+}
+
+static bool NativeLoad(Native_Program *program, const char *path) {
+	void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!library)
+		return false;
+
+	const unsigned *count = dlsym(library, "z_statement_count");
+	Native_Proc *   procs = dlsym(library, "z_statements");
+
+	if (!count || !procs || *count != (unsigned)program->statements.count) {
+		dlclose(library);
+		return false;
+	}
+
+	program->library = library;
+	program->procs   = procs;
+	return true;
+}
+
+static void NativeUnload(Native_Program *program) {
+	dlclose(program->library);
+}
+
+#else
+
+static const char *NativeCompiler(void) {
+	return "";
+}
+
+// No compiler is looked for here, everything runs on the tree evaluator
+static bool NativeBuild(const char *path, Native_Text *text, const char *dir, u64 key) {
+	return false;
+}
+
+static bool NativeLoad(Native_Program *program, const char *path) {
+	return false;
+}
+
+static void NativeUnload(Native_Program *program) {
+}
+
+#endif
+
+bool NativeCompile(Native_Program *program, const char *dir, Parser *parser, Frame_Layout *layout, Expr_Array statements) {
+	memset(program, 0, sizeof(*program));
+	program->parser     = parser;
+	program->layout     = layout;
+	program->statements = statements;
+
+	Native_Text text;
+	if (!M_ArrayInit(&text, NATIVE_MAX_SOURCE))
+		return false;
+
+	bool result = NativeEmit(&text, layout, statements);
+	if (result) {
+		// The compiler is part of the key, switching it builds a new object
+		const char *cc = NativeCompiler();
+		program->key   = HashBytes(text.data, (umem)text.count, HashBytes(cc, strlen(cc), 0));
+
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%016" PRIx64 ".so", dir, program->key);
+
+		result = NativeLoad(program, path) || (NativeBuild(path, &text, dir, program->key) && NativeLoad(program, path));
+	}
+
+	M_ArrayFree(&text);
+	return result;
+}
+
+void NativeFree(Native_Program *program) {
+	if (program->library)
+		NativeUnload(program);
+	memset(program, 0, sizeof(*program));
+}
+
+void NativeRun(Native_Program *program, u8 *frame) {
+	Eval_Context ctx = { program->parser, program->layout, frame };
+
+	for (imem index = 0; index < program->statements.count; ++index) {
+		if (program->procs && program->procs[index](frame))
+			continue;
+		EvalExpr(&ctx, program->statements.data[index]);
+	}
+}
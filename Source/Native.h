@@ -0,0 +1,44 @@
+#pragma once
+#include "Eval.h"
+#include "Array.h"
+
+// Ahead of time backend. The statements over a resolved frame are emitted as a C translation
+// unit, one function per statement over a struct with the layout of the frame, which the
+// system compiler (`$CC`, else `cc`) builds into a shared object with -O2. The object is kept
+// in a directory under a hash of the emitted source and the compiler, later runs over the same
+// statements load it without compiling. Loading uses dlopen, link with -ldl where libc does
+// not provide it.
+//
+// A compiled statement computes everything into locals and only writes the frame once it
+// has succeeded. When it can not finish, division by zero for example, it returns 0 without
+// touching the frame and the statement runs again on the tree evaluator, which reports the
+// error and stores what it does. Where no compiler is available every statement runs on the
+// tree evaluator, the frame ends up the same either way.
+
+#ifndef NATIVE_MAX_SOURCE
+#define NATIVE_MAX_SOURCE MegaBytes(512)
+#endif
+
+typedef M_Array(char) Native_Text;
+
+typedef int (*Native_Proc)(u8 *frame); // 1 when the statement ran, 0 to fall back
+
+typedef struct Native_Program {
+	Parser *      parser; // diagnostics of the tree fallback, may be null
+	Frame_Layout *layout;
+	Expr_Array    statements;
+	u64           key;
+	void *        library; // null when running on the tree evaluator
+	Native_Proc * procs;   // one per statement, inside the library
+} Native_Program;
+
+// Pushes the translation unit for `statements` to `text`, initialize it with M_ArrayInit first
+bool NativeEmit(Native_Text *text, Frame_Layout *layout, Expr_Array statements);
+
+// Loads the compiled statements from `dir`, building them first on a miss. False when the
+// program runs on the tree evaluator instead, it is usable either way.
+bool NativeCompile(Native_Program *program, const char *dir, Parser *parser, Frame_Layout *layout, Expr_Array statements);
+void NativeFree(Native_Program *program);
+
+// Runs all statements in order over `frame`
+void NativeRun(Native_Program *program, u8 *frame);
@@ -0,0 +1,381 @@
+#include "Number.h"
+#include "NumberTables.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#if COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+//
+// SWAR digit conversion, 8 digits are loaded into one u64 (little endian, so the
+// most significant digit is in the lowest byte) and neighbouring lanes are folded
+// together: 8x1 byte -> 4x2 bytes -> 2x4 bytes -> 1x8 bytes.
+//
+
+static u64 NumberLoad8(const u8 *digits) {
+	u64 v;
+	memcpy(&v, digits, sizeof(v));
+	return v;
+}
+
+static u64 NumberFold8(u64 v, u64 base) {
+	v = (v & 0x00FF00FF00FF00FFull) * base + ((v >> 8) & 0x00FF00FF00FF00FFull);
+	v = (v & 0x0000FFFF0000FFFFull) * (base * base) + ((v >> 16) & 0x0000FFFF0000FFFFull);
+	v = (v & 0x00000000FFFFFFFFull) * (base * base * base * base) + (v >> 32);
+	return v;
+}
+
+static bool NumberIsDigits8(u64 v) {
+	return ((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+static u64 NumberDigits8(u64 v) {
+	return v & 0x0F0F0F0F0F0F0F0Full;
+}
+
+static u64 NumberHexDigits8(u64 v) {
+	// '0'-'9' keep their low nibble, 'a'-'f' and 'A'-'F' have bit 6 set and low nibble 1-6
+	return (v & 0x0F0F0F0F0F0F0F0Full) + ((v >> 6) & 0x0101010101010101ull) * 9;
+}
+
+static u32 NumberDigit(u8 ch) {
+	return (ch & 0xf) + (ch >> 6) * 9;
+}
+
+static u64 NumberAccumulate(const u8 *digits, umem count, u64 base) {
+	u64 base8 = base * base * base * base;
+	base8 *= base8;
+
+	u64 value = 0;
+	umem index = 0;
+
+	if (base == 16) {
+		for (; index + 8 <= count; index += 8)
+			value = value * base8 + NumberFold8(NumberHexDigits8(NumberLoad8(digits + index)), base);
+	} else {
+		for (; index + 8 <= count; index += 8)
+			value = value * base8 + NumberFold8(NumberDigits8(NumberLoad8(digits + index)), base);
+	}
+
+	for (; index < count; ++index)
+		value = value * base + NumberDigit(digits[index]);
+
+	return value;
+}
+
+Number_Status NumberParseInteger(const u8 *first, const u8 *last, u64 *value) {
+	u64  base       = 10;
+	umem max_digits = 20;
+
+	if (last - first > 1 && first[0] == '0') {
+		switch (first[1] | 0x20) {
+		case 'x': base = 16; max_digits = 16; first += 2; break;
+		case 'b': base = 2;  max_digits = 64; first += 2; break;
+		case 'o': base = 8;  max_digits = 22; first += 2; break;
+		}
+	}
+
+	bool has_digits = false;
+	while (first < last && (*first == '0' || *first == '_')) {
+		has_digits |= (*first == '0');
+		first += 1;
+	}
+
+	if (first >= last) {
+		*value = 0;
+		return has_digits ? Number_Status_OK : Number_Status_NO_DIGITS;
+	}
+
+	umem count = last - first;
+
+	// Separators are rare, only then the digits are packed into a contiguous buffer. What is
+	// left starts with a digit other than 0, so there is at least one.
+	u8 packed[64];
+	if (memchr(first, '_', count)) {
+		count = 0;
+		for (const u8 *pos = first; pos < last; ++pos) {
+			if (*pos == '_') continue;
+			if (count == max_digits) return Number_Status_OVERFLOW;
+			packed[count++] = *pos;
+		}
+		first = packed;
+	}
+
+	if (count > max_digits)
+		return Number_Status_OVERFLOW;
+
+	if (count == max_digits) {
+		if (base == 8 && first[0] > '1')
+			return Number_Status_OVERFLOW;
+
+		if (base == 10) {
+			// 12 + 8 digits, compared against 18446744073709551615
+			u64 hi = NumberAccumulate(first, 12, 10);
+			u64 lo = NumberAccumulate(first + 12, 8, 10);
+			if (hi > 184467440737ull || (hi == 184467440737ull && lo > 9551615ull))
+				return Number_Status_OVERFLOW;
+			*value = hi * 100000000ull + lo;
+			return Number_Status_OK;
+		}
+	}
+
+	*value = NumberAccumulate(first, count, base);
+	return Number_Status_OK;
+}
+
+//
+// Floating point literals, digits are accumulated into a 19 digit mantissa and
+// converted with the Eisel-Lemire algorithm, see "Number Parsing at a Gigabyte
+// per Second" (Lemire) and "Fast Number Parsing Without Fallback" (Mushtak, Lemire).
+//
+
+typedef struct Number_Decimal {
+	u64  mantissa;
+	i64  exponent;
+	int  digits;
+	bool truncated;
+	bool has_digits;
+} Number_Decimal;
+
+#define NUMBER_MAX_MANTISSA_DIGITS 19
+
+static u64 NumberMultiply128(u64 a, u64 b, u64 *hi) {
+#if COMPILER_MSVC && ARCH_X64
+	return _umul128(a, b, hi);
+#elif defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)a * b;
+	*hi = (u64)(r >> 64);
+	return (u64)r;
+#else
+	u64 a_lo = (u32)a, a_hi = a >> 32;
+	u64 b_lo = (u32)b, b_hi = b >> 32;
+	u64 p0   = a_lo * b_lo;
+	u64 p1   = a_lo * b_hi;
+	u64 p2   = a_hi * b_lo;
+	u64 p3   = a_hi * b_hi;
+	u64 mid  = (p0 >> 32) + (u32)p1 + (u32)p2;
+	*hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+	return (mid << 32) | (u32)p0;
+#endif
+}
+
+static int NumberLeadingZeros(u64 v) {
+#if COMPILER_MSVC && (ARCH_X64 || ARCH_ARM64)
+	unsigned long index;
+	_BitScanReverse64(&index, v);
+	return 63 - (int)index;
+#elif COMPILER_GCC || COMPILER_CLANG
+	return __builtin_clzll(v);
+#else
+	int count = 0;
+	for (; !(v & 0x8000000000000000ull); v <<= 1)
+		count += 1;
+	return count;
+#endif
+}
+
+static const u8 *NumberScanDigits(const u8 *pos, const u8 *last, Number_Decimal *d, int fraction) {
+	// Leading zeros are not significant
+	if (d->digits == 0) {
+		for (; pos < last && (*pos == '0' || *pos == '_'); ++pos) {
+			if (*pos == '0') {
+				d->has_digits = true;
+				d->exponent  -= fraction;
+			}
+		}
+	}
+
+	while (last - pos >= 8 && d->digits + 8 <= NUMBER_MAX_MANTISSA_DIGITS) {
+		u64 v = NumberLoad8(pos);
+		if (!NumberIsDigits8(v)) break;
+
+		d->mantissa   = d->mantissa * 100000000ull + NumberFold8(NumberDigits8(v), 10);
+		d->digits    += 8;
+		d->exponent  -= 8 * fraction;
+		d->has_digits = true;
+		pos          += 8;
+	}
+
+	for (; pos < last; ++pos) {
+		u8 ch = *pos;
+		if (ch == '_') continue;
+		if (ch < '0' || ch > '9') break;
+
+		d->has_digits = true;
+
+		if (d->digits < NUMBER_MAX_MANTISSA_DIGITS) {
+			d->mantissa = d->mantissa * 10 + (ch - '0');
+			d->digits  += 1;
+			d->exponent -= fraction;
+		} else {
+			d->exponent  += 1 - fraction;
+			d->truncated |= (ch != '0');
+		}
+	}
+
+	return pos;
+}
+
+// Returns the IEEE-754 bits of w * 10^q
+static u64 NumberEiselLemire(u64 w, i64 q) {
+	if (w == 0 || q < NUMBER_POW5_MIN)
+		return 0;
+	if (q > NUMBER_POW5_MAX)
+		return 0x7FF0000000000000ull;
+
+	const int mantissa_bits = 52;
+
+	int lz = NumberLeadingZeros(w);
+	w <<= lz;
+
+	umem index = 2 * (umem)(q - NUMBER_POW5_MIN);
+
+	u64 hi;
+	u64 lo = NumberMultiply128(w, NumberPow5Table[index], &hi);
+
+	const u64 precision_mask = 0xFFFFFFFFFFFFFFFFull >> (mantissa_bits + 3);
+	if ((hi & precision_mask) == precision_mask) {
+		u64 hi2;
+		NumberMultiply128(w, NumberPow5Table[index + 1], &hi2);
+		lo += hi2;
+		if (hi2 > lo) hi += 1;
+	}
+
+	int upperbit = (int)(hi >> 63);
+	int shift    = upperbit + 64 - mantissa_bits - 3;
+
+	u64 mantissa = hi >> shift;
+	// floor(log2(10^q)) + 63 + bias
+	i64 power2   = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+
+	if (power2 <= 0) {
+		// Subnormal
+		if (-power2 + 1 >= 64)
+			return 0;
+		mantissa >>= -power2 + 1;
+		mantissa  += mantissa & 1;
+		mantissa >>= 1;
+		power2     = mantissa < (1ull << mantissa_bits) ? 0 : 1;
+		return mantissa | ((u64)power2 << mantissa_bits);
+	}
+
+	// Exactly halfway, round to even instead of up
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+		if ((mantissa << shift) == hi)
+			mantissa &= ~1ull;
+	}
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ull << mantissa_bits)) {
+		mantissa = 1ull << mantissa_bits;
+		power2 += 1;
+	}
+	mantissa &= ~(1ull << mantissa_bits);
+
+	if (power2 >= 0x7FF)
+		return 0x7FF0000000000000ull;
+
+	return mantissa | ((u64)power2 << mantissa_bits);
+}
+
+// Only for literals with more than 19 significant digits that land between two doubles
+static r64 NumberParseFloatSlow(const u8 *first, const u8 *last) {
+	char  local[256];
+	char *buffer = local;
+	umem  size   = last - first + 1;
+
+	if (size > sizeof(local)) {
+		buffer = malloc(size);
+		if (!buffer) return 0;
+	}
+
+	umem count = 0;
+	for (const u8 *pos = first; pos < last; ++pos) {
+		if (*pos != '_')
+			buffer[count++] = (char)*pos;
+	}
+	buffer[count] = 0;
+
+	r64 value = strtod(buffer, nullptr);
+
+	if (buffer != local)
+		free(buffer);
+
+	return value;
+}
+
+Number_Status NumberParseFloat(const u8 *first, const u8 *last, r64 *value) {
+	Number_Decimal d = { 0 };
+
+	const u8 *pos = NumberScanDigits(first, last, &d, 0);
+
+	if (pos < last && *pos == '.') {
+		bool had_digits = d.has_digits;
+		d.has_digits = false;
+		pos = NumberScanDigits(pos + 1, last, &d, 1);
+		if (!d.has_digits || !had_digits)
+			return Number_Status_NO_DIGITS;
+	}
+
+	if (!d.has_digits)
+		return Number_Status_NO_DIGITS;
+
+	if (pos < last && (*pos | 0x20) == 'e') {
+		pos += 1;
+
+		bool negative = false;
+		if (pos < last && (*pos == '+' || *pos == '-')) {
+			negative = (*pos == '-');
+			pos += 1;
+		}
+
+		i64  exponent   = 0;
+		bool has_digits = false;
+		for (; pos < last; ++pos) {
+			if (*pos == '_') continue;
+			has_digits = true;
+			if (exponent < 100000)
+				exponent = exponent * 10 + (*pos - '0');
+		}
+
+		if (!has_digits)
+			return Number_Status_NO_DIGITS;
+
+		d.exponent += negative ? -exponent : exponent;
+	}
+
+	Assert(pos == last);
+
+	// Clinger's fast path, both operands and the result are exact doubles
+	static const r64 ExactPowersOf10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	if (!d.truncated && d.mantissa <= (1ull << 53) && d.exponent >= -22 && d.exponent <= 22) {
+		r64 result = (r64)d.mantissa;
+		if (d.exponent < 0)
+			result /= ExactPowersOf10[-d.exponent];
+		else
+			result *= ExactPowersOf10[d.exponent];
+		*value = result;
+		return Number_Status_OK;
+	}
+
+	u64 bits = NumberEiselLemire(d.mantissa, d.exponent);
+
+	// Dropped digits put the exact value between mantissa and mantissa + 1
+	if (d.truncated && bits != NumberEiselLemire(d.mantissa + 1, d.exponent)) {
+		*value = NumberParseFloatSlow(first, last);
+	} else {
+		memcpy(value, &bits, sizeof(bits));
+	}
+
+	if (*value > DBL_MAX)
+		return Number_Status_OVERFLOW;
+
+	return Number_Status_OK;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "Platform.h"
+
+typedef enum Number_Status {
+	Number_Status_OK,
+	Number_Status_NO_DIGITS,
+	Number_Status_OVERFLOW,
+} Number_Status;
+
+// Parses a decimal, "0x" hex, "0b" binary or "0o" octal literal with optional "_" separators.
+// Digits are expected to be validated by the lexer.
+Number_Status NumberParseInteger(const u8 *first, const u8 *last, u64 *value);
+
+// Parses a decimal floating point literal with optional fraction, exponent and "_" separators,
+// the result is correctly rounded to nearest even.
+Number_Status NumberParseFloat(const u8 *first, const u8 *last, r64 *value);
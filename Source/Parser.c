@@ -1,123 +1,451 @@
 #include "Parser.h"
+#include "Utf8.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static const char *ExprKindNames[] = {
 	"Literal", "Identifier", "Unary Operator", "Binary Operator", "Assignment"
 };
 static_assert(ArrayCount(ExprKindNames) == Expr_Kind_COUNT, "");
 
-static Expr_Type_Integer ExprBuiltinUnsigned8  = { { Expr_Type_Id_INTEGER, 1 }, 0 };
-static Expr_Type_Integer ExprBuiltinUnsigned16 = { { Expr_Type_Id_INTEGER, 2 }, 0 };
-static Expr_Type_Integer ExprBuiltinUnsigned32 = { { Expr_Type_Id_INTEGER, 4 }, 0 };
-static Expr_Type_Integer ExprBuiltinUnsigned64 = { { Expr_Type_Id_INTEGER, 8 }, 0 };
-static Expr_Type_Integer ExprBuiltinSigned8    = { { Expr_Type_Id_INTEGER, 1 }, EXPR_TYPE_INTEGER_IS_SIGNED };
-static Expr_Type_Integer ExprBuiltinSigned16   = { { Expr_Type_Id_INTEGER, 2 }, EXPR_TYPE_INTEGER_IS_SIGNED };
-static Expr_Type_Integer ExprBuiltinSigned32   = { { Expr_Type_Id_INTEGER, 4 }, EXPR_TYPE_INTEGER_IS_SIGNED };
-static Expr_Type_Integer ExprBuiltinSigned64   = { { Expr_Type_Id_INTEGER, 8 }, EXPR_TYPE_INTEGER_IS_SIGNED };
+Expr_Type_Integer ExprBuiltinUnsigned8  = { { Expr_Type_Id_INTEGER, 1 }, 0 };
+Expr_Type_Integer ExprBuiltinUnsigned16 = { { Expr_Type_Id_INTEGER, 2 }, 0 };
+Expr_Type_Integer ExprBuiltinUnsigned32 = { { Expr_Type_Id_INTEGER, 4 }, 0 };
+Expr_Type_Integer ExprBuiltinUnsigned64 = { { Expr_Type_Id_INTEGER, 8 }, 0 };
+Expr_Type_Integer ExprBuiltinSigned8    = { { Expr_Type_Id_INTEGER, 1 }, EXPR_TYPE_INTEGER_IS_SIGNED };
+Expr_Type_Integer ExprBuiltinSigned16   = { { Expr_Type_Id_INTEGER, 2 }, EXPR_TYPE_INTEGER_IS_SIGNED };
+Expr_Type_Integer ExprBuiltinSigned32   = { { Expr_Type_Id_INTEGER, 4 }, EXPR_TYPE_INTEGER_IS_SIGNED };
+Expr_Type_Integer ExprBuiltinSigned64   = { { Expr_Type_Id_INTEGER, 8 }, EXPR_TYPE_INTEGER_IS_SIGNED };
+Expr_Type_Integer ExprBuiltinBool       = { { Expr_Type_Id_INTEGER, 1 }, EXPR_TYPE_INTEGER_IS_BOOL };
+Expr_Type         ExprBuiltinFloat64    = { Expr_Type_Id_FLOAT, 8 };
 
 //
 //
 //
 
-static void ExprTypeDump(FILE *out, Expr_Type *root) {
+static void ExprTypeDump(Dump_Buffer *out, Expr_Type *root) {
 	if (!root) return;
 
 	switch (root->id) {
 	case Expr_Type_Id_INTEGER:
 	{
 		Expr_Type_Integer *type = (Expr_Type_Integer *)root;
-		fprintf(out, "%c%d", (type->flags & EXPR_TYPE_INTEGER_IS_SIGNED) ? 's' : 'u', type->base.runtime_size << 3);
+		if (type->flags & EXPR_TYPE_INTEGER_IS_BOOL) {
+			DumpText(out, "bool");
+		} else {
+			DumpChar(out, (type->flags & EXPR_TYPE_INTEGER_IS_SIGNED) ? 's' : 'u');
+			DumpUnsigned(out, type->base.runtime_size << 3);
+		}
+	} break;
+
+	case Expr_Type_Id_FLOAT:
+	{
+		DumpChar(out, 'r');
+		DumpUnsigned(out, root->runtime_size << 3);
 	} break;
 	}
 }
 
-static void ExprDump(FILE *out, Expr *root, uint indent) {
-	for (uint i = 0; i < indent; ++i)
-		fprintf(out, "    ");
+static u8 ExprTypeCode(Expr_Type *type) {
+	if (!type) return 0;
 
-	const char *name = ExprKindNames[root->kind];
-	fprintf(out, ".%s", name);
+	u32 flags = type->id == Expr_Type_Id_INTEGER ? ((Expr_Type_Integer *)type)->flags : 0;
+	Assert(IsPower2(type->runtime_size) && flags < 4);
 
-	switch (root->kind) {
-	case Expr_Kind_Literal:
-	{
-		Expr_Literal *expr = (Expr_Literal *)root;
-		fprintf(out, "(%zu) ", expr->value.integer);
-		ExprTypeDump(out, root->type);
-		fprintf(out, "\n");
-	} break;
+	u8 code = (u8)((type->id + 1) << 6 | flags << 4);
+	for (u32 size = type->runtime_size; size > 1; size >>= 1)
+		code += 1;
+	return code;
+}
 
-	case Expr_Kind_Identifier:
-	{
-		Expr_Identifier *expr = (Expr_Identifier *)root;
-		fprintf(out, "(" StrFmt ") ", StrArg(expr->name));
-		ExprTypeDump(out, root->type);
-		fprintf(out, "\n");
-	} break;
+const char *ExprSymbolName(u32 symbol) {
+	switch (symbol) {
+	case '+': return "+";
+	case '-': return "-";
+	case '*': return "*";
+	case '/': return "/";
+	case EXPR_SYMBOL_SHIFT_LEFT:    return "<<";
+	case EXPR_SYMBOL_SHIFT_RIGHT:   return ">>";
+	case EXPR_SYMBOL_MULTIPLY_HIGH: return "*hi";
+	}
+	return "?";
+}
+
+// Pending subtrees of ExprNodeCount that fit on the C stack, deeper trees spill to an array
+#define EXPR_COUNT_STACK_LOCAL 64
+#define EXPR_COUNT_STACK_MAX   (MegaBytes(256) / sizeof(Expr *))
+
+umem ExprNodeCount(Expr *root) {
+	Expr *          local[EXPR_COUNT_STACK_LOCAL];
+	M_Array(Expr *) spill = { 0 };
+	imem            depth = 0;
+	umem            count = 0;
+
+	// Follows the left side and keeps the right one for later
+	for (Expr *expr = root; expr;) {
+		Expr *other = nullptr;
+		count += 1;
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+		case Expr_Kind_Identifier:
+			expr = nullptr;
+			break;
+
+		case Expr_Kind_Unary_Operator:
+			expr = ((Expr_Unary_Operator *)expr)->child;
+			break;
 
+		case Expr_Kind_Binary_Operator:
+			other = ((Expr_Binary_Operator *)expr)->right;
+			expr  = ((Expr_Binary_Operator *)expr)->left;
+			break;
+
+		case Expr_Kind_Assignment:
+			other = ((Expr_Assignment *)expr)->right;
+			expr  = ((Expr_Assignment *)expr)->left;
+			break;
+
+		NoDefaultCase();
+		}
+
+		if (other) {
+			if (depth < EXPR_COUNT_STACK_LOCAL) {
+				local[depth++] = other;
+			} else {
+				if (!spill.arena && !M_ArrayInit(&spill, EXPR_COUNT_STACK_MAX)) {
+					spill.arena = nullptr;
+					return 0;
+				}
+				Expr **slot = M_ArrayPush(&spill);
+				if (!slot) {
+					M_ArrayFree(&spill);
+					return 0;
+				}
+				*slot  = other;
+				depth += 1;
+			}
+		}
+
+		if (!expr && depth) {
+			depth -= 1;
+			expr = depth < EXPR_COUNT_STACK_LOCAL ? local[depth] : *M_ArrayPop(&spill);
+		}
+	}
+
+	if (spill.arena)
+		M_ArrayFree(&spill);
+	return count;
+}
+
+void ExprDump(Dump_Buffer *out, Expr *root) {
+	DumpPushFrame(out, root, 0);
+
+	Dump_Frame frame;
+	while (DumpPopFrame(out, &frame)) {
+		Expr *expr = (Expr *)frame.node;
+
+		DumpIndent(out, frame.depth);
+		DumpChar(out, '.');
+		DumpText(out, ExprKindNames[expr->kind]);
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+		{
+			Expr_Literal *literal = (Expr_Literal *)expr;
+			DumpChar(out, '(');
+			if (expr->type && expr->type->id == Expr_Type_Id_FLOAT)
+				DumpFloat(out, literal->value.floating);
+			else
+				DumpUnsigned(out, literal->value.integer);
+			DumpText(out, ") ");
+		} break;
+
+		case Expr_Kind_Identifier:
+		{
+			Expr_Identifier *identifier = (Expr_Identifier *)expr;
+			DumpChar(out, '(');
+			DumpString(out, identifier->name);
+			DumpText(out, ") ");
+			if (identifier->slot != EXPR_SLOT_NONE) {
+				DumpChar(out, '#');
+				DumpUnsigned(out, identifier->slot);
+				DumpChar(out, ' ');
+			}
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+		{
+			Expr_Unary_Operator *unary = (Expr_Unary_Operator *)expr;
+			DumpChar(out, '(');
+			DumpText(out, ExprSymbolName(unary->symbol));
+			DumpText(out, ") ");
+			DumpPushFrame(out, unary->child, frame.depth + 1);
+		} break;
+
+		case Expr_Kind_Binary_Operator:
+		{
+			Expr_Binary_Operator *binary = (Expr_Binary_Operator *)expr;
+			DumpChar(out, '(');
+			DumpText(out, ExprSymbolName(binary->symbol));
+			DumpText(out, ") ");
+			DumpPushFrame(out, binary->right, frame.depth + 1);
+			DumpPushFrame(out, binary->left, frame.depth + 1);
+		} break;
+
+		case Expr_Kind_Assignment:
+		{
+			Expr_Assignment *assign = (Expr_Assignment *)expr;
+			DumpText(out, "(=)");
+			DumpPushFrame(out, assign->right, frame.depth + 1);
+			DumpPushFrame(out, assign->left, frame.depth + 1);
+		} break;
+		}
+
+		ExprTypeDump(out, expr->type);
+		DumpChar(out, '\n');
+	}
+}
+
+void ExprDumpBinary(Dump_Buffer *out, Expr *root) {
+	DumpPushFrame(out, root, 0);
+
+	Dump_Frame frame;
+	while (DumpPopFrame(out, &frame)) {
+		Expr *expr = (Expr *)frame.node;
+
+		DumpChar(out, (char)expr->kind);
+		DumpChar(out, (char)ExprTypeCode(expr->type));
+
+		switch (expr->kind) {
+		case Expr_Kind_Literal:
+		{
+			DumpFixed64(out, ((Expr_Literal *)expr)->value.integer);
+		} break;
+
+		case Expr_Kind_Identifier:
+		{
+			Expr_Identifier *identifier = (Expr_Identifier *)expr;
+			DumpVarint(out, (u64)identifier->name.count);
+			DumpString(out, identifier->name);
+			DumpVarint(out, (u64)identifier->slot + 1);
+		} break;
+
+		case Expr_Kind_Unary_Operator:
+		{
+			Expr_Unary_Operator *unary = (Expr_Unary_Operator *)expr;
+			DumpVarint(out, unary->symbol);
+			DumpPushFrame(out, unary->child, 0);
+		} break;
+
+		case Expr_Kind_Binary_Operator:
+		{
+			Expr_Binary_Operator *binary = (Expr_Binary_Operator *)expr;
+			DumpVarint(out, binary->symbol);
+			DumpPushFrame(out, binary->right, 0);
+			DumpPushFrame(out, binary->left, 0);
+		} break;
+
+		case Expr_Kind_Assignment:
+		{
+			Expr_Assignment *assign = (Expr_Assignment *)expr;
+			DumpPushFrame(out, assign->right, 0);
+			DumpPushFrame(out, assign->left, 0);
+		} break;
+		}
+	}
+}
+
+typedef struct Expr_Compact_Frame {
+	Expr * expr;
+	Expr **link; // where the address of the copy goes
+} Expr_Compact_Frame;
+
+typedef M_Array(Expr_Compact_Frame) Expr_Compact_Stack;
+
+#define EXPR_COMPACT_STACK_MAX (MegaBytes(256) / sizeof(Expr_Compact_Frame))
+
+static umem ExprSize(Expr_Kind kind) {
+	switch (kind) {
+	case Expr_Kind_Literal:         return sizeof(Expr_Literal);
+	case Expr_Kind_Identifier:      return sizeof(Expr_Identifier);
+	case Expr_Kind_Unary_Operator:  return sizeof(Expr_Unary_Operator);
+	case Expr_Kind_Binary_Operator: return sizeof(Expr_Binary_Operator);
+	case Expr_Kind_Assignment:      return sizeof(Expr_Assignment);
+	NoDefaultCase();
+	}
+	return 0;
+}
+
+static bool ExprCompactPush(Expr_Compact_Stack *stack, Expr *expr, Expr **link) {
+	Expr_Compact_Frame *frame = M_ArrayPush(stack);
+	if (!frame)
+		return false;
+	frame->expr = expr;
+	frame->link = link;
+	return true;
+}
+
+// The right child goes on the stack first, so the left subtree comes right behind its parent
+static bool ExprCompactChildren(Expr_Compact_Stack *stack, Expr *src, Expr *dst) {
+	switch (src->kind) {
 	case Expr_Kind_Unary_Operator:
 	{
-		Expr_Unary_Operator *expr = (Expr_Unary_Operator *)root;
-		fprintf(out, "(%c) ", (char)expr->symbol);
-		ExprTypeDump(out, root->type);
-		fprintf(out, "\n");
-		ExprDump(out, expr->child, indent + 1);
-	} break;
+		Expr_Unary_Operator *unary = (Expr_Unary_Operator *)dst;
+		return ExprCompactPush(stack, ((Expr_Unary_Operator *)src)->child, dst ? &unary->child : nullptr);
+	}
 
 	case Expr_Kind_Binary_Operator:
 	{
-		Expr_Binary_Operator *expr = (Expr_Binary_Operator *)root;
-		fprintf(out, "(%c) ", (char)expr->symbol);
-		ExprTypeDump(out, root->type);
-		fprintf(out, "\n");
-		ExprDump(out, expr->left, indent + 1);
-		ExprDump(out, expr->right, indent + 1);
-	} break;
+		Expr_Binary_Operator *binary = (Expr_Binary_Operator *)dst;
+		return ExprCompactPush(stack, ((Expr_Binary_Operator *)src)->right, dst ? &binary->right : nullptr) &&
+			ExprCompactPush(stack, ((Expr_Binary_Operator *)src)->left, dst ? &binary->left : nullptr);
+	}
 
 	case Expr_Kind_Assignment:
 	{
-		Expr_Assignment *expr = (Expr_Assignment *)root;
-		fprintf(out, "(=)");
-		ExprTypeDump(out, root->type);
-		fprintf(out, "\n");
-		ExprDump(out, expr->left, indent + 1);
-		ExprDump(out, expr->right, indent + 1);
-	} break;
+		Expr_Assignment *assign = (Expr_Assignment *)dst;
+		return ExprCompactPush(stack, ((Expr_Assignment *)src)->right, dst ? &assign->right : nullptr) &&
+			ExprCompactPush(stack, ((Expr_Assignment *)src)->left, dst ? &assign->left : nullptr);
+	}
 	}
+	return true;
+}
+
+static bool ExprCompactMeasure(Expr_Compact_Stack *stack, Expr_Array statements, umem *nodes, umem *names) {
+	*nodes = sizeof(Expr *) * (umem)statements.count;
+	*names = 0;
+
+	for (imem index = 0; index < statements.count; ++index) {
+		if (!ExprCompactPush(stack, statements.data[index], nullptr))
+			return false;
+
+		while (stack->count) {
+			Expr *expr = M_ArrayPop(stack)->expr;
+
+			*nodes += AlignPower2Up(ExprSize(expr->kind), _Alignof(Expr));
+			if (expr->kind == Expr_Kind_Identifier)
+				*names += ((Expr_Identifier *)expr)->name.count;
+
+			if (!ExprCompactChildren(stack, expr, nullptr))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+umem ExprCompactSize(Expr_Array statements) {
+	Expr_Compact_Stack stack;
+	if (!M_ArrayInit(&stack, EXPR_COMPACT_STACK_MAX))
+		return 0;
+
+	umem nodes, names;
+	bool result = ExprCompactMeasure(&stack, statements, &nodes, &names);
+
+	M_ArrayFree(&stack);
+
+	return result ? nodes + names : 0;
+}
+
+Expr_Array ExprCompact(Expr_Array statements, M_Pool *pool) {
+	Expr_Array result = { 0 };
+
+	Expr_Compact_Stack stack;
+	if (!M_ArrayInit(&stack, EXPR_COMPACT_STACK_MAX))
+		return result;
+
+	umem nodes, names;
+	if (!ExprCompactMeasure(&stack, statements, &nodes, &names)) {
+		M_ArrayFree(&stack);
+		return result;
+	}
+
+	u8 *block = M_PoolPush(pool, nodes + names ? nodes + names : 1, _Alignof(Expr), 0);
+	if (!block) {
+		M_ArrayFree(&stack);
+		return result;
+	}
+
+	u8 *node  = block + sizeof(Expr *) * (umem)statements.count;
+	u8 *name  = block + nodes;
+
+	result.data  = (Expr **)block;
+	result.count = statements.count;
+
+	for (imem index = 0; index < statements.count; ++index) {
+		ExprCompactPush(&stack, statements.data[index], &result.data[index]);
+
+		while (stack.count) {
+			Expr_Compact_Frame frame = *M_ArrayPop(&stack);
+			Expr *             src   = frame.expr;
+			Expr *             dst   = (Expr *)node;
+			umem               size  = ExprSize(src->kind);
+
+			memcpy(dst, src, size);
+			node        += AlignPower2Up(size, _Alignof(Expr));
+			*frame.link  = dst;
+
+			if (src->kind == Expr_Kind_Identifier) {
+				Expr_Identifier *identifier = (Expr_Identifier *)dst;
+				memcpy(name, identifier->name.data, identifier->name.count);
+				identifier->name.data = name;
+				name += identifier->name.count;
+			}
+
+			// Measuring went through the same stack, it has room for every frame
+			ExprCompactChildren(&stack, src, dst);
+		}
+	}
+
+	Assert(node == block + nodes && name == block + nodes + names);
+
+	M_ArrayFree(&stack);
+
+	return result;
 }
 
 //
 //
 //
 
-typedef enum Log_Kind {
-	Log_Kind_INFO,
-	Log_Kind_WARNING,
-	Log_Kind_ERROR,
-	Log_Kind_FATAL
-} Log_Kind;
+static void Log(Parser *parser, Token_Range range, Diag_Kind kind, const char *fmt, va_list args) {
+	char message[DIAG_MESSAGE_MAX];
+	int  length = vsnprintf(message, sizeof(message), fmt, args);
 
-static void Log(Parser *parser, umem pos_0, umem pos_1, FILE *out, Log_Kind kind, const char *fmt, va_list args) {
-	umem r = 1, c = 0;
+	Diag diag    = { kind, parser->source };
+	diag.message = (String){ Clamp(0, (imem)sizeof(message) - 1, (imem)length), (u8 *)message };
 
-	u8 *data = parser->lexer.first;
-	for (umem pos = 0; pos < pos_0; ++pos) {
-		if (data[pos] != '\n') {
-			c += 1;
-		} else {
-			c = 0;
-			r += 1;
-		}
+	// The range may point into another file, e.g. the previous definition of a name
+	Source_File *file = parser->file;
+	if (file && range.from - file->base >= file->span)
+		file = SourceFind(SourceGlobal(), range.from);
+
+	if (file == parser->file) {
+		LexLocation(&parser->lexer, range.from, &diag.row, &diag.column);
+	} else if (file) {
+		SourceLocation(SourceGlobal(), range.from, &file, &diag.row, &diag.column);
 	}
 
-	static const char *LogKindNames[] = { "info", "warning", "error", "error" };
+	Source_Loc base = file ? file->base : 0;
+	if (file)
+		diag.source = file->name;
+	diag.from = range.from - base;
+	diag.to   = RangeEnd(range) - base;
+
+	if (kind >= Diag_Kind_ERROR)
+		parser->errors += 1;
 
-	fprintf(out, StrFmt "(%zu,%zu): %s: ", StrArg(parser->source), r, c, LogKindNames[kind]);
-	vfprintf(out, fmt, args);
-	fprintf(out, "\n");
+	Diag_Sink *sink = parser->sink ? parser->sink : DiagDefault();
+	DiagReport(sink, &diag);
 
-	if (kind == Log_Kind_FATAL) {
+	// Inside an entry point the parse ends and returns nothing, the process goes on
+	if (kind == Diag_Kind_FATAL) {
+		parser->failed = true;
+		if (parser->bail)
+			longjmp(*parser->bail, 1);
+		DiagFinish(sink);
 		exit(1);
 	}
 }
@@ -125,31 +453,53 @@ static void Log(Parser *parser, umem pos_0, umem pos_1, FILE *out, Log_Kind kind
 void Info(Parser *parser, Token_Range range, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	Log(parser, range.from, range.to, stdout, Log_Kind_INFO, fmt, args);
+	Log(parser, range, Diag_Kind_INFO, fmt, args);
 	va_end(args);
 }
 
 void Warning(Parser *parser, Token_Range range, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	Log(parser, range.from, range.to, stderr, Log_Kind_WARNING, fmt, args);
+	Log(parser, range, Diag_Kind_WARNING, fmt, args);
 	va_end(args);
 }
 
 void Error(Parser *parser, Token_Range range, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	Log(parser, range.from, range.to, stderr, Log_Kind_ERROR, fmt, args);
+	Log(parser, range, Diag_Kind_ERROR, fmt, args);
 	va_end(args);
 }
 
 void Fatal(Parser *parser, Token_Range range, const char *fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
-	Log(parser, range.from, range.to, stderr, Log_Kind_FATAL, fmt, args);
+	Log(parser, range, Diag_Kind_FATAL, fmt, args);
 	va_end(args);
 }
 
+// Reported once. Inside an entry point the parse ends right there, while ParserInit primes
+// the lookahead the rest of it reads as the end of the input and the entry point gives up.
+static void ParserOutOfMemory(Parser *parser, Token_Range range) {
+	if (!parser->exhausted) {
+		parser->exhausted = true;
+		Error(parser, range, "out of memory, the budget of %" PRIu64 " bytes is used up", (u64)parser->pool->budget);
+	}
+
+	if (parser->bail)
+		longjmp(*parser->bail, 1);
+}
+
+// Only returns with memory, pools without a budget end the process themselves
+static void *ParserPush(Parser *parser, umem size, u32 alignment, u32 flags) {
+	void *ptr = M_PoolPush(parser->pool, size, alignment, flags);
+	if (!ptr) {
+		ParserOutOfMemory(parser, parser->lookup[0].range);
+		Fatal(parser, parser->lookup[0].range, "out of memory");
+	}
+	return ptr;
+}
+
 //
 //
 //
@@ -157,7 +507,7 @@ void Fatal(Parser *parser, Token_Range range, const char *fmt, ...) {
 static Expr *ExprAllocate(Parser *parser, umem size, Expr_Kind kind, Token_Range range) {
 	const u32 alignment = _Alignof(Expr);
 
-	Expr *expr  = M_PoolPush(parser->pool, size, alignment, M_CLEAR_MEMORY);
+	Expr *expr  = ParserPush(parser, size, alignment, M_CLEAR_MEMORY);
 	expr->kind  = kind;
 	expr->range = range;
 
@@ -166,11 +516,44 @@ static Expr *ExprAllocate(Parser *parser, umem size, Expr_Kind kind, Token_Range
 
 #define AllocateExpr(parser, type, range) (Expr_##type *)ExprAllocate(parser, sizeof(Expr_##type), Expr_Kind_##type, range)
 
+// Floats win over integers, wider integers over narrower ones, untyped operands leave the result untyped
+Expr_Type *ExprUnaryType(Expr_Type *type) {
+	return type == &ExprBuiltinBool.base ? &ExprBuiltinUnsigned8.base : type;
+}
+
+Expr_Type *ExprBinaryType(Expr_Type *left, Expr_Type *right) {
+	if (!left || !right)
+		return nullptr;
+
+	if (left->id == Expr_Type_Id_FLOAT || right->id == Expr_Type_Id_FLOAT)
+		return &ExprBuiltinFloat64;
+
+	return ExprUnaryType(right->runtime_size > left->runtime_size ? right : left);
+}
+
+Expr_Type *ExprBuiltinType(u32 id, u32 runtime_size, u32 flags) {
+	static Expr_Type_Integer *Integers[] = {
+		&ExprBuiltinUnsigned8, &ExprBuiltinUnsigned16, &ExprBuiltinUnsigned32, &ExprBuiltinUnsigned64,
+		&ExprBuiltinSigned8, &ExprBuiltinSigned16, &ExprBuiltinSigned32, &ExprBuiltinSigned64, &ExprBuiltinBool,
+	};
+
+	if (id == Expr_Type_Id_FLOAT)
+		return runtime_size == ExprBuiltinFloat64.runtime_size ? &ExprBuiltinFloat64 : nullptr;
+
+	for (umem index = 0; index < ArrayCount(Integers); ++index) {
+		Expr_Type_Integer *type = Integers[index];
+		if (type->base.id == id && type->base.runtime_size == runtime_size && type->flags == flags)
+			return &type->base;
+	}
+
+	return nullptr;
+}
+
 //
 //
 //
 
-static int BinaryOpPrecedence[Token_Kind_END];
+static int BinaryOpPrecedence[Token_Kind_END + 1];
 
 static Token PeekToken(Parser *parser, uint index) {
 	Assert(index <= ArrayCount(parser->lookup));
@@ -185,15 +568,28 @@ static void AdvanceTokenHelper(Parser *parser) {
 	}
 
 	Token *token = &parser->lookup[lookup_max - 1];
+	if (parser->exhausted || parser->failed) {
+		token->kind = Token_Kind_END;
+		return;
+	}
+
 	if (!LexNext(&parser->lexer, token)) {
+		if (parser->lexer.exhausted) {
+			ParserOutOfMemory(parser, token->range);
+			return;
+		}
 		Fatal(parser, token->range, parser->lexer.error);
 	}
 }
 
 static void AdvanceToken(Parser *parser) {
 #ifdef PARSER_DUMP_TOKENS
-	fprintf(stdout, " Token");
-	LexDump(stdout, &parser->lookup[0]);
+	u8          memory[256];
+	Dump_Buffer out;
+	DumpInitFixed(&out, stderr, memory, sizeof(memory));
+	DumpText(&out, " Token");
+	LexDump(&out, &parser->lookup[0]);
+	DumpFree(&out);
 #endif
 
 	AdvanceTokenHelper(parser);
@@ -205,14 +601,11 @@ static Token NextToken(Parser *parser) {
 	return result;
 }
 
-static Expr *ParseExpression(Parser *parser, int prev_prec);
-
-static Expr *ParseTerm(Parser *parser) {
-	Token token = NextToken(parser);
-
+static Expr *ParseLeaf(Parser *parser, Token token) {
 	if (token.kind == Token_Kind_Identifier) {
 		Expr_Identifier *expr = AllocateExpr(parser, Identifier, token.range);
 		expr->name = token.value.string;
+		expr->slot = EXPR_SLOT_NONE;
 		return &expr->base;
 	}
 
@@ -223,21 +616,241 @@ static Expr *ParseTerm(Parser *parser) {
 		return &expr->base;
 	}
 
+	if (token.kind == Token_Kind_Float) {
+		Expr_Literal *expr = AllocateExpr(parser, Literal, token.range);
+		expr->value = token.value;
+		expr->base.type = &ExprBuiltinFloat64;
+		return &expr->base;
+	}
+
+	if (token.kind == Token_Kind_True || token.kind == Token_Kind_False) {
+		Expr_Literal *expr = AllocateExpr(parser, Literal, token.range);
+		expr->value.integer = token.kind == Token_Kind_True;
+		expr->base.type = &ExprBuiltinBool.base;
+		return &expr->base;
+	}
+
+	return nullptr;
+}
+
+//
+//
+//
+
+typedef enum Parse_Frame_Kind {
+	Parse_Frame_Binary,     // left operand and operator, waiting for the right operand
+	Parse_Frame_Assignment, // target, waiting for the value
+	Parse_Frame_Unary,      // operator, waiting for its term
+	Parse_Frame_Group,      // "(", waiting for the expression and the ")"
+} Parse_Frame_Kind;
+
+typedef struct Parse_Frame {
+	u16         kind;
+	u16         prec;
+	u32         symbol;
+	Token_Range range;
+	Expr *      left;
+} Parse_Frame;
+
+// Frames live in fixed size blocks so that no single allocation outgrows the pool,
+// blocks are kept once allocated and reused by the following statements
+#define PARSE_BLOCK_FRAMES 256
+
+struct Parse_Block {
+	Parse_Block *prev;
+	Parse_Block *next;
+	Parse_Frame  frames[PARSE_BLOCK_FRAMES];
+};
+
+// Lives on the C stack while an expression is parsed so the compiler can keep it in registers
+typedef struct Parse_Stack {
+	Parse_Block *block;
+	Parse_Frame *top; // one past the last frame in block
+	imem         depth;
+} Parse_Stack;
+
+static Parse_Frame *ParseNextBlock(Parser *parser, Parse_Stack *stack) {
+	Parse_Block *block = stack->block->next;
+
+	if (!block) {
+		block = ParserPush(parser, sizeof(Parse_Block), _Alignof(Parse_Block), 0);
+		block->prev = stack->block;
+		block->next = nullptr;
+		stack->block->next = block;
+	}
+
+	stack->block = block;
+	return block->frames;
+}
+
+static void ParsePush(Parser *parser, Parse_Stack *stack, Parse_Frame_Kind kind, int prec, Token *token, Expr *left) {
+	if (stack->top == stack->block->frames + PARSE_BLOCK_FRAMES)
+		stack->top = ParseNextBlock(parser, stack);
+
+	Parse_Frame *frame = stack->top++;
+	frame->kind   = (u16)kind;
+	frame->prec   = (u16)prec;
+	frame->symbol = token->value.symbol;
+	frame->range  = token->range;
+	frame->left   = left;
+
+	stack->depth += 1;
+}
+
+static void ParsePop(Parse_Stack *stack) {
+	stack->top   -= 1;
+	stack->depth -= 1;
+
+	if (stack->top == stack->block->frames && stack->block->prev) {
+		stack->block = stack->block->prev;
+		stack->top   = stack->block->frames + PARSE_BLOCK_FRAMES;
+	}
+}
+
+static void ParseCloseGroup(Parser *parser) {
+	Token token = NextToken(parser);
+	if (token.kind != Token_Kind_Bracket_Close) {
+		Fatal(parser, token.range, "expected \")\"");
+	}
+}
+
+// Precedence climbing with an explicit stack. A binary frame stands for the call that
+// parses its right operand, so its precedence is the one that operand has to beat,
+// groups and assignments start over at the lowest precedence. Nesting depth only
+// costs pool memory.
+static Expr *ParseExpression(Parser *parser) {
+	if (!parser->stack) {
+		parser->stack = ParserPush(parser, sizeof(Parse_Block), _Alignof(Parse_Block), 0);
+		parser->stack->prev = nullptr;
+		parser->stack->next = nullptr;
+	}
+
+	Parse_Stack stack = { parser->stack, parser->stack->frames, 0 };
+
+	for (;;) {
+		Token token = NextToken(parser);
+		Expr *expr  = ParseLeaf(parser, token);
+
+		if (!expr) {
+			if (token.kind == Token_Kind_Plus || token.kind == Token_Kind_Minus) {
+				ParsePush(parser, &stack, Parse_Frame_Unary, 0, &token, nullptr);
+				continue;
+			}
+
+			if (token.kind == Token_Kind_Bracket_Open) {
+				ParsePush(parser, &stack, Parse_Frame_Group, 0, &token, nullptr);
+				continue;
+			}
+
+			Fatal(parser, token.range, "invalid expression");
+		}
+
+		// Hand the operand down until a frame needs another term. An assignment ends
+		// the expression it appears in, the frame below then completes without looking
+		// at the next operator.
+		bool ended = false;
+
+		for (;;) {
+			Parse_Frame *frame = stack.depth ? stack.top - 1 : nullptr;
+
+			if (frame && frame->kind == Parse_Frame_Unary) {
+				Expr_Unary_Operator *op = AllocateExpr(parser, Unary_Operator, frame->range);
+				op->child = expr;
+				op->symbol = frame->symbol;
+				op->base.type = ExprUnaryType(expr->type);
+
+				expr = &op->base;
+				ParsePop(&stack);
+				continue;
+			}
+
+			if (!ended) {
+				Token_Kind next = parser->lookup[0].kind;
+
+				if (next == Token_Kind_Equals) {
+					ParsePush(parser, &stack, Parse_Frame_Assignment, 0, &parser->lookup[0], expr);
+					AdvanceToken(parser);
+					break;
+				}
+
+				// Only binary operators have a precedence above zero
+				int prec = BinaryOpPrecedence[next];
+				if (prec > (frame ? frame->prec : 0)) {
+					ParsePush(parser, &stack, Parse_Frame_Binary, prec, &parser->lookup[0], expr);
+					AdvanceToken(parser);
+					break;
+				}
+			}
+
+			if (!frame)
+				return expr;
+
+			ended = false;
+
+			switch (frame->kind) {
+			case Parse_Frame_Binary:
+			{
+				Expr_Binary_Operator *op = AllocateExpr(parser, Binary_Operator, frame->range);
+				op->left = frame->left;
+				op->right = expr;
+				op->symbol = frame->symbol;
+				op->base.type = ExprBinaryType(op->left->type, op->right->type);
+
+				expr = &op->base;
+			} break;
+
+			case Parse_Frame_Assignment:
+			{
+				Expr_Assignment *assign = AllocateExpr(parser, Assignment, frame->range);
+				assign->left = frame->left;
+				assign->right = expr;
+				assign->base.type = assign->right->type;
+
+				expr = &assign->base;
+				ended = true;
+			} break;
+
+			case Parse_Frame_Group:
+			{
+				ParseCloseGroup(parser);
+			} break;
+
+			NoDefaultCase();
+			}
+
+			ParsePop(&stack);
+		}
+	}
+}
+
+#ifdef PARSER_BENCH
+
+// The recursive formulation, kept to compare trees and speed against in Tools/ParserBench.c
+
+static bool IsBinaryOpToken(Token_Kind kind) {
+	return kind == Token_Kind_Plus || kind == Token_Kind_Minus || kind == Token_Kind_Multiply || kind == Token_Kind_Divide;
+}
+
+static Expr *ParseExpressionRec(Parser *parser, int prev_prec);
+
+static Expr *ParseTermRec(Parser *parser) {
+	Token token = NextToken(parser);
+
+	Expr *leaf = ParseLeaf(parser, token);
+	if (leaf)
+		return leaf;
+
 	if (token.kind == Token_Kind_Plus || token.kind == Token_Kind_Minus) {
 		Expr_Unary_Operator *expr = AllocateExpr(parser, Unary_Operator, token.range);
-		expr->child = ParseTerm(parser);
+		expr->child = ParseTermRec(parser);
 		expr->symbol = token.value.symbol;
+		expr->base.type = ExprUnaryType(expr->child->type);
 		return &expr->base;
 	}
 
 	if (token.kind == Token_Kind_Bracket_Open) {
-		Expr *expr = ParseExpression(parser, 0);
-
-		token = NextToken(parser);
-		if (token.kind != Token_Kind_Bracket_Close) {
-			Fatal(parser, token.range, "expected \")\"");
-		}
-
+		Expr *expr = ParseExpressionRec(parser, 0);
+		ParseCloseGroup(parser);
 		return expr;
 	}
 
@@ -246,10 +859,8 @@ static Expr *ParseTerm(Parser *parser) {
 	return nullptr;
 }
 
-static const Token_Kind BinaryOpTokens[] = { Token_Kind_Plus, Token_Kind_Minus, Token_Kind_Multiply, Token_Kind_Divide };
-
-static Expr *ParseExpression(Parser *parser, int prev_prec) {
-	Expr *expr = ParseTerm(parser);
+static Expr *ParseExpressionRec(Parser *parser, int prev_prec) {
+	Expr *expr = ParseTermRec(parser);
 
 	for (Token token = PeekToken(parser, 0);
 		token.kind != Token_Kind_END;
@@ -260,7 +871,8 @@ static Expr *ParseExpression(Parser *parser, int prev_prec) {
 
 			Expr_Assignment *assign = AllocateExpr(parser, Assignment, token.range);
 			assign->left = expr;
-			assign->right = ParseExpression(parser, 0);
+			assign->right = ParseExpressionRec(parser, 0);
+			assign->base.type = assign->right->type;
 			
 			expr = &assign->base;
 			break;
@@ -271,31 +883,42 @@ static Expr *ParseExpression(Parser *parser, int prev_prec) {
 		if (prec <= prev_prec)
 			break;
 
-		for (int index = 0; index < ArrayCount(BinaryOpTokens); ++index) {
-			Token_Kind match = BinaryOpTokens[index];
-			if (match == token.kind) {
-				AdvanceToken(parser);
+		if (IsBinaryOpToken(token.kind)) {
+			AdvanceToken(parser);
 
-				Expr_Binary_Operator *op = AllocateExpr(parser, Binary_Operator, token.range);
-				op->left = expr;
-				op->right = ParseExpression(parser, prec);
-				op->symbol = token.value.symbol;
+			Expr_Binary_Operator *op = AllocateExpr(parser, Binary_Operator, token.range);
+			op->left = expr;
+			op->right = ParseExpressionRec(parser, prec);
+			op->symbol = token.value.symbol;
+			op->base.type = ExprBinaryType(op->left->type, op->right->type);
 
-				expr = &op->base;
-				break;
-			}
+			expr = &op->base;
 		}
 	}
 
 	return expr;
 }
 
+Expr *ParseExpressionRecursive(Parser *parser) {
+	return ParseExpressionRec(parser, 0);
+}
+
+Expr *ParseExpressionIterative(Parser *parser) {
+	return ParseExpression(parser);
+}
+
+#endif
+
 static Expr *ParseStatement(Parser *parser) {
-	Expr *expr = ParseExpression(parser, 0);
+	Expr *expr = ParseExpression(parser);
 
 #ifdef PARSER_DUMP_EXPR
-	fprintf(stdout, "\n");
-	ExprDump(stdout, expr, 0);
+	u8          memory[KiloBytes(4)];
+	Dump_Buffer out;
+	DumpInitFixed(&out, stderr, memory, sizeof(memory));
+	DumpChar(&out, '\n');
+	ExprDump(&out, expr);
+	DumpFree(&out);
 #endif
 
 	return expr;
@@ -307,27 +930,125 @@ static void InitParser(void) {
 	if (Initialized) return;
 	Initialized = true;
 
-	LexInitTable();
-
 	BinaryOpPrecedence[Token_Kind_Plus] = 10;
 	BinaryOpPrecedence[Token_Kind_Minus] = 10;
 	BinaryOpPrecedence[Token_Kind_Multiply] = 20;
 	BinaryOpPrecedence[Token_Kind_Divide] = 20;
 }
 
-Expr *Parse(String stream, String source, M_Pool *pool) {
+static void ParserPrime(Parser *parser) {
 	InitParser();
 
+	for (uint i = 0; i < ArrayCount(parser->lookup); ++i) {
+		AdvanceTokenHelper(parser);
+	}
+}
+
+void ParserInit(Parser *parser, String stream, String source, M_Pool *pool) {
+	memset(parser, 0, sizeof(*parser));
+	parser->pool   = pool;
+	parser->source = source;
+	parser->file   = SourceAdd(SourceGlobal(), source, stream);
+
+	LexInit(&parser->lexer, stream, parser->file, pool);
+
+	// The lexer stops at the first invalid sequence, all of them are reported up front
+	if (parser->lexer.invalid) {
+		Lexer *lexer = &parser->lexer;
+		umem   pos   = lexer->last - lexer->first;
+
+		while (pos < (umem)stream.count) {
+			umem length = Utf8InvalidLength(stream.data, stream.count, pos);
+			Error(parser, (Token_Range){ (Source_Loc)(lexer->offset + pos), (u32)length }, "invalid UTF-8 sequence");
+
+			pos += length;
+			pos += Utf8Validate(stream.data + pos, stream.count - pos, nullptr);
+		}
+	}
+
+	// A fatal diagnostic this early leaves the parser failed, the entry points then give up
+	jmp_buf bail;
+	if (!setjmp(bail)) {
+		parser->bail = &bail;
+		ParserPrime(parser);
+	}
+	parser->bail = nullptr;
+}
+
+typedef struct Expr_Link {
+	Expr *            expr;
+	struct Expr_Link *next;
+} Expr_Link;
+
+Expr_Array ParseStatements(Parser *parser) {
+	Expr_Array statements = { 0 };
+
+	jmp_buf bail;
+	if (parser->exhausted || parser->failed || setjmp(bail)) {
+		parser->bail = nullptr;
+		return (Expr_Array){ 0 };
+	}
+	parser->bail = &bail;
+
+	Expr_Link * first = nullptr;
+	Expr_Link **tail  = &first;
+
+	while (PeekToken(parser, 0).kind != Token_Kind_END) {
+		Expr_Link *link = ParserPush(parser, sizeof(Expr_Link), _Alignof(Expr_Link), 0);
+		link->expr = ParseStatement(parser);
+		link->next = nullptr;
+
+		*tail = link;
+		tail  = &link->next;
+
+		statements.count += 1;
+	}
+
+	statements.data = ParserPush(parser, sizeof(Expr *) * statements.count, _Alignof(Expr *), 0);
+
+	imem index = 0;
+	for (Expr_Link *link = first; link; link = link->next)
+		statements.data[index++] = link->expr;
+
+	parser->bail = nullptr;
+	return statements;
+}
+
+Expr *Parse(String stream, String source, M_Pool *pool) {
+	Parser parser;
+	ParserInit(&parser, stream, source, pool);
+
+	jmp_buf bail;
+	if (parser.exhausted || parser.failed || setjmp(bail))
+		return nullptr;
+	parser.bail = &bail;
+
+	return ParseStatement(&parser);
+}
+
+Expr *ParseStream(Lex_Refill refill, void *context, umem chunk, String source, M_Pool *pool) {
 	Parser parser = {0};
 	parser.pool   = pool;
 	parser.source = source;
+	parser.file   = SourceAddStream(SourceGlobal(), source);
 
-	LexInit(&parser.lexer, stream, pool);
+	LexInitStream(&parser.lexer, refill, context, chunk, parser.file, pool);
 
-	for (uint i = 0; i < ArrayCount(parser.lookup); ++i) {
-		AdvanceTokenHelper(&parser);
+	// The lexer's window has to be given back either way
+	Expr *volatile expr = nullptr;
+	jmp_buf        bail;
+	if (!setjmp(bail)) {
+		parser.bail = &bail;
+		ParserPrime(&parser);
+		expr = ParseStatement(&parser);
 	}
+	parser.bail = nullptr;
+
+	// Locations past what was read are never handed out, the next file can have them
+	if (parser.file)
+		SourceTrim(SourceGlobal(), parser.file, parser.lexer.offset + (parser.lexer.last - parser.lexer.first) - parser.file->base);
+
+	LexFree(&parser.lexer);
 
-	Expr *expr = ParseStatement(&parser);
 	return expr;
 }
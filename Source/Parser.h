@@ -1,6 +1,10 @@
 #pragma once
 #include "Lexer.h"
+#include "Diagnostic.h"
 
+#include <setjmp.h>
+
+// Debug builds trace every token and statement to stderr, stdout is left to the results
 #ifdef BUILD_DEBUG
 #define PARSER_DUMP_TOKENS
 #define PARSER_DUMP_EXPR
@@ -8,6 +12,7 @@
 
 typedef enum Expr_Type_Id {
 	Expr_Type_Id_INTEGER,
+	Expr_Type_Id_FLOAT,
 
 	Expr_Type_Id_COUNT
 } Expr_Type_Id;
@@ -18,7 +23,8 @@ typedef struct Expr_Type {
 } Expr_Type;
 
 enum Expr_Type_Integer_Flags {
-	EXPR_TYPE_INTEGER_IS_SIGNED = 0x1
+	EXPR_TYPE_INTEGER_IS_SIGNED = 0x1,
+	EXPR_TYPE_INTEGER_IS_BOOL   = 0x2, // one byte holding 0 or 1, arithmetic on it gives u8
 };
 
 typedef struct Expr_Type_Integer {
@@ -26,6 +32,24 @@ typedef struct Expr_Type_Integer {
 	u32       flags;
 } Expr_Type_Integer;
 
+extern Expr_Type_Integer ExprBuiltinUnsigned8;
+extern Expr_Type_Integer ExprBuiltinUnsigned16;
+extern Expr_Type_Integer ExprBuiltinUnsigned32;
+extern Expr_Type_Integer ExprBuiltinUnsigned64;
+extern Expr_Type_Integer ExprBuiltinSigned8;
+extern Expr_Type_Integer ExprBuiltinSigned16;
+extern Expr_Type_Integer ExprBuiltinSigned32;
+extern Expr_Type_Integer ExprBuiltinSigned64;
+extern Expr_Type_Integer ExprBuiltinBool;
+extern Expr_Type         ExprBuiltinFloat64;
+
+Expr_Type *ExprUnaryType(Expr_Type *type);
+Expr_Type *ExprBinaryType(Expr_Type *left, Expr_Type *right);
+
+// The builtin with this id, size and integer flags, null when there is none. For types read
+// back from files, which store them by value.
+Expr_Type *ExprBuiltinType(u32 id, u32 runtime_size, u32 flags);
+
 //
 //
 //
@@ -51,11 +75,35 @@ typedef struct Expr_Literal {
 	Token_Value value;
 } Expr_Literal;
 
+#define EXPR_SLOT_NONE ((u32)-1)
+
 typedef struct Expr_Identifier {
 	Expr   base;
 	String name;
+	u32    slot; // frame slot or graph variable, EXPR_SLOT_NONE until resolved
 } Expr_Identifier;
 
+// Operators without a token of their own, only produced by Simplify. The signed variants
+// are picked by the type of the operator node, as for division.
+enum Expr_Symbol {
+	EXPR_SYMBOL_SHIFT_LEFT = 0x100,
+	EXPR_SYMBOL_SHIFT_RIGHT,    // arithmetic for signed types
+	EXPR_SYMBOL_MULTIPLY_HIGH,  // upper half of the 128 bit product
+};
+
+const char *ExprSymbolName(u32 symbol);
+umem        ExprNodeCount(Expr *root); // 0 when the walk runs out of memory
+
+// One node per line, indented by depth, the text PARSER_DUMP_EXPR prints
+void        ExprDump(Dump_Buffer *out, Expr *root);
+
+// The same nodes in the same order, each one as
+//   kind:u8 type:u8 payload
+// where type is 0 when unresolved, else (id + 1) << 6 | integer flags << 4 | log2(size).
+// Literals carry their 8 value bytes, identifiers a varint length, the name and a varint
+// slot + 1 (0 when unresolved), operators a varint symbol. Children follow their parent.
+void        ExprDumpBinary(Dump_Buffer *out, Expr *root);
+
 typedef struct Expr_Unary_Operator {
 	Expr  base;
 	Expr *child;
@@ -75,20 +123,66 @@ typedef struct Expr_Assignment {
 	Expr *right;
 } Expr_Assignment;
 
+inproc bool ExprIsSigned(Expr *expr) {
+	return expr->type && expr->type->id == Expr_Type_Id_INTEGER &&
+		(((Expr_Type_Integer *)expr->type)->flags & EXPR_TYPE_INTEGER_IS_SIGNED);
+}
+
+typedef struct Expr_Array {
+	imem   count;
+	Expr **data;
+} Expr_Array;
+
+// Copies the trees into a single push from `pool`, each one in pre-order: a parent, then its
+// left subtree, then its right one. The names go behind the nodes, so the copy does not point
+// into the pool or the stream the trees came from and either can be released. Later passes
+// then walk the trees front to back. ExprCompactSize is the size of the push, the cap of the
+// pool has to be at least that. The array is empty when the pool's budget has no room for it.
+umem       ExprCompactSize(Expr_Array statements);
+Expr_Array ExprCompact(Expr_Array statements, M_Pool *pool);
+
 //
 //
 //
 
+typedef struct Parse_Block Parse_Block;
+
 typedef struct Parser {
-	Lexer   lexer;
-	Token   lookup[4];
-	M_Pool *pool;
-	String  source;
+	Lexer         lexer;
+	Token         lookup[4];
+	M_Pool *      pool;
+	Source_File * file;  // where the input sits in SourceGlobal(), null when it did not fit
+	String        source;
+	Diag_Sink *   sink; // DiagDefault() when null
+	u32           errors; // errors and fatal errors reported, the sink may have dropped some of them
+
+	Parse_Block * stack; // pending operators and groups, replaces recursion while parsing expressions
+
+	// Set once the pool's budget is used up, see M_PoolInitBudget, or by a fatal diagnostic.
+	// Everything after that is reported as the end of the input and the entry point gives up
+	// through `bail`.
+	bool          exhausted;
+	bool          failed;
+	jmp_buf *     bail;
 } Parser;
 
 void  Info(Parser *parser, Token_Range range, const char *fmt, ...);
 void  Warning(Parser *parser, Token_Range range, const char *fmt, ...);
 void  Error(Parser *parser, Token_Range range, const char *fmt, ...);
+
+// Ends the parse, the entry point returns nothing as when the budget runs out. Called outside
+// of one it ends the process.
 void  Fatal(Parser *parser, Token_Range range, const char *fmt, ...);
 
+// When the pool has a budget and it runs out, or on a fatal diagnostic, the parse stops and
+// returns nothing, an empty array from ParseStatements and null from the others
+void       ParserInit(Parser *parser, String stream, String source, M_Pool *pool);
+Expr_Array ParseStatements(Parser *parser);
+
+#ifdef PARSER_BENCH
+Expr *ParseExpressionRecursive(Parser *parser);
+Expr *ParseExpressionIterative(Parser *parser);
+#endif
+
 Expr *Parse(String stream, String source, M_Pool *pool);
+Expr *ParseStream(Lex_Refill refill, void *context, umem chunk, String source, M_Pool *pool);
@@ -0,0 +1,220 @@
+#include "Perf.h"
+
+#include <string.h>
+
+static const char *PerfPhaseNames[] = {
+	"lex", "parse", "resolve", "simplify", "schedule", "eval", "native"
+};
+
+static_assert(ArrayCount(PerfPhaseNames) == Perf_Phase_COUNT, "");
+
+static const char *PerfCounterNames[] = {
+	"cycles", "instructions", "cache misses", "branch misses"
+};
+
+static_assert(ArrayCount(PerfCounterNames) == Perf_Counter_COUNT, "");
+
+#if PLATFORM_WINDOWS == 1
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#pragma warning(pop)
+
+static u64 PerfNow(void) {
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (u64)((r64)counter.QuadPart * 1e9 / (r64)frequency.QuadPart);
+}
+#else
+#include <time.h>
+
+static u64 PerfNow(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (u64)now.tv_sec * 1000000000 + (u64)now.tv_nsec;
+}
+#endif
+
+#if PLATFORM_LINUX == 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const u64 PerfEventConfigs[] = {
+	PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static_assert(ArrayCount(PerfEventConfigs) == Perf_Counter_COUNT, "");
+
+static int PerfOpen(u64 config, int leader) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+
+	attr.size           = sizeof(attr);
+	attr.type           = PERF_TYPE_HARDWARE;
+	attr.config         = config;
+	attr.disabled       = leader < 0; // members start and stop with their leader
+	attr.exclude_kernel = 1;          // user space only is allowed up to perf_event_paranoid 2
+	attr.exclude_hv     = 1;
+	attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+}
+
+bool PerfInit(Perf *perf) {
+	memset(perf, 0, sizeof(*perf));
+	perf->phase  = Perf_Phase_COUNT;
+	perf->leader = -1;
+
+	// Counters the hardware lacks are left out, the first one that opens leads the group
+	for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter) {
+		perf->fds[counter] = PerfOpen(PerfEventConfigs[counter], perf->leader);
+		if (perf->fds[counter] < 0)
+			continue;
+
+		if (perf->leader < 0)
+			perf->leader = perf->fds[counter];
+		perf->slots[counter] = perf->opened++;
+	}
+
+	if (perf->leader < 0)
+		return false;
+
+	if (ioctl(perf->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+		PerfFree(perf);
+		return false;
+	}
+
+	return true;
+}
+
+void PerfFree(Perf *perf) {
+	for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter) {
+		if (perf->fds[counter] >= 0)
+			close(perf->fds[counter]);
+		perf->fds[counter] = -1;
+	}
+	perf->leader = -1;
+	perf->opened = 0;
+}
+
+static void PerfRead(Perf *perf, Perf_Sample *sample) {
+	if (perf->leader < 0)
+		return;
+
+	// Group layout: number of counters, time enabled, time running, then one value per counter
+	u64     data[3 + Perf_Counter_COUNT];
+	ssize_t size = read(perf->leader, data, sizeof(data));
+	if (size != (ssize_t)((3 + perf->opened) * sizeof(u64)))
+		return;
+
+	sample->enabled = data[1];
+	sample->running = data[2];
+	for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter) {
+		if (perf->fds[counter] >= 0)
+			sample->counters[counter] = data[3 + perf->slots[counter]];
+	}
+}
+#else
+bool PerfInit(Perf *perf) {
+	memset(perf, 0, sizeof(*perf));
+	perf->phase  = Perf_Phase_COUNT;
+	perf->leader = -1;
+	for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter)
+		perf->fds[counter] = -1;
+	return false;
+}
+
+void PerfFree(Perf *perf) {
+}
+
+static void PerfRead(Perf *perf, Perf_Sample *sample) {
+}
+#endif
+
+void PerfBegin(Perf *perf, Perf_Phase phase) {
+	Assert(perf->phase == Perf_Phase_COUNT && phase < Perf_Phase_COUNT);
+	perf->phase = phase;
+
+	memset(&perf->start, 0, sizeof(perf->start));
+	PerfRead(perf, &perf->start);
+	perf->start.nanoseconds = PerfNow();
+}
+
+void PerfEnd(Perf *perf) {
+	Assert(perf->phase < Perf_Phase_COUNT);
+
+	// Time first, so that it does not include reading the counters
+	Perf_Sample end;
+	memset(&end, 0, sizeof(end));
+	end.nanoseconds = PerfNow();
+	PerfRead(perf, &end);
+
+	Perf_Totals *totals = &perf->totals[perf->phase];
+	totals->passes      += 1;
+	totals->nanoseconds += end.nanoseconds - perf->start.nanoseconds;
+
+	// While other groups need the PMU, counting is time sliced, scale up to the whole pass
+	u64 enabled = end.enabled - perf->start.enabled;
+	u64 running = end.running - perf->start.running;
+
+	for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter) {
+		u64 delta = end.counters[counter] - perf->start.counters[counter];
+		if (running && running < enabled)
+			delta = (u64)((r64)delta * (r64)enabled / (r64)running);
+		totals->counters[counter] += delta;
+	}
+
+	perf->phase = Perf_Phase_COUNT;
+}
+
+void PerfAdd(Perf *perf, Perf_Phase phase, umem bytes, umem nodes) {
+	perf->totals[phase].bytes += bytes;
+	perf->totals[phase].nodes += nodes;
+}
+
+static void PerfReportValue(FILE *out, const char *name, u64 value, r64 megabytes, u64 nodes) {
+	fprintf(out, "  %-14s %16" PRIu64, name, value);
+
+	if (megabytes > 0) {
+		fprintf(out, " %16.1f /MB", (r64)value / megabytes);
+	} else {
+		fprintf(out, " %20s", "");
+	}
+
+	if (nodes)
+		fprintf(out, " %12.2f /node", (r64)value / (r64)nodes);
+
+	fprintf(out, "\n");
+}
+
+void PerfReport(Perf *perf, FILE *out) {
+	if (perf->leader < 0)
+		fprintf(out, "hardware counters are not available, only time is measured\n");
+
+	for (u32 phase = 0; phase < Perf_Phase_COUNT; ++phase) {
+		Perf_Totals *totals    = &perf->totals[phase];
+		r64          megabytes = (r64)totals->bytes / (r64)MegaBytes(1);
+
+		if (!totals->passes)
+			continue;
+
+		fprintf(out, "%s: %" PRIu64 " passes, %.3f ms, %.2f MB, %" PRIu64 " nodes\n", PerfPhaseNames[phase],
+			totals->passes, (r64)totals->nanoseconds / 1e6, megabytes, totals->nodes);
+
+		PerfReportValue(out, "nanoseconds", totals->nanoseconds, megabytes, totals->nodes);
+
+		for (u32 counter = 0; counter < Perf_Counter_COUNT; ++counter) {
+			if (perf->fds[counter] >= 0)
+				PerfReportValue(out, PerfCounterNames[counter], totals->counters[counter], megabytes, totals->nodes);
+		}
+
+		u64 cycles = totals->counters[Perf_Counter_Cycles];
+		if (perf->fds[Perf_Counter_Cycles] >= 0 && perf->fds[Perf_Counter_Instructions] >= 0 && cycles)
+			fprintf(out, "  %-14s %16.2f\n", "IPC", (r64)totals->counters[Perf_Counter_Instructions] / (r64)cycles);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "Platform.h"
+
+#include <stdio.h>
+
+// Opt-in counters per compilation phase. On Linux, cycles, instructions, cache misses and
+// branch misses are opened with perf_event_open as one group, so all of them count over the
+// same stretch of code and come back in a single read at every phase boundary. Only the
+// calling thread is counted, work handed to other threads shows up in the time alone.
+//
+// Where the kernel refuses (perf_event_paranoid, containers, virtual machines without a PMU)
+// and on other platforms, only time is measured. A phase can be entered any number of times,
+// every pass adds to its totals, and the report divides them by the megabytes of input and
+// the expression nodes each pass went over.
+
+typedef enum Perf_Phase {
+	Perf_Phase_Lex,
+	Perf_Phase_Parse,
+	Perf_Phase_Resolve,
+	Perf_Phase_Simplify,
+	Perf_Phase_Schedule,
+	Perf_Phase_Eval,
+	Perf_Phase_Native,
+
+	Perf_Phase_COUNT
+} Perf_Phase;
+
+typedef enum Perf_Counter {
+	Perf_Counter_Cycles,
+	Perf_Counter_Instructions,
+	Perf_Counter_Cache_Misses,
+	Perf_Counter_Branch_Misses,
+
+	Perf_Counter_COUNT
+} Perf_Counter;
+
+typedef struct Perf_Totals {
+	u64 passes;
+	u64 nanoseconds;
+	u64 counters[Perf_Counter_COUNT];
+	u64 bytes; // input the passes went over
+	u64 nodes; // expression nodes the passes went over
+} Perf_Totals;
+
+typedef struct Perf_Sample {
+	u64 nanoseconds;
+	u64 enabled; // the group shares the PMU with others when it is not running all the time
+	u64 running;
+	u64 counters[Perf_Counter_COUNT];
+} Perf_Sample;
+
+typedef struct Perf {
+	int         leader;                    // -1 in time only mode
+	int         fds[Perf_Counter_COUNT];   // -1 for counters the hardware does not have
+	u32         slots[Perf_Counter_COUNT]; // position of each counter in a group read
+	u32         opened;
+
+	Perf_Phase  phase; // Perf_Phase_COUNT outside of PerfBegin and PerfEnd
+	Perf_Sample start;
+	Perf_Totals totals[Perf_Phase_COUNT];
+} Perf;
+
+// False when only time is measured, the Perf is usable either way
+bool PerfInit(Perf *perf);
+void PerfFree(Perf *perf);
+
+// Phases do not nest, end one before beginning the next
+void PerfBegin(Perf *perf, Perf_Phase phase);
+void PerfEnd(Perf *perf);
+
+// Input a phase went over. Can be given outside of PerfBegin and PerfEnd, so that working it
+// out is not counted as part of the phase.
+void PerfAdd(Perf *perf, Perf_Phase phase, umem bytes, umem nodes);
+
+// Totals of every phase that ran, call it before PerfFree or the counters are left out
+void PerfReport(Perf *perf, FILE *out);
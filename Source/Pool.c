@@ -8,24 +8,56 @@ static void *ErrorOutOfMemory() {
 	return nullptr;
 }
 
+// M_ArenaAllocate rounds reservations up to this
+#define M_POOL_GRANULARITY KiloBytes(64)
+
 void M_PoolInit(M_Pool *pool, umem cap) {
-	pool->first = M_ArenaAllocate(0, 0);
-	pool->cap   = cap;
+	pool->first    = M_ArenaAllocate(0, 0);
+	pool->cap      = cap;
+	pool->budget   = 0;
+	pool->reserved = 0;
+}
+
+void M_PoolInitBudget(M_Pool *pool, umem cap, umem budget) {
+	M_PoolInit(pool, cap);
+	pool->budget = budget;
+}
+
+// Null when the system or the budget has no room for an arena that can take `size` bytes
+static M_Arena *M_PoolAddArena(M_Pool *pool, umem size, u32 alignment) {
+	umem reserve = pool->cap;
+
+	if (pool->budget) {
+		umem left = pool->budget > pool->reserved ? pool->budget - pool->reserved : 0;
+		reserve   = AlignPower2Down(Min(reserve, left), M_POOL_GRANULARITY);
+		if (reserve < sizeof(M_Arena) + alignment + size)
+			return nullptr;
+	}
+
+	M_Arena *arena = M_ArenaAllocate(reserve, 0);
+	if (!arena->reserved)
+		return nullptr;
+
+	arena->next     = pool->first;
+	pool->first     = arena;
+	pool->reserved += arena->reserved;
+	return arena;
 }
 
 void *M_PoolPush(M_Pool *pool, umem size, u32 alignment, u32 flags) {
 	if (size <= pool->cap) {
-		void *ptr = M_PushSizeAligned(pool->first, size, alignment, flags);
-		if (ptr) return ptr;
+		// The empty arena new pools start with is shared, even a failed push writes to it
+		if (pool->first->reserved) {
+			void *ptr = M_PushSizeAligned(pool->first, size, alignment, flags);
+			if (ptr) return ptr;
+		}
 
-		M_Arena *arena = M_ArenaAllocate(pool->cap, 0);
-		arena->next    = pool->first;
-		pool->first    = arena;
-
-		ptr = M_PushSizeAligned(pool->first, size, alignment, flags);
-		if (ptr) return ptr;
+		if (M_PoolAddArena(pool, size, alignment)) {
+			void *ptr = M_PushSizeAligned(pool->first, size, alignment, flags);
+			if (ptr) return ptr;
+		}
 	}
-	return ErrorOutOfMemory();
+	return pool->budget ? nullptr : ErrorOutOfMemory();
 }
 
 void M_PoolFree(M_Pool *pool) {
@@ -35,3 +67,46 @@ void M_PoolFree(M_Pool *pool) {
 		arena = temp;
 	}
 }
+
+void M_PoolAdopt(M_Pool *pool, M_Pool *other) {
+	if (!other->first->reserved)
+		return;
+
+	// Both chains end in the shared empty arena, which must stay last
+	M_Arena *last = other->first;
+	while (last->next && last->next->reserved)
+		last = last->next;
+
+	if (pool->first->reserved) {
+		last->next        = pool->first->next;
+		pool->first->next = other->first;
+	} else {
+		pool->first = other->first;
+	}
+
+	pool->reserved  += other->reserved;
+	other->first     = M_ArenaAllocate(0, 0);
+	other->reserved  = 0;
+}
+
+M_Temp M_PoolBeginTemporaryMemory(M_Pool *pool) {
+	// Starting on a real arena keeps it for the next round. Without room for one, the shared
+	// empty arena works as well, ending then frees everything the pool got since.
+	if (!pool->first->reserved)
+		M_PoolAddArena(pool, 0, 1);
+	return M_BeginTemporaryMemory(pool->first);
+}
+
+void M_PoolEndTemporaryMemory(M_Pool *pool, M_Temp *temp) {
+	while (pool->first != temp->arena) {
+		M_Arena *next = pool->first->next;
+		pool->reserved -= pool->first->reserved;
+		M_ArenaFree(pool->first);
+		pool->first = next;
+	}
+
+	// Freeing the arenas added since was all there is to do for the empty one, which is
+	// shared and must not be written to
+	if (temp->arena->reserved)
+		M_EndTemporaryMemory(temp);
+}
@@ -4,8 +4,28 @@
 typedef struct M_Pool {
 	M_Arena *first;
 	umem     cap;
+	umem     budget;   // 0 for none
+	umem     reserved; // by all arenas of the pool, committed memory is part of it
 } M_Pool;
 
 void  M_PoolInit(M_Pool *pool, umem cap);
+
+// A pool whose arenas together never reserve more than `budget` bytes. Arenas are cut down
+// to what is left of it, and a push that does not fit returns null instead of ending the
+// process, so only code that checks for null may allocate from such a pool: the parser and
+// lexer, IngestFiles, ExprCompact, SnapshotOpen and IrLower. FrameResolve, Simplify and GraphBuild
+// still expect every push to succeed.
+void  M_PoolInitBudget(M_Pool *pool, umem cap, umem budget);
+
+// Null only for pools with a budget, without one running out of memory ends the process
 void *M_PoolPush(M_Pool *pool, umem size, u32 alignment, u32 flags);
 void  M_PoolFree(M_Pool *pool);
+
+// Moves the arenas of `other` into `pool`, which then frees them with its own and counts them
+// against its budget. Allocation carries on in the arena `pool` was using, `other` is left empty.
+void  M_PoolAdopt(M_Pool *pool, M_Pool *other);
+
+// Everything pushed between the two is given back, arenas the pool had to add are freed.
+// Beginning works on a pool that is out of budget as well.
+M_Temp M_PoolBeginTemporaryMemory(M_Pool *pool);
+void   M_PoolEndTemporaryMemory(M_Pool *pool, M_Temp *temp);
@@ -0,0 +1,372 @@
+#include "Simplify.h"
+#include "Array.h"
+
+// An operator whose operands are being rewritten, a binary one goes on to its right side once
+// the left one is done
+typedef struct Simplify_Frame {
+	Expr *expr;
+	bool  has_left;
+} Simplify_Frame;
+
+#define SIMPLIFY_STACK_LOCAL 64
+#define SIMPLIFY_STACK_MAX   (MegaBytes(256) / sizeof(Simplify_Frame))
+
+typedef struct Simplifier {
+	M_Pool *pool;
+	u32     flags;
+
+	M_Stack(Simplify_Frame, SIMPLIFY_STACK_LOCAL) stack;
+} Simplifier;
+
+static Expr *SimplifyAllocate(M_Pool *pool, umem size, Expr_Kind kind, Expr_Type *type, Token_Range range) {
+	Expr *expr  = M_PoolPush(pool, size, _Alignof(Expr), M_CLEAR_MEMORY);
+	expr->kind  = kind;
+	expr->type  = type;
+	expr->range = range;
+	return expr;
+}
+
+static Expr *SimplifyLiteral(M_Pool *pool, Token_Range range, u64 value) {
+	Expr_Literal *expr  = (Expr_Literal *)SimplifyAllocate(pool, sizeof(Expr_Literal), Expr_Kind_Literal, &ExprBuiltinUnsigned64.base, range);
+	expr->value.integer = value;
+	return &expr->base;
+}
+
+static Expr *SimplifyBinary(M_Pool *pool, Expr_Type *type, Token_Range range, u32 symbol, Expr *left, Expr *right) {
+	Expr_Binary_Operator *expr = (Expr_Binary_Operator *)SimplifyAllocate(pool, sizeof(Expr_Binary_Operator), Expr_Kind_Binary_Operator, type, range);
+	expr->left   = left;
+	expr->right  = right;
+	expr->symbol = symbol;
+	return &expr->base;
+}
+
+static bool SimplifyIsInteger(Expr *expr) {
+	return expr->type && expr->type->id == Expr_Type_Id_INTEGER;
+}
+
+static bool SimplifyConstant(Expr *expr, u64 *value) {
+	if (expr->kind != Expr_Kind_Literal || !SimplifyIsInteger(expr))
+		return false;
+	*value = ((Expr_Literal *)expr)->value.integer;
+	return true;
+}
+
+// Safe to evaluate more than once
+static bool SimplifyIsLeaf(Expr *expr) {
+	return expr->kind == Expr_Kind_Literal || expr->kind == Expr_Kind_Identifier;
+}
+
+static u32 SimplifyLog2(u64 value) {
+	u32 result = 0;
+	while (value >>= 1)
+		result += 1;
+	return result;
+}
+
+// (hi * 2^64 + lo) / d for hi < d, which keeps the quotient within 64 bits
+static u64 SimplifyDivide128(u64 hi, u64 lo, u64 d, u64 *remainder) {
+	u64 q = 0;
+	u64 r = hi;
+
+	for (int bit = 63; bit >= 0; --bit) {
+		bool carry = r >> 63;
+		r  = (r << 1) | ((lo >> bit) & 1);
+		q <<= 1;
+		if (carry || r >= d) {
+			r -= d;
+			q |= 1;
+		}
+	}
+
+	*remainder = r;
+	return q;
+}
+
+//
+// Division by a constant, Granlund and Montgomery, "Division by Invariant Integers using
+// Multiplication", and Warren, "Hacker's Delight", chapter 10.
+//
+
+static Expr *SimplifyDivideUnsigned(Simplifier *simplifier, Expr_Binary_Operator *expr, u64 d) {
+	M_Pool *    pool  = simplifier->pool;
+	Expr *      n     = expr->left;
+	Expr_Type * type  = expr->base.type;
+	Token_Range range = expr->base.range;
+
+	if (IsPower2(d)) {
+		expr->symbol = EXPR_SYMBOL_SHIFT_RIGHT;
+		expr->right  = SimplifyLiteral(pool, range, SimplifyLog2(d));
+		return &expr->base;
+	}
+
+	if (!(simplifier->flags & SIMPLIFY_EXPAND_DIVISION))
+		return &expr->base;
+
+	u32 l = SimplifyLog2(d) + 1; // ceil(log2(d)), d is not a power of two
+
+	// m = ceil(2^p / d) is exact for every 64 bit n when m * d - 2^p <= 2^(p - 64)
+	for (u32 p = 64; p < 64 + l; ++p) {
+		u64 r;
+		u64 m = SimplifyDivide128((u64)1 << (p - 64), 0, d, &r) + 1;
+		if (m == 0 || d - r > ((u64)1 << (p - 64)))
+			continue;
+
+		Expr *q = SimplifyBinary(pool, type, range, EXPR_SYMBOL_MULTIPLY_HIGH, n, SimplifyLiteral(pool, range, m));
+		if (p > 64)
+			q = SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, q, SimplifyLiteral(pool, range, p - 64));
+		return q;
+	}
+
+	// Otherwise the magic number needs 65 bits, its top bit is added back in separately:
+	// t = mulhi(n, m), q = (t + ((n - t) >> 1)) >> (l - 1)
+	if (!SimplifyIsLeaf(n))
+		return &expr->base;
+
+	u64 r;
+	u64 excess = (l < 64 ? (u64)1 << l : 0) - d; // 2^l - d, wraps around for l = 64
+	u64 m      = SimplifyDivide128(excess, 0, d, &r) + 1;
+
+	Expr *t0   = SimplifyBinary(pool, type, range, EXPR_SYMBOL_MULTIPLY_HIGH, n, SimplifyLiteral(pool, range, m));
+	Expr *t1   = SimplifyBinary(pool, type, range, EXPR_SYMBOL_MULTIPLY_HIGH, n, SimplifyLiteral(pool, range, m));
+	Expr *half = SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, SimplifyBinary(pool, type, range, '-', n, t0), SimplifyLiteral(pool, range, 1));
+	Expr *sum  = SimplifyBinary(pool, type, range, '+', t1, half);
+	return SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, sum, SimplifyLiteral(pool, range, l - 1));
+}
+
+static Expr *SimplifyDivideSigned(Simplifier *simplifier, Expr_Binary_Operator *expr, u64 d) {
+	M_Pool *    pool    = simplifier->pool;
+	Expr *      n       = expr->left;
+	Expr_Type * type    = expr->base.type;
+	Expr_Type * logical = &ExprBuiltinUnsigned64.base; // for shifts that must not extend the sign
+	Token_Range range   = expr->base.range;
+
+	// Negative divisors, and the overflowing -2^63 / -1 the evaluator handles, stay divisions.
+	// Everything below reads n more than once.
+	if ((i64)d < 2 || !SimplifyIsLeaf(n) || !(simplifier->flags & SIMPLIFY_EXPAND_DIVISION))
+		return &expr->base;
+
+	if (IsPower2(d)) {
+		// Shifting rounds down, a bias of d - 1 on negative n makes it round toward zero
+		u32   k    = SimplifyLog2(d);
+		Expr *sign = SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, n, SimplifyLiteral(pool, range, 63));
+		Expr *bias = SimplifyBinary(pool, logical, range, EXPR_SYMBOL_SHIFT_RIGHT, sign, SimplifyLiteral(pool, range, 64 - k));
+		Expr *sum  = SimplifyBinary(pool, type, range, '+', n, bias);
+		return SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, sum, SimplifyLiteral(pool, range, k));
+	}
+
+	const u64 two63 = (u64)1 << 63;
+
+	u64 anc = two63 - 1 - two63 % d; // |nc|, the largest n with n % d == d - 1
+	u32 p   = 63;
+	u64 q1  = two63 / anc;
+	u64 r1  = two63 - q1 * anc;
+	u64 q2  = two63 / d;
+	u64 r2  = two63 - q2 * d;
+	u64 delta;
+
+	do {
+		p += 1;
+		q1 *= 2;
+		r1 *= 2;
+		if (r1 >= anc) {
+			q1 += 1;
+			r1 -= anc;
+		}
+		q2 *= 2;
+		r2 *= 2;
+		if (r2 >= d) {
+			q2 += 1;
+			r2 -= d;
+		}
+		delta = d - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+
+	u64 m = q2 + 1;
+	u32 s = p - 64;
+
+	// q = mulhi(n, m) (+ n when m came out negative) >> s, plus one for negative n
+	Expr *q = SimplifyBinary(pool, type, range, EXPR_SYMBOL_MULTIPLY_HIGH, n, SimplifyLiteral(pool, range, m));
+	if ((i64)m < 0)
+		q = SimplifyBinary(pool, type, range, '+', q, n);
+	if (s)
+		q = SimplifyBinary(pool, type, range, EXPR_SYMBOL_SHIFT_RIGHT, q, SimplifyLiteral(pool, range, s));
+
+	Expr *sign = SimplifyBinary(pool, logical, range, EXPR_SYMBOL_SHIFT_RIGHT, n, SimplifyLiteral(pool, range, 63));
+	return SimplifyBinary(pool, type, range, '+', q, sign);
+}
+
+//
+//
+//
+
+// The operands are rewritten already
+static Expr *SimplifyBinaryOperator(Simplifier *simplifier, Expr_Binary_Operator *expr) {
+	// Untyped operands may turn out to be floats, where none of this holds
+	if (!SimplifyIsInteger(&expr->base))
+		return &expr->base;
+
+	u64  left = 0, right = 0;
+	bool left_constant  = SimplifyConstant(expr->left, &left);
+	bool right_constant = SimplifyConstant(expr->right, &right);
+
+	switch (expr->symbol) {
+	case '+':
+	{
+		if (right_constant && right == 0)
+			return expr->left;
+		if (left_constant && left == 0)
+			return expr->right;
+	} break;
+
+	case '-':
+	{
+		if (right_constant && right == 0)
+			return expr->left;
+	} break;
+
+	case '*':
+	{
+		if (left_constant && !right_constant) {
+			Expr *swap     = expr->left;
+			expr->left     = expr->right;
+			expr->right    = swap;
+			right          = left;
+			right_constant = true;
+		}
+
+		if (!right_constant)
+			break;
+
+		if (right == 1)
+			return expr->left;
+
+		if (IsPower2(right)) {
+			expr->symbol = EXPR_SYMBOL_SHIFT_LEFT;
+			expr->right  = SimplifyLiteral(simplifier->pool, expr->right->range, SimplifyLog2(right));
+		}
+	} break;
+
+	case '/':
+	{
+		// Division by zero is left for the evaluator to report
+		if (!right_constant || right == 0)
+			break;
+
+		if (right == 1)
+			return expr->left;
+
+		if (ExprIsSigned(&expr->base))
+			return SimplifyDivideSigned(simplifier, expr, right);
+		return SimplifyDivideUnsigned(simplifier, expr, right);
+	}
+	}
+
+	return &expr->base;
+}
+
+static Expr *SimplifyUnaryOperator(Expr_Unary_Operator *unary) {
+	if (unary->symbol == '+')
+		return unary->child;
+
+	// Negation only flips the sign, twice gives back the same bits for floats as well
+	Expr_Unary_Operator *child = (Expr_Unary_Operator *)unary->child;
+	if (unary->symbol == '-' && child->base.kind == Expr_Kind_Unary_Operator && child->symbol == '-')
+		return child->child;
+
+	return &unary->base;
+}
+
+// Rewrites bottom up, a subtree too deep for the stack is left as it is
+static Expr *SimplifyExpr(Simplifier *simplifier, Expr *root) {
+	Expr *result = root;
+	Expr *expr   = root;
+
+	// While `expr` is set it is descended into, then `result` replaces it in the operator above
+	for (;;) {
+		if (expr) {
+			Simplify_Frame *frame = nullptr;
+			if (expr->kind != Expr_Kind_Literal && expr->kind != Expr_Kind_Identifier)
+				frame = M_StackPush(&simplifier->stack);
+
+			if (!frame) {
+				result = expr;
+				expr   = nullptr;
+				continue;
+			}
+
+			frame->expr     = expr;
+			frame->has_left = false;
+
+			switch (expr->kind) {
+			case Expr_Kind_Unary_Operator:  expr = ((Expr_Unary_Operator *)expr)->child; break;
+			case Expr_Kind_Binary_Operator: expr = ((Expr_Binary_Operator *)expr)->left; break;
+			case Expr_Kind_Assignment:      expr = ((Expr_Assignment *)expr)->right; break;
+			NoDefaultCase();
+			}
+			continue;
+		}
+
+		if (!simplifier->stack.count)
+			break;
+
+		Simplify_Frame *frame = M_StackTop(&simplifier->stack);
+		Expr *          node  = frame->expr;
+
+		switch (node->kind) {
+		case Expr_Kind_Unary_Operator:
+		{
+			Expr_Unary_Operator *unary = (Expr_Unary_Operator *)node;
+			unary->child = result;
+			result       = SimplifyUnaryOperator(unary);
+			break;
+		}
+
+		case Expr_Kind_Binary_Operator:
+		{
+			Expr_Binary_Operator *binary = (Expr_Binary_Operator *)node;
+			if (!frame->has_left) {
+				binary->left    = result;
+				frame->has_left = true;
+				expr            = binary->right;
+				continue;
+			}
+			binary->right = result;
+			result        = SimplifyBinaryOperator(simplifier, binary);
+			break;
+		}
+
+		case Expr_Kind_Assignment:
+		{
+			((Expr_Assignment *)node)->right = result;
+			result = node;
+			break;
+		}
+
+		NoDefaultCase();
+		}
+
+		simplifier->stack.count -= 1;
+	}
+
+	return result;
+}
+
+Expr *Simplify(Expr *expr, u32 flags, M_Pool *pool) {
+	Simplifier simplifier = { pool, flags };
+	M_StackInit(&simplifier.stack, SIMPLIFY_STACK_MAX);
+
+	expr = SimplifyExpr(&simplifier, expr);
+
+	M_StackFree(&simplifier.stack);
+	return expr;
+}
+
+void SimplifyStatements(Expr_Array statements, u32 flags, M_Pool *pool) {
+	Simplifier simplifier = { pool, flags };
+	M_StackInit(&simplifier.stack, SIMPLIFY_STACK_MAX);
+
+	for (imem index = 0; index < statements.count; ++index)
+		statements.data[index] = SimplifyExpr(&simplifier, statements.data[index]);
+
+	M_StackFree(&simplifier.stack);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Parser.h"
+
+// Rewrites integer arithmetic into cheaper forms that evaluate to the same 64 bit values:
+//
+//   x + 0, 0 + x, x - 0, x * 1, x / 1  ->  x
+//   - -x, +x                           ->  x
+//   x * 2^k                            ->  x << k
+//   x / 2^k                            ->  x >> k for unsigned types
+//
+// With SIMPLIFY_EXPAND_DIVISION, divisions also turn into sequences of cheaper operators:
+//
+//   x / 2^k                            ->  (x + rounding bias) >> k for signed types
+//   x / d                              ->  multiply-high by a magic number, then shift
+//
+// The sequences pay off where each operator is a machine instruction. The tree evaluator
+// spends more on the extra nodes than on the division they replace, so leave it off there.
+//
+// Only operators typed as integers are rewritten, so this runs after FrameResolve. Rewrites
+// that read an operand more than once are only done when it is a name or a literal, anything
+// else would be evaluated twice. Nodes are rewritten in place or allocated from `pool`, a
+// subtree too deep for the walk's stack is left as it is.
+enum Simplify_Flags {
+	SIMPLIFY_EXPAND_DIVISION = 0x1,
+};
+
+Expr *Simplify(Expr *expr, u32 flags, M_Pool *pool);
+void  SimplifyStatements(Expr_Array statements, u32 flags, M_Pool *pool);
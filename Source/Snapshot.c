@@ -0,0 +1,304 @@
+#include "Snapshot.h"
+#include "Hash.h"
+
+#include <string.h>
+
+u64 SnapshotKey(const String *sources, u32 count) {
+	// Chained through the seed, so moving text from one source to the next changes the key too
+	u64 key = HashBytes(&count, sizeof(count), 0);
+	for (u32 index = 0; index < count; ++index) {
+		u64 size = (u64)sources[index].count;
+		key = HashBytes(&size, sizeof(size), key);
+		key = HashBytes(sources[index].data, sources[index].count, key);
+	}
+	return key;
+}
+
+static u64 SnapshotTableSize(u32 slot_count) {
+	u64 size = 16;
+	while (size < (u64)slot_count * 2)
+		size *= 2;
+	return size;
+}
+
+bool SnapshotStore(const char *path, u64 key, Frame_Layout *layout, const u8 *frame, const u64 *versions, u32 statement_count) {
+	u64  table_size = SnapshotTableSize(layout->slot_count);
+	umem names      = 0;
+	for (u32 index = 0; index < layout->slot_count; ++index)
+		names += layout->slots[index].name.count;
+
+	// Sizes in a u64 first, every section has to stay addressable by a 32 bit offset
+	u64 sizes[Snapshot_Section_COUNT];
+	sizes[Snapshot_Section_SLOT]    = (u64)layout->slot_count * sizeof(Snapshot_Slot);
+	sizes[Snapshot_Section_TABLE]   = table_size * sizeof(u32);
+	sizes[Snapshot_Section_VERSION] = (u64)statement_count * sizeof(u64);
+	sizes[Snapshot_Section_FRAME]   = layout->size;
+	sizes[Snapshot_Section_NAME]    = names;
+
+	static const u32 Alignments[] = { _Alignof(Snapshot_Slot), _Alignof(u32), _Alignof(u64), sizeof(u64), 1 };
+	static_assert(ArrayCount(Alignments) == Snapshot_Section_COUNT, "");
+
+	Cache_Section sections[Snapshot_Section_COUNT];
+	u64           pos = sizeof(Snapshot_Header);
+
+	for (u32 kind = 0; kind < Snapshot_Section_COUNT; ++kind) {
+		pos = AlignPower2Up(pos, (u64)Alignments[kind]);
+		sections[kind] = (Cache_Section){ (Cache_Offset)pos, (u32)sizes[kind] };
+		pos += sizes[kind];
+		if (pos > UINT32_MAX)
+			return false;
+	}
+
+	umem     size  = (umem)pos;
+	M_Arena *arena = M_ArenaAllocate(sizeof(M_Arena) + size + sizeof(u64), sizeof(M_Arena) + size + sizeof(u64));
+	u8 *     base  = arena->reserved ? M_PushSizeAligned(arena, size, sizeof(u64), M_CLEAR_MEMORY) : nullptr;
+
+	if (!base) {
+		M_ArenaFree(arena);
+		return false;
+	}
+
+	Snapshot_Header *header = (Snapshot_Header *)base;
+	header->magic           = SNAPSHOT_MAGIC;
+	header->version         = SNAPSHOT_VERSION;
+	header->source_hash     = key;
+	header->image_size      = size;
+	header->slot_count      = layout->slot_count;
+	header->statement_count = statement_count;
+	header->frame_size      = layout->size;
+	header->frame_alignment = layout->alignment;
+	header->table_mask      = (u32)(table_size - 1);
+	memcpy(header->sections, sections, sizeof(sections));
+
+	Snapshot_Slot *slots = (Snapshot_Slot *)(base + sections[Snapshot_Section_SLOT].offset);
+	u32 *          table = (u32 *)(base + sections[Snapshot_Section_TABLE].offset);
+	Cache_Offset   name  = sections[Snapshot_Section_NAME].offset;
+
+	for (u32 index = 0; index < layout->slot_count; ++index) {
+		Frame_Slot *   src = &layout->slots[index];
+		Snapshot_Slot *dst = &slots[index];
+
+		dst->hash       = HashString(src->name);
+		dst->name       = name;
+		dst->count      = (u32)src->name.count;
+		dst->offset     = src->offset;
+		dst->type_id    = (u8)src->type->id;
+		dst->type_size  = (u8)src->type->runtime_size;
+		dst->assigned   = src->assigned;
+		if (src->type->id == Expr_Type_Id_INTEGER)
+			dst->type_flags = (u8)((Expr_Type_Integer *)src->type)->flags;
+
+		memcpy(base + name, src->name.data, src->name.count);
+		name += dst->count;
+
+		u32 slot = (u32)dst->hash & header->table_mask;
+		while (table[slot])
+			slot = (slot + 1) & header->table_mask;
+		table[slot] = index + 1;
+	}
+
+	if (statement_count)
+		memcpy(base + sections[Snapshot_Section_VERSION].offset, versions, sections[Snapshot_Section_VERSION].size);
+	if (layout->size)
+		memcpy(base + sections[Snapshot_Section_FRAME].offset, frame, layout->size);
+
+	bool result = CacheWriteFile(path, base, size);
+
+	M_ArenaFree(arena);
+
+	return result;
+}
+
+static bool SnapshotSectionValid(const Snapshot *snapshot, Cache_Section section, umem alignment) {
+	return section.offset >= sizeof(Snapshot_Header) &&
+		(section.offset & (alignment - 1)) == 0 &&
+		(umem)section.offset + section.size <= snapshot->size;
+}
+
+static bool SnapshotValidate(const Snapshot *snapshot, u64 key) {
+	if (snapshot->size < sizeof(Snapshot_Header))
+		return false;
+
+	const Snapshot_Header *header   = (const Snapshot_Header *)snapshot->base;
+	const Cache_Section *  sections = header->sections;
+
+	if (header->magic != SNAPSHOT_MAGIC ||
+		header->version != SNAPSHOT_VERSION ||
+		header->source_hash != key ||
+		header->image_size != snapshot->size)
+		return false;
+
+	if (!IsPower2(header->frame_alignment) || header->frame_alignment > sizeof(u64) ||
+		(u64)header->table_mask + 1 != SnapshotTableSize(header->slot_count))
+		return false;
+
+	return SnapshotSectionValid(snapshot, sections[Snapshot_Section_SLOT], _Alignof(Snapshot_Slot)) &&
+		SnapshotSectionValid(snapshot, sections[Snapshot_Section_TABLE], _Alignof(u32)) &&
+		SnapshotSectionValid(snapshot, sections[Snapshot_Section_VERSION], _Alignof(u64)) &&
+		SnapshotSectionValid(snapshot, sections[Snapshot_Section_FRAME], header->frame_alignment) &&
+		SnapshotSectionValid(snapshot, sections[Snapshot_Section_NAME], 1) &&
+		sections[Snapshot_Section_SLOT].size == (u64)header->slot_count * sizeof(Snapshot_Slot) &&
+		sections[Snapshot_Section_TABLE].size == ((u64)header->table_mask + 1) * sizeof(u32) &&
+		sections[Snapshot_Section_VERSION].size == (u64)header->statement_count * sizeof(u64) &&
+		sections[Snapshot_Section_FRAME].size == header->frame_size;
+}
+
+// Slots point into the frame and the names section, a damaged file must not send them elsewhere
+static bool SnapshotLoadLayout(Snapshot *snapshot, M_Pool *pool) {
+	const Snapshot_Header *header = (const Snapshot_Header *)snapshot->base;
+	const Snapshot_Slot *  slots  = (const Snapshot_Slot *)(snapshot->base + header->sections[Snapshot_Section_SLOT].offset);
+	Cache_Section          names  = header->sections[Snapshot_Section_NAME];
+
+	Frame_Layout *layout = &snapshot->layout;
+	layout->slot_count   = header->slot_count;
+	layout->size         = header->frame_size;
+	layout->alignment    = header->frame_alignment;
+	layout->slots        = M_PoolPush(pool, sizeof(Frame_Slot) * (header->slot_count + 1), _Alignof(Frame_Slot), 0);
+
+	if (!layout->slots)
+		return false;
+
+	for (u32 index = 0; index < header->slot_count; ++index) {
+		const Snapshot_Slot *src = &slots[index];
+		Frame_Slot *         dst = &layout->slots[index];
+
+		dst->type = ExprBuiltinType(src->type_id, src->type_size, src->type_flags);
+		if (!dst->type || (umem)src->offset + src->type_size > header->frame_size || (src->offset & (src->type_size - 1)))
+			return false;
+		if (src->name < names.offset || (umem)src->name + src->count > (umem)names.offset + names.size)
+			return false;
+
+		dst->name     = (String){ .count = src->count, .data = snapshot->base + src->name };
+		dst->offset   = src->offset;
+		dst->assigned = src->assigned != 0;
+	}
+
+	snapshot->frame           = snapshot->base + header->sections[Snapshot_Section_FRAME].offset;
+	snapshot->versions        = (u64 *)(snapshot->base + header->sections[Snapshot_Section_VERSION].offset);
+	snapshot->statement_count = header->statement_count;
+
+	return true;
+}
+
+u32 SnapshotFind(const Snapshot *snapshot, String name) {
+	const Snapshot_Header *header = (const Snapshot_Header *)snapshot->base;
+	const Snapshot_Slot *  slots  = (const Snapshot_Slot *)(snapshot->base + header->sections[Snapshot_Section_SLOT].offset);
+	const u32 *            table  = (const u32 *)(snapshot->base + header->sections[Snapshot_Section_TABLE].offset);
+
+	u64 hash = HashString(name);
+
+	// The table is at least twice the slot count, probing reaches an empty entry well before
+	// going around, the bound only matters for a damaged file
+	u32 pos = (u32)hash & header->table_mask;
+	for (u32 probe = 0; probe <= header->table_mask; ++probe, pos = (pos + 1) & header->table_mask) {
+		u32 index = table[pos];
+		if (!index || index > header->slot_count)
+			break;
+
+		const Snapshot_Slot *slot = &slots[index - 1];
+		if (slot->hash == hash && slot->count == name.count &&
+			memcmp(snapshot->layout.slots[index - 1].name.data, name.data, name.count) == 0)
+			return index - 1;
+	}
+
+	return EXPR_SLOT_NONE;
+}
+
+//
+//
+//
+
+#if PLATFORM_WINDOWS == 1
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#pragma warning(pop)
+
+bool SnapshotOpen(Snapshot *snapshot, const char *path, u64 key, M_Pool *pool) {
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (umem)size.QuadPart < sizeof(Snapshot_Header)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	// Copy on write, pages the process stores to become its own
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	CloseHandle(file);
+
+	if (!mapping)
+		return false;
+
+	snapshot->base   = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	snapshot->size   = (umem)size.QuadPart;
+	snapshot->handle = mapping;
+
+	if (!snapshot->base || !SnapshotValidate(snapshot, key) || !SnapshotLoadLayout(snapshot, pool)) {
+		SnapshotClose(snapshot);
+		return false;
+	}
+
+	return true;
+}
+
+void SnapshotClose(Snapshot *snapshot) {
+	if (snapshot->base)
+		UnmapViewOfFile(snapshot->base);
+	if (snapshot->handle)
+		CloseHandle(snapshot->handle);
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+#endif
+
+#if PLATFORM_LINUX == 1 || PLATFORM_MAC == 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool SnapshotOpen(Snapshot *snapshot, const char *path, u64 key, M_Pool *pool) {
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Snapshot_Header)) {
+		close(fd);
+		return false;
+	}
+
+	// Copy on write, pages the process stores to become its own
+	void *base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+		return false;
+
+	snapshot->base = base;
+	snapshot->size = st.st_size;
+
+	if (!SnapshotValidate(snapshot, key) || !SnapshotLoadLayout(snapshot, pool)) {
+		SnapshotClose(snapshot);
+		return false;
+	}
+
+	return true;
+}
+
+void SnapshotClose(Snapshot *snapshot) {
+	if (snapshot->base)
+		munmap(snapshot->base, snapshot->size);
+	memset(snapshot, 0, sizeof(*snapshot));
+}
+
+#endif
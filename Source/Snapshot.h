@@ -0,0 +1,76 @@
+#pragma once
+#include "Cache.h"
+#include "Eval.h"
+
+//
+// Evaluated environment in one file: the frame layout with its interned names, the frame
+// holding every slot's value, a version per statement and a name table to find slots by.
+// As in the parse cache all links are offsets into the image, so a restarted process maps
+// the snapshot and serves from it in place instead of parsing and evaluating everything.
+//
+// The mapping is private and writable. Stores into the frame and new versions stay in the
+// process until the next SnapshotStore, the file underneath never changes while mapped.
+// A snapshot only opens for the same key it was stored under, see SnapshotKey.
+//
+
+#define SNAPSHOT_MAGIC   0x4e53435a // "ZCSN"
+#define SNAPSHOT_VERSION 1
+
+typedef enum Snapshot_Section_Kind {
+	Snapshot_Section_SLOT,
+	Snapshot_Section_TABLE,
+	Snapshot_Section_VERSION,
+	Snapshot_Section_FRAME,
+	Snapshot_Section_NAME,
+
+	Snapshot_Section_COUNT
+} Snapshot_Section_Kind;
+
+typedef struct Snapshot_Header {
+	u32           magic;
+	u32           version;
+	u64           source_hash;
+	u64           image_size;
+	u32           slot_count;
+	u32           statement_count;
+	u32           frame_size;
+	u32           frame_alignment;
+	u32           table_mask;
+	u32           reserved;
+	Cache_Section sections[Snapshot_Section_COUNT];
+} Snapshot_Header;
+
+typedef struct Snapshot_Slot {
+	u64          hash; // of the name
+	Cache_Offset name;
+	u32          count;
+	u32          offset; // in the frame
+	u8           type_id;
+	u8           type_size;
+	u8           type_flags;
+	u8           assigned;
+} Snapshot_Slot;
+
+typedef struct Snapshot {
+	u8 *          base;
+	umem          size;
+	void *        handle;
+
+	Frame_Layout  layout;   // slot names point into the image
+	u8 *          frame;    // in the image
+	u64 *         versions; // in the image, one per statement
+	u32           statement_count;
+} Snapshot;
+
+// Hash of the whole source set, in order. Any change to any source gives another key.
+u64   SnapshotKey(const String *sources, u32 count);
+
+bool  SnapshotStore(const char *path, u64 key, Frame_Layout *layout, const u8 *frame, const u64 *versions, u32 statement_count);
+
+// Maps the snapshot and rebuilds the layout's slot array from `pool`, false when the file is
+// missing, damaged or was stored for other sources
+bool  SnapshotOpen(Snapshot *snapshot, const char *path, u64 key, M_Pool *pool);
+void  SnapshotClose(Snapshot *snapshot);
+
+// Slot of `name`, EXPR_SLOT_NONE when the environment does not have it
+u32   SnapshotFind(const Snapshot *snapshot, String name);
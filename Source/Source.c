@@ -0,0 +1,177 @@
+#include "Source.h"
+
+#include <string.h>
+
+#define SOURCE_MAX_FILES MegaBytes(1)
+
+void SourceInit(Source_Map *map) {
+	memset(map, 0, sizeof(*map));
+	map->arena = M_ArenaAllocate(sizeof(M_Arena) + sizeof(Source_File) * SOURCE_MAX_FILES, 0);
+	map->names = M_ArenaAllocate(MegaBytes(256), 0);
+	map->files = M_PushSizeAligned(map->arena, 0, _Alignof(Source_File), 0);
+	MutexInit(&map->lock);
+}
+
+void SourceFree(Source_Map *map) {
+	M_ArenaFree(map->arena);
+	M_ArenaFree(map->names);
+	MutexFree(&map->lock);
+	memset(map, 0, sizeof(*map));
+}
+
+static Source_File *SourcePush(Source_Map *map, String name, String content, umem span) {
+	Source_File *file = nullptr;
+
+	MutexLock(&map->lock);
+
+	if (map->files && map->next + span < ((u64)1 << 32)) {
+		file = M_PushSize(map->arena, sizeof(Source_File), 0);
+		u8 *copy = M_PushSize(map->names, name.count, 0);
+
+		if (file && (copy || !name.count)) {
+			if (name.count)
+				memcpy(copy, name.data, name.count);
+
+			file->name    = (String){ name.count, copy };
+			file->content = content;
+			file->base    = (Source_Loc)map->next;
+			file->span    = (u32)span;
+
+			map->next  += span;
+			map->count += 1;
+		} else {
+			file = nullptr;
+		}
+	}
+
+	MutexUnlock(&map->lock);
+	return file;
+}
+
+Source_File *SourceAdd(Source_Map *map, String name, String content) {
+	return SourcePush(map, name, content, (umem)content.count + 1);
+}
+
+Source_File *SourceAddStream(Source_Map *map, String name) {
+	return SourcePush(map, name, (String){ 0 }, SOURCE_STREAM_SPAN);
+}
+
+bool SourceGrow(Source_Map *map, Source_File *file, umem size) {
+	bool grown = false;
+
+	MutexLock(&map->lock);
+
+	if (map->count && file == &map->files[map->count - 1]) {
+		// Locations stay below 2^32, as in SourcePush
+		u64 room = ((u64)1 << 32) - 1 - file->base;
+		u64 span = Max((u64)file->span, 1);
+		while (span < (u64)size + 1)
+			span *= 2;
+		span = Min(span, room);
+
+		if (span >= (u64)size + 1) {
+			file->span = (u32)span;
+			map->next  = (u64)file->base + span;
+			grown      = true;
+		}
+	}
+
+	MutexUnlock(&map->lock);
+	return grown;
+}
+
+void SourceTrim(Source_Map *map, Source_File *file, umem size) {
+	MutexLock(&map->lock);
+
+	if (size + 1 < file->span && file == &map->files[map->count - 1]) {
+		file->span = (u32)(size + 1);
+		map->next  = (u64)file->base + file->span;
+	}
+
+	MutexUnlock(&map->lock);
+}
+
+void SourceDrop(Source_Map *map, Source_File *file) {
+	MutexLock(&map->lock);
+
+	if (map->count && file == &map->files[map->count - 1]) {
+		if (file->name.count)
+			M_PopSize(map->names, file->name.count);
+		M_PopSize(map->arena, sizeof(Source_File));
+
+		map->next   = file->base;
+		map->count -= 1;
+	}
+
+	MutexUnlock(&map->lock);
+}
+
+Source_File *SourceFind(Source_Map *map, Source_Loc loc) {
+	MutexLock(&map->lock);
+
+	// Last file whose base is at or before the location
+	Source_File *files = map->files;
+	u32          first = 0;
+	u32          count = map->count;
+
+	while (count) {
+		u32 half = count / 2;
+		if (files[first + half].base <= loc) {
+			first += half + 1;
+			count -= half + 1;
+		} else {
+			count = half;
+		}
+	}
+
+	Source_File *file = nullptr;
+	if (first && loc - files[first - 1].base < files[first - 1].span)
+		file = &files[first - 1];
+
+	MutexUnlock(&map->lock);
+	return file;
+}
+
+bool SourceLocation(Source_Map *map, Source_Loc loc, Source_File **result, umem *row, umem *column) {
+	Source_File *file = SourceFind(map, loc);
+
+	*result = file;
+	*row    = 1;
+	*column = 0;
+
+	if (!file)
+		return false;
+
+	umem pos = Min(loc - file->base, (umem)file->content.count);
+	u8 * data = file->content.data;
+
+	for (umem index = 0; index < pos; ++index) {
+		if (data[index] != '\n') {
+			*column += 1;
+		} else {
+			*column = 0;
+			*row += 1;
+		}
+	}
+
+	return file->content.count || !pos;
+}
+
+Source_Map *SourceGlobal(void) {
+	static Source_Map Map;
+	static u32        State; // 0 not set up, 1 being set up, 2 ready
+
+	if (AtomicLoad32(&State) == 2)
+		return &Map;
+
+	if (AtomicCompareExchange32(&State, 0, 1) == 0) {
+		SourceInit(&Map);
+		AtomicCompareExchange32(&State, 1, 2);
+	}
+
+	while (AtomicLoad32(&State) != 2) {
+		// another thread is setting it up
+	}
+
+	return &Map;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Memory.h"
+#include "Thread.h"
+
+// A position in the global source space. Every file owns the locations
+// [base, base + span), its bytes followed by one location for the end of the file,
+// so a single 32 bit value names both the file and the offset within it.
+typedef u32 Source_Loc;
+
+// Streams do not know their size up front, they start with this much and grow from there
+#ifndef SOURCE_STREAM_SPAN
+#define SOURCE_STREAM_SPAN MegaBytes(256)
+#endif
+
+typedef struct Source_File {
+	String     name;
+	String     content; // empty for streams
+	Source_Loc base;
+	u32        span;
+} Source_File;
+
+typedef struct Source_Map {
+	M_Arena *    arena; // Source_File array, reserved up front so entries never move
+	M_Arena *    names;
+	Source_File *files;
+	u32          count;
+	u64          next;
+	Mutex        lock;
+} Source_Map;
+
+void         SourceInit(Source_Map *map);
+void         SourceFree(Source_Map *map);
+
+// Return null once the 32 bit location space is used up
+Source_File *SourceAdd(Source_Map *map, String name, String content);
+Source_File *SourceAddStream(Source_Map *map, String name);
+
+// Doubles a stream's span until it holds `size` bytes, if nothing was added after it and the
+// location space has room. False when the span stays as it is.
+bool         SourceGrow(Source_Map *map, Source_File *file, umem size);
+
+// Gives back the unused part of a stream's span if nothing was added after it
+void         SourceTrim(Source_Map *map, Source_File *file, umem size);
+
+// Gives back the locations of a file nothing refers to anymore if nothing was added after it,
+// a loop over many short inputs then keeps reusing the same range
+void         SourceDrop(Source_Map *map, Source_File *file);
+
+Source_File *SourceFind(Source_Map *map, Source_Loc loc);
+bool         SourceLocation(Source_Map *map, Source_Loc loc, Source_File **file, umem *row, umem *column);
+
+// Shared by everything that does not bring its own map
+Source_Map * SourceGlobal(void);
@@ -0,0 +1,183 @@
+#include "Task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool TaskTake(Task_Worker *worker, Task_Range *range) {
+	bool taken = false;
+
+	MutexLock(&worker->lock);
+	if (worker->queue.count > worker->head) {
+		*range = *M_ArrayPop(&worker->queue);
+		taken  = true;
+	}
+	MutexUnlock(&worker->lock);
+
+	return taken;
+}
+
+static bool TaskSteal(Task_Worker *worker, Task_Range *range) {
+	Task_Pool *pool = worker->pool;
+
+	for (u32 offset = 1; offset < pool->worker_count; ++offset) {
+		Task_Worker *victim = &pool->workers[(worker->index + offset) % pool->worker_count];
+		bool         stolen = false;
+
+		MutexLock(&victim->lock);
+		if (victim->queue.count > victim->head) {
+			*range = victim->queue.data[victim->head++];
+			stolen = true;
+		}
+		MutexUnlock(&victim->lock);
+
+		if (stolen)
+			return true;
+	}
+
+	return false;
+}
+
+// Nothing adds ranges while a batch runs, so once every queue is seen empty this worker is done
+static void TaskWork(Task_Worker *worker) {
+	Task_Pool *pool = worker->pool;
+	Task_Range range;
+
+	while (TaskTake(worker, &range) || TaskSteal(worker, &range))
+		pool->proc(pool->user, range.first, range.count);
+}
+
+static void TaskThread(void *argument) {
+	Task_Worker *worker = argument;
+	Task_Pool *  pool   = worker->pool;
+	u32          seen   = 0;
+
+	for (;;) {
+		MutexLock(&pool->lock);
+		while (pool->generation == seen)
+			ConditionWait(&pool->start, &pool->lock);
+		seen = pool->generation;
+		bool quit = pool->quit;
+		MutexUnlock(&pool->lock);
+
+		if (quit)
+			return;
+
+		TaskWork(worker);
+
+		MutexLock(&pool->lock);
+		if (--pool->busy == 0)
+			ConditionWakeAll(&pool->done);
+		MutexUnlock(&pool->lock);
+	}
+}
+
+bool TaskPoolInit(Task_Pool *pool, u32 worker_count) {
+	memset(pool, 0, sizeof(*pool));
+
+	if (!worker_count)
+		worker_count = ThreadCoreCount();
+
+	pool->workers = calloc(worker_count, sizeof(Task_Worker));
+	if (!pool->workers)
+		return false;
+
+	MutexInit(&pool->lock);
+	ConditionInit(&pool->start);
+	ConditionInit(&pool->done);
+
+	for (u32 index = 0; index < worker_count; ++index) {
+		Task_Worker *worker = &pool->workers[index];
+		worker->pool        = pool;
+		worker->index       = index;
+		MutexInit(&worker->lock);
+
+		if (!M_ArrayInit(&worker->queue, TASK_MAX_RANGES)) {
+			pool->worker_count = index + 1;
+			TaskPoolFree(pool);
+			return false;
+		}
+	}
+
+	pool->worker_count = 1;
+	for (u32 index = 1; index < worker_count; ++index) {
+		if (!ThreadStart(&pool->workers[index].thread, TaskThread, &pool->workers[index]))
+			break;
+		pool->worker_count += 1;
+	}
+
+	// Workers whose thread did not start are never dealt any work
+	for (u32 index = pool->worker_count; index < worker_count; ++index) {
+		M_ArrayFree(&pool->workers[index].queue);
+		MutexFree(&pool->workers[index].lock);
+	}
+
+	return true;
+}
+
+void TaskPoolFree(Task_Pool *pool) {
+	if (!pool->workers)
+		return;
+
+	MutexLock(&pool->lock);
+	pool->quit        = true;
+	pool->generation += 1;
+	ConditionWakeAll(&pool->start);
+	MutexUnlock(&pool->lock);
+
+	for (u32 index = 0; index < pool->worker_count; ++index) {
+		Task_Worker *worker = &pool->workers[index];
+		if (worker->thread.handle)
+			ThreadJoin(&worker->thread);
+		if (worker->queue.arena)
+			M_ArrayFree(&worker->queue);
+		MutexFree(&worker->lock);
+	}
+
+	ConditionFree(&pool->done);
+	ConditionFree(&pool->start);
+	MutexFree(&pool->lock);
+
+	free(pool->workers);
+	memset(pool, 0, sizeof(*pool));
+}
+
+void TaskRun(Task_Pool *pool, u32 count, u32 grain, Task_Proc proc, void *user) {
+	u32 workers = pool->worker_count;
+
+	grain = Max(grain, 1);
+	grain = Max(grain, count / (TASK_MAX_RANGES * workers) + 1);
+
+	pool->proc = proc;
+	pool->user = user;
+
+	// Each worker starts with a contiguous share, stealing only evens out what is left at the end
+	u32 ranges = (count + grain - 1) / grain;
+	for (u32 index = 0; index < workers; ++index) {
+		Task_Worker *worker = &pool->workers[index];
+		M_ArrayClear(&worker->queue);
+		worker->head = 0;
+
+		u32 first = (u32)((u64)ranges * index / workers);
+		u32 last  = (u32)((u64)ranges * (index + 1) / workers);
+
+		// Pushed in reverse, so the owner works through its share front to back
+		for (u32 range = last; range > first; --range) {
+			Task_Range *slot = M_ArrayPush(&worker->queue);
+			slot->first      = (range - 1) * grain;
+			slot->count      = Min(grain, count - slot->first);
+		}
+	}
+
+	MutexLock(&pool->lock);
+	pool->busy        = workers - 1;
+	pool->generation += 1;
+	ConditionWakeAll(&pool->start);
+	MutexUnlock(&pool->lock);
+
+	TaskWork(&pool->workers[0]);
+
+	MutexLock(&pool->lock);
+	while (pool->busy)
+		ConditionWait(&pool->done, &pool->lock);
+	MutexUnlock(&pool->lock);
+}
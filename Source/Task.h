@@ -0,0 +1,53 @@
+#pragma once
+#include "Array.h"
+#include "Thread.h"
+
+// Runs batches of independent work items on a fixed set of threads. A batch is cut into
+// ranges that are dealt out to the workers' queues up front. A worker takes its own ranges
+// from the back of its queue and, once that is empty, steals from the front of the others.
+// Between batches the threads sleep on a condition variable.
+
+#ifndef TASK_MAX_RANGES
+#define TASK_MAX_RANGES 65536
+#endif
+
+// Called with items [first, first + count)
+typedef void (*Task_Proc)(void *user, u32 first, u32 count);
+
+typedef struct Task_Range {
+	u32 first;
+	u32 count;
+} Task_Range;
+
+typedef struct Task_Pool Task_Pool;
+
+typedef struct Task_Worker {
+	Task_Pool *         pool;
+	u32                 index;
+	Thread              thread;
+	Mutex               lock;  // guards the queue, owner and thieves take ranges under it
+	M_Array(Task_Range) queue; // unclaimed ranges are [head, count)
+	imem                head;
+} Task_Worker;
+
+struct Task_Pool {
+	Task_Worker *workers; // worker 0 is the thread calling TaskRun
+	u32          worker_count;
+
+	Task_Proc    proc;
+	void *       user;
+
+	Mutex        lock;       // guards the three below
+	Condition    start;      // signalled when generation changes
+	Condition    done;       // signalled when busy drops to 0
+	u32          generation; // bumped to start a batch
+	u32          busy;       // threads still working on the current batch
+	bool         quit;
+};
+
+// A worker count of 0 starts one worker per core. With a single worker no threads are started.
+bool TaskPoolInit(Task_Pool *pool, u32 worker_count);
+void TaskPoolFree(Task_Pool *pool);
+
+// Runs items [0, count) in ranges of `grain` items and returns when all of them are done
+void TaskRun(Task_Pool *pool, u32 count, u32 grain, Task_Proc proc, void *user);
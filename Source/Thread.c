@@ -0,0 +1,157 @@
+#include "Thread.h"
+
+#if PLATFORM_WINDOWS == 1
+#pragma warning(push)
+#pragma warning(disable : 5105)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#pragma warning(pop)
+
+static DWORD WINAPI ThreadEntry(void *param) {
+	Thread *thread = param;
+	thread->proc(thread->argument);
+	return 0;
+}
+
+bool ThreadStart(Thread *thread, Thread_Proc proc, void *argument) {
+	thread->proc     = proc;
+	thread->argument = argument;
+	thread->handle   = CreateThread(nullptr, 0, ThreadEntry, thread, 0, nullptr);
+	return thread->handle != nullptr;
+}
+
+void ThreadJoin(Thread *thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	thread->handle = nullptr;
+}
+
+u32 ThreadCoreCount(void) {
+	DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+	return count ? (u32)count : 1;
+}
+
+void ThreadYield(void) {
+	SwitchToThread();
+}
+
+static_assert(sizeof(SRWLOCK) <= sizeof(Mutex), "");
+
+void MutexInit(Mutex *mutex) {
+	InitializeSRWLock((SRWLOCK *)mutex->storage);
+}
+
+void MutexFree(Mutex *mutex) {
+}
+
+void MutexLock(Mutex *mutex) {
+	AcquireSRWLockExclusive((SRWLOCK *)mutex->storage);
+}
+
+void MutexUnlock(Mutex *mutex) {
+	ReleaseSRWLockExclusive((SRWLOCK *)mutex->storage);
+}
+
+static_assert(sizeof(CONDITION_VARIABLE) <= sizeof(Condition), "");
+
+void ConditionInit(Condition *condition) {
+	InitializeConditionVariable((CONDITION_VARIABLE *)condition->storage);
+}
+
+void ConditionFree(Condition *condition) {
+}
+
+void ConditionWait(Condition *condition, Mutex *mutex) {
+	SleepConditionVariableSRW((CONDITION_VARIABLE *)condition->storage, (SRWLOCK *)mutex->storage, INFINITE, 0);
+}
+
+void ConditionWakeAll(Condition *condition) {
+	WakeAllConditionVariable((CONDITION_VARIABLE *)condition->storage);
+}
+
+#endif
+
+#if PLATFORM_LINUX == 1 || PLATFORM_MAC == 1
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <string.h>
+
+static_assert(sizeof(pthread_t) <= sizeof(void *), "");
+
+static void *ThreadEntry(void *param) {
+	Thread *thread = param;
+	thread->proc(thread->argument);
+	return nullptr;
+}
+
+bool ThreadStart(Thread *thread, Thread_Proc proc, void *argument) {
+	pthread_t handle;
+
+	thread->proc     = proc;
+	thread->argument = argument;
+
+	if (pthread_create(&handle, nullptr, ThreadEntry, thread) != 0) {
+		thread->handle = nullptr;
+		return false;
+	}
+
+	// pthread_t is an integer on Linux and a pointer on Mac
+	memcpy(&thread->handle, &handle, sizeof(handle));
+	return true;
+}
+
+void ThreadJoin(Thread *thread) {
+	pthread_t handle;
+	memcpy(&handle, &thread->handle, sizeof(handle));
+	pthread_join(handle, nullptr);
+	thread->handle = nullptr;
+}
+
+u32 ThreadCoreCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (u32)count : 1;
+}
+
+void ThreadYield(void) {
+	sched_yield();
+}
+
+static_assert(sizeof(pthread_mutex_t) <= sizeof(Mutex), "");
+
+void MutexInit(Mutex *mutex) {
+	pthread_mutex_init((pthread_mutex_t *)mutex->storage, nullptr);
+}
+
+void MutexFree(Mutex *mutex) {
+	pthread_mutex_destroy((pthread_mutex_t *)mutex->storage);
+}
+
+void MutexLock(Mutex *mutex) {
+	pthread_mutex_lock((pthread_mutex_t *)mutex->storage);
+}
+
+void MutexUnlock(Mutex *mutex) {
+	pthread_mutex_unlock((pthread_mutex_t *)mutex->storage);
+}
+
+static_assert(sizeof(pthread_cond_t) <= sizeof(Condition), "");
+
+void ConditionInit(Condition *condition) {
+	pthread_cond_init((pthread_cond_t *)condition->storage, nullptr);
+}
+
+void ConditionFree(Condition *condition) {
+	pthread_cond_destroy((pthread_cond_t *)condition->storage);
+}
+
+void ConditionWait(Condition *condition, Mutex *mutex) {
+	pthread_cond_wait((pthread_cond_t *)condition->storage, (pthread_mutex_t *)mutex->storage);
+}
+
+void ConditionWakeAll(Condition *condition) {
+	pthread_cond_broadcast((pthread_cond_t *)condition->storage);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+#include "Platform.h"
+
+typedef void (*Thread_Proc)(void *argument);
+
+// Must stay at the same address until ThreadJoin returns
+typedef struct Thread {
+	void *      handle;
+	Thread_Proc proc;
+	void *      argument;
+} Thread;
+
+bool ThreadStart(Thread *thread, Thread_Proc proc, void *argument);
+void ThreadJoin(Thread *thread);
+u32  ThreadCoreCount(void);
+
+// Gives the rest of the time slice to another thread, for waits expected to be short
+void ThreadYield(void);
+
+// Large enough for the native lock on every platform, see Thread.c
+typedef struct Mutex {
+	u64 storage[8];
+} Mutex;
+
+void MutexInit(Mutex *mutex);
+void MutexFree(Mutex *mutex);
+void MutexLock(Mutex *mutex);
+void MutexUnlock(Mutex *mutex);
+
+// Same as for Mutex, see Thread.c
+typedef struct Condition {
+	u64 storage[8];
+} Condition;
+
+void ConditionInit(Condition *condition);
+void ConditionFree(Condition *condition);
+
+// Releases `mutex` while asleep and holds it again on return, which can be spurious, so wait
+// in a loop over the state that `mutex` guards
+void ConditionWait(Condition *condition, Mutex *mutex);
+void ConditionWakeAll(Condition *condition);
+
+//
+//
+//
+
+#if COMPILER_MSVC == 1
+#include <intrin.h>
+
+inproc u32 AtomicLoad32(volatile u32 *value) {
+	return (u32)_InterlockedOr((volatile long *)value, 0);
+}
+
+// Returns the value before the exchange, the exchange happened if it equals `expected`
+inproc u32 AtomicCompareExchange32(volatile u32 *value, u32 expected, u32 desired) {
+	return (u32)_InterlockedCompareExchange((volatile long *)value, (long)desired, (long)expected);
+}
+
+inproc void AtomicStore32(volatile u32 *value, u32 desired) {
+	_InterlockedExchange((volatile long *)value, (long)desired);
+}
+
+// Returns the value after the addition
+inproc u32 AtomicAdd32(volatile u32 *value, u32 addend) {
+	return (u32)_InterlockedExchangeAdd((volatile long *)value, (long)addend) + addend;
+}
+#else
+inproc u32 AtomicLoad32(volatile u32 *value) {
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+inproc u32 AtomicCompareExchange32(volatile u32 *value, u32 expected, u32 desired) {
+	__atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	return expected;
+}
+
+inproc void AtomicStore32(volatile u32 *value, u32 desired) {
+	__atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+inproc u32 AtomicAdd32(volatile u32 *value, u32 addend) {
+	return __atomic_add_fetch(value, addend, __ATOMIC_ACQ_REL);
+}
+#endif
+
+inproc void AtomicMin32(volatile u32 *value, u32 candidate) {
+	for (u32 current = AtomicLoad32(value); candidate < current;) {
+		u32 seen = AtomicCompareExchange32(value, current, candidate);
+		if (seen == current) break;
+		current = seen;
+	}
+}
@@ -0,0 +1,278 @@
+#include "Utf8.h"
+
+#include <string.h>
+
+// Number of bytes of the valid sequence at `data`, 0 when it is invalid or cut off. `valid` gets
+// how many of its bytes are fine, which is the whole rest of the data for a cut off sequence.
+static umem Utf8ScalarStep(const u8 *data, umem size, umem *valid) {
+	u8 lead = data[0];
+	u8 low  = 0x80;
+	u8 high = 0xbf;
+	umem count;
+
+	if (lead < 0x80) {
+		*valid = 1;
+		return 1;
+	}
+
+	if (lead >= 0xc2 && lead <= 0xdf) {
+		count = 2;
+	} else if (lead >= 0xe0 && lead <= 0xef) {
+		count = 3;
+		if (lead == 0xe0) low  = 0xa0; // overlong
+		if (lead == 0xed) high = 0x9f; // surrogates
+	} else if (lead >= 0xf0 && lead <= 0xf4) {
+		count = 4;
+		if (lead == 0xf0) low  = 0x90; // overlong
+		if (lead == 0xf4) high = 0x8f; // past U+10FFFF
+	} else {
+		*valid = 0;
+		return 0;
+	}
+
+	*valid = 1;
+	for (umem index = 1; index < count; ++index) {
+		if (index == size)
+			return 0;
+
+		u8 byte = data[index];
+		if (index == 1 ? (byte < low || byte > high) : (byte & 0xc0) != 0x80)
+			return 0;
+
+		*valid += 1;
+	}
+
+	return count;
+}
+
+static umem Utf8ValidateScalar(const u8 *data, umem size, umem *partial) {
+	umem pos = 0;
+
+	while (pos < size) {
+		umem valid;
+		umem count = Utf8ScalarStep(data + pos, size - pos, &valid);
+
+		if (!count) {
+			if (partial && pos + valid == size) {
+				*partial = valid;
+				return size;
+			}
+			return pos;
+		}
+
+		pos += count;
+	}
+
+	if (partial)
+		*partial = 0;
+	return size;
+}
+
+umem Utf8InvalidLength(const u8 *data, umem size, umem offset) {
+	umem valid;
+	Utf8ScalarStep(data + offset, size - offset, &valid);
+	return Max(valid, 1);
+}
+
+//
+//
+//
+
+#if ARCH_X64
+
+#if COMPILER_MSVC
+#include <intrin.h>
+#define UTF8_SSSE3
+#else
+#include <cpuid.h>
+#define UTF8_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+#include <tmmintrin.h>
+
+static bool Utf8HasSsse3(void) {
+	static int Supported = -1; // worked out on first use, every thread gets the same answer
+
+	if (Supported < 0) {
+#if COMPILER_MSVC
+		int info[4];
+		__cpuid(info, 1);
+		Supported = (info[2] >> 9) & 1;
+#else
+		unsigned eax, ebx, ecx, edx;
+		Supported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? (ecx >> 9) & 1 : 0;
+#endif
+	}
+
+	return Supported;
+}
+
+// Error classes of two consecutive bytes. Each table marks the classes its nibble allows, an
+// error is a class all three tables agree on.
+#define TOO_SHORT      (1 << 0) // lead byte followed by a lead byte or ASCII
+#define TOO_LONG       (1 << 1) // ASCII followed by a continuation
+#define OVERLONG_3     (1 << 2)
+#define TOO_LARGE      (1 << 3)
+#define SURROGATE      (1 << 4)
+#define OVERLONG_2     (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4     (1 << 6)
+#define TWO_CONTS      (1 << 7) // two continuations, fine when they belong to a 3 or 4 byte sequence
+#define CARRY          (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+typedef struct Utf8_State {
+	__m128i previous;   // last block checked
+	__m128i incomplete; // nonzero when it ended inside a sequence
+	__m128i error;
+} Utf8_State;
+
+UTF8_SSSE3 static __m128i Utf8Lookup(__m128i nibbles, __m128i table) {
+	return _mm_shuffle_epi8(table, nibbles);
+}
+
+UTF8_SSSE3 static __m128i Utf8High(__m128i input) {
+	return _mm_and_si128(_mm_srli_epi16(input, 4), _mm_set1_epi8(0x0f));
+}
+
+UTF8_SSSE3 static void Utf8CheckBlock(Utf8_State *state, __m128i input) {
+	const __m128i byte_1_high_table = _mm_setr_epi8(
+		TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+		TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+		TOO_SHORT | OVERLONG_2,
+		TOO_SHORT,
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+
+	const __m128i byte_1_low_table = _mm_setr_epi8(
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+		CARRY | OVERLONG_2,
+		CARRY,
+		CARRY,
+		CARRY | TOO_LARGE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000);
+
+	const __m128i byte_2_high_table = _mm_setr_epi8(
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+		TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+	__m128i prev1 = _mm_alignr_epi8(input, state->previous, 15);
+	__m128i prev2 = _mm_alignr_epi8(input, state->previous, 14);
+	__m128i prev3 = _mm_alignr_epi8(input, state->previous, 13);
+
+	__m128i special = _mm_and_si128(
+		_mm_and_si128(Utf8Lookup(Utf8High(prev1), byte_1_high_table),
+		              Utf8Lookup(_mm_and_si128(prev1, _mm_set1_epi8(0x0f)), byte_1_low_table)),
+		Utf8Lookup(Utf8High(input), byte_2_high_table));
+
+	// Third and fourth bytes of a sequence are the two continuations in a row that are allowed
+	__m128i third  = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xe0 - 0x80)));
+	__m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xf0 - 0x80)));
+	__m128i must   = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+
+	state->error = _mm_or_si128(state->error, _mm_xor_si128(must, special));
+
+	// Lead bytes too close to the end for their sequence to fit
+	const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+	state->incomplete = _mm_subs_epu8(input, max);
+	state->previous   = input;
+}
+
+UTF8_SSSE3 static bool Utf8CheckChunk(Utf8_State *state, const u8 *data) {
+	__m128i a = _mm_loadu_si128((const __m128i *)data);
+	__m128i b = _mm_loadu_si128((const __m128i *)(data + 16));
+	__m128i c = _mm_loadu_si128((const __m128i *)(data + 32));
+	__m128i d = _mm_loadu_si128((const __m128i *)(data + 48));
+
+	// ASCII only has to check that nothing was left open before it
+	if (!_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)))) {
+		state->error      = _mm_or_si128(state->error, state->incomplete);
+		state->incomplete = _mm_setzero_si128();
+		state->previous   = d;
+	} else {
+		Utf8CheckBlock(state, a);
+		Utf8CheckBlock(state, b);
+		Utf8CheckBlock(state, c);
+		Utf8CheckBlock(state, d);
+	}
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(state->error, _mm_setzero_si128())) == 0xffff;
+}
+
+// Finds a 64 byte chunk that holds an error or ends inside a sequence, false when there is none
+UTF8_SSSE3 static bool Utf8FindChunk(const u8 *data, umem size, umem *chunk) {
+	Utf8_State state;
+	state.previous   = _mm_setzero_si128();
+	state.incomplete = _mm_setzero_si128();
+	state.error      = _mm_setzero_si128();
+
+	umem pos = 0;
+	for (; pos + 64 <= size; pos += 64) {
+		if (!Utf8CheckChunk(&state, data + pos)) {
+			*chunk = pos;
+			return true;
+		}
+	}
+
+	// The tail is padded with ASCII, which also catches a sequence the data ends inside of
+	u8 tail[64];
+	memset(tail, ' ', sizeof(tail));
+	memcpy(tail, data + pos, size - pos);
+
+	if (!Utf8CheckChunk(&state, tail)) {
+		*chunk = pos;
+		return true;
+	}
+
+	return false;
+}
+
+#undef TOO_SHORT
+#undef TOO_LONG
+#undef OVERLONG_3
+#undef TOO_LARGE
+#undef SURROGATE
+#undef OVERLONG_2
+#undef TOO_LARGE_1000
+#undef OVERLONG_4
+#undef TWO_CONTS
+#undef CARRY
+
+#endif
+
+umem Utf8Validate(const u8 *data, umem size, umem *partial) {
+#if ARCH_X64
+	if (Utf8HasSsse3()) {
+		umem chunk;
+		if (!Utf8FindChunk(data, size, &chunk)) {
+			if (partial)
+				*partial = 0;
+			return size;
+		}
+
+		// Errors in the last bytes of a chunk only show once the next one is checked. Back up
+		// past them to the start of a sequence and find the error byte by byte.
+		umem from = chunk >= 3 ? chunk - 3 : 0;
+		for (int back = 0; back < 3 && from > 0 && (data[from] & 0xc0) == 0x80; ++back)
+			from -= 1;
+
+		return from + Utf8ValidateScalar(data + from, size - from, partial);
+	}
+#endif
+
+	return Utf8ValidateScalar(data, size, partial);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Platform.h"
+
+// Validation follows Unicode table 3-7: no overlong forms, no surrogates, nothing past U+10FFFF.
+// On x64 with SSSE3, 64 bytes are checked at a time with the lookup algorithm of Keiser and
+// Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte". Only a failing block is
+// looked at byte by byte, to find where exactly the error is.
+
+// Offset of the first byte that is not part of valid UTF-8, `size` when all of it is. With
+// `partial`, a sequence cut off by the end of the data is not an error, its length goes there.
+umem Utf8Validate(const u8 *data, umem size, umem *partial);
+
+// Length of the invalid sequence at `offset`, its maximal subpart as Unicode defines it
+umem Utf8InvalidLength(const u8 *data, umem size, umem offset);
+
+// Bytes in the sequence a valid lead byte starts
+inproc u32 Utf8SequenceLength(u8 lead) {
+	if (lead < 0x80) return 1;
+	if (lead < 0xe0) return 2;
+	if (lead < 0xf0) return 3;
+	return 4;
+}
@@ -0,0 +1,397 @@
+//
+// Generates Source/LexerTables.h from the lexer DFA description below.
+//
+//   cl /std:c17 /ISource Tools\LexerGen.c && LexerGen.exe Source\LexerTables.h
+//   cc -std=c17 -ISource Tools/LexerGen.c -o LexerGen && ./LexerGen Source/LexerTables.h
+//
+// The DFA is first built over all 256 input bytes, then bytes with identical
+// columns are folded into character classes, so the lexer only has to carry
+// a 256 byte class map and a small [state][class] transition matrix.
+//
+// Keywords are recognized after the DFA on identifier tokens, through a perfect hash
+// that is searched for here, see LexKeywordHash.
+//
+
+#include "Lexer.h"
+#include "LexerDFA.h"
+
+#include <string.h>
+
+static const char *LexStateNames[] = {
+	"Error", "Whitespace", "Plus", "Minus", "Multiply", "Divide", "Bracket_Open", "Bracket_Close", "Equals",
+	"Integer_Zero", "Integer", "Integer_Hex", "Integer_Binary", "Integer_Octal",
+	"Float_Dot", "Float_Fraction", "Float_Exponent_Mark", "Float_Exponent_Sign", "Float_Exponent", "Identifier"
+};
+static_assert(ArrayCount(LexStateNames) == Lex_State_COUNT, "");
+
+static const char *TokenKindNames[] = {
+	"True", "False", "Integer", "Float", "Plus", "Minus", "Multiply", "Divide", "Bracket_Open", "Bracket_Close", "Equals", "Identifier", "END"
+};
+static_assert(ArrayCount(TokenKindNames) == Token_Kind_END + 1, "");
+
+typedef struct Keyword {
+	const char *text;
+	Token_Kind  kind;
+} Keyword;
+
+static const Keyword Keywords[] = {
+	{ "true",  Token_Kind_True },
+	{ "false", Token_Kind_False },
+};
+
+static u8 TransitionTable[Lex_State_COUNT][256];
+static u8 ProductionTable[Lex_State_COUNT][Lex_State_COUNT];
+static u8 TokenKindMap[Lex_State_COUNT];
+
+static u8  CharClass[256];
+static u8  ClassTransition[Lex_State_COUNT][256];
+static int ClassCount;
+
+static void LexUpdateTransition(const Lex_State *const entries, int count, Lex_State next, u8 ch) {
+	for (int i = 0; i < count; ++i) {
+		Lex_State entry = entries[i];
+		TransitionTable[entry][ch] = next;
+	}
+}
+
+static void LexUpdateTransitionRange(const Lex_State *const entries, int count, Lex_State next, u8 first, u8 last) {
+	for (int i = first; i <= last; ++i) {
+		LexUpdateTransition(entries, count, next, (u8)i);
+	}
+}
+
+static void LexBuildTables(void) {
+	const u8 Whitespaces[] = " \t\n\r\v\f";
+
+	// Single Byte Tokens
+	for (int i = 0; i < Lex_State_COUNT; ++i) {
+		for (int j = 0; j < ArrayCount(Whitespaces) - 1; ++j) {
+			TransitionTable[i][Whitespaces[j]] = Lex_State_Whitespace;
+		}
+
+		TransitionTable[i]['+'] = Lex_State_Plus;
+		TransitionTable[i]['-'] = Lex_State_Minus;
+		TransitionTable[i]['*'] = Lex_State_Multiply;
+		TransitionTable[i]['/'] = Lex_State_Divide;
+		TransitionTable[i]['('] = Lex_State_Bracket_Open;
+		TransitionTable[i][')'] = Lex_State_Bracket_Close;
+		TransitionTable[i]['='] = Lex_State_Equals;
+	}
+
+	const Lex_State IntegerEntries[] = {
+		Lex_State_Plus, Lex_State_Minus, Lex_State_Multiply, Lex_State_Divide,
+		Lex_State_Bracket_Open, Lex_State_Bracket_Close, Lex_State_Equals,
+		Lex_State_Whitespace
+	};
+
+	LexUpdateTransition(IntegerEntries, ArrayCount(IntegerEntries), Lex_State_Integer_Zero, '0');
+	LexUpdateTransitionRange(IntegerEntries, ArrayCount(IntegerEntries), Lex_State_Integer, '1', '9');
+
+	// Digits and "_" separators, "0x", "0b" and "0o" switch the radix
+	const Lex_State IntegerMids[] = { Lex_State_Integer_Zero, Lex_State_Integer };
+	LexUpdateTransitionRange(IntegerMids, ArrayCount(IntegerMids), Lex_State_Integer, '0', '9');
+	LexUpdateTransition(IntegerMids, ArrayCount(IntegerMids), Lex_State_Integer, '_');
+
+	const Lex_State IntegerZero[] = { Lex_State_Integer_Zero };
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Hex, 'x');
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Hex, 'X');
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Binary, 'b');
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Binary, 'B');
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Octal, 'o');
+	LexUpdateTransition(IntegerZero, ArrayCount(IntegerZero), Lex_State_Integer_Octal, 'O');
+
+	const Lex_State IntegerHex[] = { Lex_State_Integer_Hex };
+	LexUpdateTransitionRange(IntegerHex, ArrayCount(IntegerHex), Lex_State_Integer_Hex, '0', '9');
+	LexUpdateTransitionRange(IntegerHex, ArrayCount(IntegerHex), Lex_State_Integer_Hex, 'a', 'f');
+	LexUpdateTransitionRange(IntegerHex, ArrayCount(IntegerHex), Lex_State_Integer_Hex, 'A', 'F');
+	LexUpdateTransition(IntegerHex, ArrayCount(IntegerHex), Lex_State_Integer_Hex, '_');
+
+	const Lex_State IntegerBinary[] = { Lex_State_Integer_Binary };
+	LexUpdateTransitionRange(IntegerBinary, ArrayCount(IntegerBinary), Lex_State_Integer_Binary, '0', '1');
+	LexUpdateTransition(IntegerBinary, ArrayCount(IntegerBinary), Lex_State_Integer_Binary, '_');
+
+	const Lex_State IntegerOctal[] = { Lex_State_Integer_Octal };
+	LexUpdateTransitionRange(IntegerOctal, ArrayCount(IntegerOctal), Lex_State_Integer_Octal, '0', '7');
+	LexUpdateTransition(IntegerOctal, ArrayCount(IntegerOctal), Lex_State_Integer_Octal, '_');
+
+	// Decimal floats, digits "." digits with an optional exponent
+	LexUpdateTransition(IntegerMids, ArrayCount(IntegerMids), Lex_State_Float_Dot, '.');
+	LexUpdateTransition(IntegerMids, ArrayCount(IntegerMids), Lex_State_Float_Exponent_Mark, 'e');
+	LexUpdateTransition(IntegerMids, ArrayCount(IntegerMids), Lex_State_Float_Exponent_Mark, 'E');
+
+	const Lex_State FloatFractionEntries[] = { Lex_State_Float_Dot, Lex_State_Float_Fraction };
+	LexUpdateTransitionRange(FloatFractionEntries, ArrayCount(FloatFractionEntries), Lex_State_Float_Fraction, '0', '9');
+
+	const Lex_State FloatFraction[] = { Lex_State_Float_Fraction };
+	LexUpdateTransition(FloatFraction, ArrayCount(FloatFraction), Lex_State_Float_Fraction, '_');
+	LexUpdateTransition(FloatFraction, ArrayCount(FloatFraction), Lex_State_Float_Exponent_Mark, 'e');
+	LexUpdateTransition(FloatFraction, ArrayCount(FloatFraction), Lex_State_Float_Exponent_Mark, 'E');
+
+	const Lex_State FloatExponentMark[] = { Lex_State_Float_Exponent_Mark };
+	LexUpdateTransition(FloatExponentMark, ArrayCount(FloatExponentMark), Lex_State_Float_Exponent_Sign, '+');
+	LexUpdateTransition(FloatExponentMark, ArrayCount(FloatExponentMark), Lex_State_Float_Exponent_Sign, '-');
+
+	const Lex_State FloatExponentEntries[] = { Lex_State_Float_Exponent_Mark, Lex_State_Float_Exponent_Sign, Lex_State_Float_Exponent };
+	LexUpdateTransitionRange(FloatExponentEntries, ArrayCount(FloatExponentEntries), Lex_State_Float_Exponent, '0', '9');
+
+	const Lex_State FloatExponent[] = { Lex_State_Float_Exponent };
+	LexUpdateTransition(FloatExponent, ArrayCount(FloatExponent), Lex_State_Float_Exponent, '_');
+
+	const Lex_State IdentifierEntries[] = {
+		Lex_State_Plus, Lex_State_Minus, Lex_State_Multiply, Lex_State_Divide,
+		Lex_State_Bracket_Open, Lex_State_Bracket_Close, Lex_State_Equals,
+		Lex_State_Whitespace, Lex_State_Identifier
+	};
+
+	LexUpdateTransition(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, '_');
+	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, 'a', 'z');
+	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, 'A', 'Z');
+
+	const Lex_State IdentifierMids[] = { Lex_State_Identifier };
+	LexUpdateTransitionRange(IdentifierMids, ArrayCount(IdentifierMids), Lex_State_Identifier, '0', '9');
+
+	// The input is validated as UTF-8 before it gets here, so every byte of a multi byte
+	// sequence can simply be an identifier byte
+	LexUpdateTransitionRange(IdentifierEntries, ArrayCount(IdentifierEntries), Lex_State_Identifier, 128, 255);
+
+	const Lex_State Integers[] = {
+		Lex_State_Integer_Zero, Lex_State_Integer, Lex_State_Integer_Hex, Lex_State_Integer_Binary, Lex_State_Integer_Octal
+	};
+
+	const Lex_State Floats[] = {
+		Lex_State_Float_Dot, Lex_State_Float_Fraction, Lex_State_Float_Exponent_Mark, Lex_State_Float_Exponent_Sign, Lex_State_Float_Exponent
+	};
+
+	for (int i = 0; i < Lex_State_COUNT; ++i) {
+		ProductionTable[Lex_State_Error][i]         = Lex_Prod_Error;
+		ProductionTable[Lex_State_Whitespace][i]    = Lex_Prod_Reset;
+		ProductionTable[Lex_State_Identifier][i]    = Lex_Prod_Identifier;
+		ProductionTable[Lex_State_Plus][i]          = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Minus][i]         = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Multiply][i]      = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Divide][i]        = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Bracket_Open][i]  = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Bracket_Close][i] = Lex_Prod_Symbol;
+		ProductionTable[Lex_State_Equals][i]        = Lex_Prod_Symbol;
+
+		for (int j = 0; j < ArrayCount(Integers); ++j)
+			ProductionTable[Integers[j]][i] = Lex_Prod_Integer;
+
+		for (int j = 0; j < ArrayCount(Floats); ++j)
+			ProductionTable[Floats[j]][i] = Lex_Prod_Float;
+	}
+
+	// Bytes that can not start a token, and letters glued to the end of a number
+	ProductionTable[Lex_State_Whitespace][Lex_State_Error] = Lex_Prod_Error;
+	for (int j = 0; j < ArrayCount(Integers); ++j)
+		ProductionTable[Integers[j]][Lex_State_Error] = Lex_Prod_Error;
+	for (int j = 0; j < ArrayCount(Floats); ++j)
+		ProductionTable[Floats[j]][Lex_State_Error] = Lex_Prod_Error;
+
+	ProductionTable[Lex_State_Identifier][Lex_State_Identifier] = Lex_Prod_None;
+
+	ProductionTable[Lex_State_Integer_Zero][Lex_State_Integer]          = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Zero][Lex_State_Integer_Hex]      = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Zero][Lex_State_Integer_Binary]   = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Zero][Lex_State_Integer_Octal]    = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer][Lex_State_Integer]               = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Hex][Lex_State_Integer_Hex]       = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Binary][Lex_State_Integer_Binary] = Lex_Prod_None;
+	ProductionTable[Lex_State_Integer_Octal][Lex_State_Integer_Octal]   = Lex_Prod_None;
+
+	for (int j = 0; j < ArrayCount(IntegerMids); ++j) {
+		ProductionTable[IntegerMids[j]][Lex_State_Float_Dot]           = Lex_Prod_None;
+		ProductionTable[IntegerMids[j]][Lex_State_Float_Exponent_Mark] = Lex_Prod_None;
+	}
+
+	ProductionTable[Lex_State_Float_Dot][Lex_State_Float_Fraction]                = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Fraction][Lex_State_Float_Fraction]           = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Fraction][Lex_State_Float_Exponent_Mark]      = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Exponent_Mark][Lex_State_Float_Exponent_Sign] = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Exponent_Mark][Lex_State_Float_Exponent]      = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Exponent_Sign][Lex_State_Float_Exponent]      = Lex_Prod_None;
+	ProductionTable[Lex_State_Float_Exponent][Lex_State_Float_Exponent]           = Lex_Prod_None;
+
+	for (int i = 0; i < Lex_State_COUNT; ++i)
+		TokenKindMap[i] = Token_Kind_END;
+
+	TokenKindMap[Lex_State_Plus]          = Token_Kind_Plus;
+	TokenKindMap[Lex_State_Minus]         = Token_Kind_Minus;
+	TokenKindMap[Lex_State_Multiply]      = Token_Kind_Multiply;
+	TokenKindMap[Lex_State_Divide]        = Token_Kind_Divide;
+	TokenKindMap[Lex_State_Bracket_Open]  = Token_Kind_Bracket_Open;
+	TokenKindMap[Lex_State_Bracket_Close] = Token_Kind_Bracket_Close;
+	TokenKindMap[Lex_State_Equals]        = Token_Kind_Equals;
+	TokenKindMap[Lex_State_Identifier]    = Token_Kind_Identifier;
+
+	for (int j = 0; j < ArrayCount(Integers); ++j)
+		TokenKindMap[Integers[j]] = Token_Kind_Integer;
+
+	for (int j = 0; j < ArrayCount(Floats); ++j)
+		TokenKindMap[Floats[j]] = Token_Kind_Float;
+}
+
+static bool LexColumnEquals(int a, int b) {
+	for (int state = 0; state < Lex_State_COUNT; ++state) {
+		if (TransitionTable[state][a] != TransitionTable[state][b])
+			return false;
+	}
+	return true;
+}
+
+static void LexCompressTables(void) {
+	int representative[256];
+
+	ClassCount = 0;
+	for (int ch = 0; ch < 256; ++ch) {
+		int klass = 0;
+		for (; klass < ClassCount; ++klass) {
+			if (LexColumnEquals(representative[klass], ch))
+				break;
+		}
+
+		if (klass == ClassCount) {
+			representative[ClassCount++] = ch;
+			for (int state = 0; state < Lex_State_COUNT; ++state)
+				ClassTransition[state][klass] = TransitionTable[state][ch];
+		}
+
+		CharClass[ch] = (u8)klass;
+	}
+}
+
+static int KeywordSlot[256];
+static u32 KeywordFirst;
+static u32 KeywordLast;
+static u32 KeywordMask;
+static umem KeywordMinLength;
+static umem KeywordMaxLength;
+
+static bool LexTryKeywordHash(u32 first, u32 last, u32 mask) {
+	for (u32 slot = 0; slot <= mask; ++slot)
+		KeywordSlot[slot] = -1;
+
+	for (int index = 0; index < ArrayCount(Keywords); ++index) {
+		const u8 *text = (const u8 *)Keywords[index].text;
+		u32       slot = LexKeywordHash(text, strlen(Keywords[index].text), first, last, mask);
+		if (KeywordSlot[slot] >= 0)
+			return false;
+		KeywordSlot[slot] = index;
+	}
+
+	return true;
+}
+
+// Smallest table first, the multipliers are searched within each size
+static bool LexBuildKeywords(void) {
+	KeywordMinLength = (umem)-1;
+	KeywordMaxLength = 0;
+	for (int index = 0; index < ArrayCount(Keywords); ++index) {
+		umem length = strlen(Keywords[index].text);
+		Assert(length > 0 && length < 256);
+		KeywordMinLength = Min(KeywordMinLength, length);
+		KeywordMaxLength = Max(KeywordMaxLength, length);
+	}
+
+	u32 size = 1;
+	while (size < ArrayCount(Keywords))
+		size *= 2;
+
+	for (; size <= 256; size *= 2) {
+		for (u32 first = 1; first < 256; ++first) {
+			for (u32 last = 0; last < 256; ++last) {
+				if (LexTryKeywordHash(first, last, size - 1)) {
+					KeywordFirst = first;
+					KeywordLast  = last;
+					KeywordMask  = size - 1;
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+static void LexEmitTables(FILE *out) {
+	fprintf(out, "// Generated by Tools/LexerGen.c, do not edit.\n");
+	fprintf(out, "#pragma once\n");
+	fprintf(out, "#include \"LexerDFA.h\"\n\n");
+
+	fprintf(out, "#define LEX_CLASS_COUNT %d\n\n", ClassCount);
+	fprintf(out, "static_assert(Lex_State_COUNT == %d, \"LexerTables.h is out of date, rerun Tools/LexerGen.c\");\n\n", Lex_State_COUNT);
+
+	fprintf(out, "static const u8 LexCharClass[256] = {\n");
+	for (int row = 0; row < 256; row += 16) {
+		fprintf(out, "\t");
+		for (int ch = row; ch < row + 16; ++ch)
+			fprintf(out, "%2d,%s", CharClass[ch], ch == row + 15 ? "" : " ");
+		fprintf(out, " // 0x%02X\n", row);
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static const u8 LexTransition[Lex_State_COUNT][LEX_CLASS_COUNT] = {\n");
+	for (int state = 0; state < Lex_State_COUNT; ++state) {
+		fprintf(out, "\t[Lex_State_%-19s] = { ", LexStateNames[state]);
+		for (int klass = 0; klass < ClassCount; ++klass)
+			fprintf(out, "%2d,%s", ClassTransition[state][klass], klass == ClassCount - 1 ? "" : " ");
+		fprintf(out, " },\n");
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static const u8 LexProduction[Lex_State_COUNT][Lex_State_COUNT] = {\n");
+	for (int curr = 0; curr < Lex_State_COUNT; ++curr) {
+		fprintf(out, "\t[Lex_State_%-19s] = { ", LexStateNames[curr]);
+		for (int next = 0; next < Lex_State_COUNT; ++next)
+			fprintf(out, "%d,%s", ProductionTable[curr][next], next == Lex_State_COUNT - 1 ? "" : " ");
+		fprintf(out, " },\n");
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static const u8 LexTokenKind[Lex_State_COUNT] = {\n");
+	for (int state = 0; state < Lex_State_COUNT; ++state)
+		fprintf(out, "\t[Lex_State_%-19s] = Token_Kind_%s,\n", LexStateNames[state], TokenKindNames[TokenKindMap[state]]);
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "#define LEX_KEYWORD_MIN_LENGTH %u\n", (u32)KeywordMinLength);
+	fprintf(out, "#define LEX_KEYWORD_MAX_LENGTH %u\n", (u32)KeywordMaxLength);
+	fprintf(out, "#define LEX_KEYWORD_FIRST      %u\n", KeywordFirst);
+	fprintf(out, "#define LEX_KEYWORD_LAST       %u\n", KeywordLast);
+	fprintf(out, "#define LEX_KEYWORD_MASK       %u\n\n", KeywordMask);
+
+	fprintf(out, "static const Lex_Keyword LexKeywords[LEX_KEYWORD_MASK + 1] = {\n");
+	for (u32 slot = 0; slot <= KeywordMask; ++slot) {
+		int index = KeywordSlot[slot];
+		if (index < 0)
+			continue;
+		fprintf(out, "\t[%u] = { \"%s\", %u, Token_Kind_%s },\n", slot, Keywords[index].text,
+			(u32)strlen(Keywords[index].text), TokenKindNames[Keywords[index].kind]);
+	}
+	fprintf(out, "};\n");
+}
+
+int main(int argc, char *argv[]) {
+	FILE *out = stdout;
+
+	if (argc > 1) {
+		out = fopen(argv[1], "wb");
+		if (!out) {
+			fprintf(stderr, "could not open \"%s\" for writing\n", argv[1]);
+			return 1;
+		}
+	}
+
+	LexBuildTables();
+	LexCompressTables();
+
+	if (!LexBuildKeywords()) {
+		fprintf(stderr, "no perfect hash for the keywords, LexKeywordHash needs to read more of them\n");
+		return 1;
+	}
+	LexEmitTables(out);
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
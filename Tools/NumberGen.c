@@ -0,0 +1,170 @@
+//
+// Generates Source/NumberTables.h, the truncated 128 bit powers of five used by
+// the Eisel-Lemire float parser in Source/Number.c.
+//
+//   cl /std:c17 /ISource Tools\NumberGen.c && NumberGen.exe Source\NumberTables.h
+//   cc -std=c17 -ISource Tools/NumberGen.c -o NumberGen && ./NumberGen Source/NumberTables.h
+//
+// For q >= 0 the entry is 5^q shifted so its top bit is bit 127 and truncated.
+// For q < 0 it is floor(2^b / 5^-q) + 1 for a b large enough to keep 128
+// significant bits, also truncated to 128 bits.
+//
+
+#include "Platform.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUMBER_POW5_MIN -342
+#define NUMBER_POW5_MAX 308
+
+#define BIG_LIMBS 96
+
+typedef struct Big {
+	u32 limbs[BIG_LIMBS];
+} Big;
+
+static void BigSet(Big *a, u32 value) {
+	memset(a, 0, sizeof(*a));
+	a->limbs[0] = value;
+}
+
+static void BigMulSmall(Big *a, u32 value) {
+	u64 carry = 0;
+	for (int i = 0; i < BIG_LIMBS; ++i) {
+		u64 t       = (u64)a->limbs[i] * value + carry;
+		a->limbs[i] = (u32)t;
+		carry       = t >> 32;
+	}
+	Assert(carry == 0);
+}
+
+static void BigAddSmall(Big *a, u32 value) {
+	u64 carry = value;
+	for (int i = 0; i < BIG_LIMBS && carry; ++i) {
+		u64 t       = (u64)a->limbs[i] + carry;
+		a->limbs[i] = (u32)t;
+		carry       = t >> 32;
+	}
+}
+
+static void BigShiftLeft1(Big *a) {
+	for (int i = BIG_LIMBS - 1; i > 0; --i)
+		a->limbs[i] = (a->limbs[i] << 1) | (a->limbs[i - 1] >> 31);
+	a->limbs[0] <<= 1;
+}
+
+static void BigShiftRight1(Big *a) {
+	for (int i = 0; i < BIG_LIMBS - 1; ++i)
+		a->limbs[i] = (a->limbs[i] >> 1) | (a->limbs[i + 1] << 31);
+	a->limbs[BIG_LIMBS - 1] >>= 1;
+}
+
+static int BigCompare(const Big *a, const Big *b) {
+	for (int i = BIG_LIMBS - 1; i >= 0; --i) {
+		if (a->limbs[i] != b->limbs[i])
+			return a->limbs[i] < b->limbs[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static void BigSub(Big *a, const Big *b) {
+	i64 borrow = 0;
+	for (int i = 0; i < BIG_LIMBS; ++i) {
+		i64 t       = (i64)a->limbs[i] - b->limbs[i] - borrow;
+		borrow      = t < 0;
+		a->limbs[i] = (u32)(t + (borrow << 32));
+	}
+}
+
+static int BigBitLength(const Big *a) {
+	for (int i = BIG_LIMBS - 1; i >= 0; --i) {
+		if (a->limbs[i]) {
+			int bits = 32;
+			while (!(a->limbs[i] & (1u << (bits - 1))))
+				bits -= 1;
+			return i * 32 + bits;
+		}
+	}
+	return 0;
+}
+
+// quotient = 2^b / divisor, by shift and subtract
+static void BigPow2Div(Big *quotient, int b, const Big *divisor) {
+	Big remainder;
+	BigSet(&remainder, 1);
+	BigSet(quotient, 0);
+
+	for (int bit = b; bit >= 0; --bit) {
+		BigShiftLeft1(quotient);
+		if (BigCompare(&remainder, divisor) >= 0) {
+			BigSub(&remainder, divisor);
+			quotient->limbs[0] |= 1;
+		}
+		if (bit) BigShiftLeft1(&remainder);
+	}
+}
+
+static void BigTop128(const Big *a, u64 *hi, u64 *lo) {
+	int bits = BigBitLength(a);
+	Assert(bits <= 128);
+	*hi = ((u64)a->limbs[3] << 32) | a->limbs[2];
+	*lo = ((u64)a->limbs[1] << 32) | a->limbs[0];
+}
+
+static void NumberPow5(int q, u64 *hi, u64 *lo) {
+	Big power5;
+	BigSet(&power5, 1);
+	for (int i = 0; i < (q < 0 ? -q : q); ++i)
+		BigMulSmall(&power5, 5);
+
+	Big value;
+	if (q >= 0) {
+		value = power5;
+		while (BigBitLength(&value) < 128)
+			BigShiftLeft1(&value);
+		while (BigBitLength(&value) > 128)
+			BigShiftRight1(&value);
+	} else {
+		int z = BigBitLength(&power5);
+		int b = (q >= -27) ? z + 127 : 2 * z + 2 * 64;
+		BigPow2Div(&value, b, &power5);
+		BigAddSmall(&value, 1);
+		while (BigBitLength(&value) > 128)
+			BigShiftRight1(&value);
+	}
+
+	BigTop128(&value, hi, lo);
+}
+
+int main(int argc, char *argv[]) {
+	FILE *out = stdout;
+
+	if (argc > 1) {
+		out = fopen(argv[1], "wb");
+		if (!out) {
+			fprintf(stderr, "could not open \"%s\" for writing\n", argv[1]);
+			return 1;
+		}
+	}
+
+	fprintf(out, "// Generated by Tools/NumberGen.c, do not edit.\n");
+	fprintf(out, "#pragma once\n");
+	fprintf(out, "#include \"Platform.h\"\n\n");
+	fprintf(out, "#define NUMBER_POW5_MIN %d\n", NUMBER_POW5_MIN);
+	fprintf(out, "#define NUMBER_POW5_MAX %d\n\n", NUMBER_POW5_MAX);
+	fprintf(out, "static const u64 NumberPow5Table[(NUMBER_POW5_MAX - NUMBER_POW5_MIN + 1) * 2] = {\n");
+
+	for (int q = NUMBER_POW5_MIN; q <= NUMBER_POW5_MAX; ++q) {
+		u64 hi, lo;
+		NumberPow5(q, &hi, &lo);
+		fprintf(out, "\t0x%016" PRIx64 ", 0x%016" PRIx64 ", // 5^%d\n", hi, lo, q);
+	}
+
+	fprintf(out, "};\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
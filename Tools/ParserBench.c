@@ -0,0 +1,237 @@
+//
+// Compares the explicit stack expression parser against the recursive one it
+// replaced. Both must build the same trees, and on ordinary input the iterative
+// parser should be at least as fast. Deeply nested input is then run through the
+// iterative parser alone, the recursive one would overflow the C stack on it.
+//
+//   cl /std:c17 /O2 /DPARSER_BENCH /ISource Tools\ParserBench.c Source\Lexer.c Source\Parser.c Source\Number.c Source\Memory.c Source\Pool.c Source\Thread.c Source\Diagnostic.c Source\Hash.c Source\Source.c Source\Utf8.c Source\Dump.c Source\Array.c
+//   cc -std=gnu17 -O2 -DPARSER_BENCH -ISource Tools/ParserBench.c Source/Lexer.c Source/Parser.c Source/Number.c Source/Memory.c Source/Pool.c Source/Thread.c Source/Diagnostic.c Source/Hash.c Source/Source.c Source/Utf8.c Source/Dump.c Source/Array.c -lm -lpthread -o ParserBench
+//
+//   ParserBench [statements] [depth]
+//
+
+#include "Parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef PARSER_BENCH
+#error "Parser.c must be compiled with PARSER_BENCH for ParserBench"
+#endif
+
+typedef struct Bench_Text {
+	char *data;
+	umem  count;
+	umem  capacity;
+} Bench_Text;
+
+static void BenchAppend(Bench_Text *text, const char *str) {
+	umem length = strlen(str);
+	if (text->count + length + 1 > text->capacity) {
+		text->capacity = (text->count + length + 1) * 2;
+		text->data     = realloc(text->data, text->capacity);
+	}
+	memcpy(text->data + text->count, str, length + 1);
+	text->count += length;
+}
+
+static u64 BenchRandomState = 0x9e3779b97f4a7c15ull;
+
+static u32 BenchRandom(u32 limit) {
+	BenchRandomState ^= BenchRandomState << 13;
+	BenchRandomState ^= BenchRandomState >> 7;
+	BenchRandomState ^= BenchRandomState << 17;
+	return (u32)(BenchRandomState % limit);
+}
+
+static const char *BenchOperators[] = { " + ", " - ", " * ", " / " };
+
+static void BenchTerm(Bench_Text *text, int depth) {
+	char buffer[64];
+
+	switch (BenchRandom(depth > 0 ? 6 : 3)) {
+	case 0: snprintf(buffer, sizeof(buffer), "v%u", BenchRandom(100)); BenchAppend(text, buffer); break;
+	case 1: snprintf(buffer, sizeof(buffer), "%u", BenchRandom(100000)); BenchAppend(text, buffer); break;
+	case 2: snprintf(buffer, sizeof(buffer), "%u.%u", BenchRandom(1000), BenchRandom(1000)); BenchAppend(text, buffer); break;
+	case 3: BenchAppend(text, "-"); BenchTerm(text, depth - 1); break;
+	default:
+	{
+		BenchAppend(text, "(");
+		BenchTerm(text, depth - 1);
+		u32 count = 1 + BenchRandom(3);
+		for (u32 index = 0; index < count; ++index) {
+			BenchAppend(text, BenchOperators[BenchRandom(4)]);
+			BenchTerm(text, depth - 1);
+		}
+		BenchAppend(text, ")");
+	} break;
+	}
+}
+
+// Statements where assignments and groups interact with operator precedence
+static const char *BenchCorners[] = {
+	"a + b = c * d\n", "(a = b) + c\n", "a * (b = c - d) / e\n", "a = b = c + - - d\n",
+	"((a)) - -(b)\n", "a - b = c = (d) * e\n", "-(a + b) * -c\n", "a / b * c - d + e\n",
+};
+
+static String BenchProgram(u32 statements, int depth) {
+	Bench_Text text = { 0 };
+	char       buffer[64];
+
+	for (u32 index = 0; index < ArrayCount(BenchCorners); ++index)
+		BenchAppend(&text, BenchCorners[index]);
+
+	for (u32 index = ArrayCount(BenchCorners); index < statements; ++index) {
+		snprintf(buffer, sizeof(buffer), "r%u = ", index);
+		BenchAppend(&text, buffer);
+		BenchTerm(&text, depth);
+		u32 count = BenchRandom(4);
+		for (u32 term = 0; term < count; ++term) {
+			BenchAppend(&text, BenchOperators[BenchRandom(4)]);
+			BenchTerm(&text, depth);
+		}
+		BenchAppend(&text, "\n");
+	}
+
+	return (String){ (imem)text.count, (u8 *)text.data };
+}
+
+static String BenchNested(u32 depth) {
+	u8 *data = malloc(depth * 2 + 1);
+	memset(data, '(', depth);
+	data[depth] = '1';
+	memset(data + depth + 1, ')', depth);
+	return (String){ depth * 2 + 1, data };
+}
+
+static String BenchNegated(u32 depth) {
+	u8 *data = malloc(depth * 2 + 1);
+	for (u32 index = 0; index < depth; ++index) {
+		data[index * 2]     = '-';
+		data[index * 2 + 1] = ' ';
+	}
+	data[depth * 2] = 'x';
+	return (String){ depth * 2 + 1, data };
+}
+
+static double BenchSeconds(void) {
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+// Each run registers its own copy of the program, `shift` is how far apart the copies are
+static bool BenchSame(Expr *a, Expr *b, u32 shift) {
+	if (a->kind != b->kind || a->type != b->type || a->range.from + shift != b->range.from || a->range.length != b->range.length)
+		return false;
+
+	switch (a->kind) {
+	case Expr_Kind_Literal:
+		return ((Expr_Literal *)a)->value.integer == ((Expr_Literal *)b)->value.integer;
+	case Expr_Kind_Identifier:
+	{
+		String x = ((Expr_Identifier *)a)->name;
+		String y = ((Expr_Identifier *)b)->name;
+		return x.count == y.count && memcmp(x.data, y.data, x.count) == 0;
+	}
+	case Expr_Kind_Unary_Operator:
+		return ((Expr_Unary_Operator *)a)->symbol == ((Expr_Unary_Operator *)b)->symbol &&
+			BenchSame(((Expr_Unary_Operator *)a)->child, ((Expr_Unary_Operator *)b)->child, shift);
+	case Expr_Kind_Binary_Operator:
+		return ((Expr_Binary_Operator *)a)->symbol == ((Expr_Binary_Operator *)b)->symbol &&
+			BenchSame(((Expr_Binary_Operator *)a)->left, ((Expr_Binary_Operator *)b)->left, shift) &&
+			BenchSame(((Expr_Binary_Operator *)a)->right, ((Expr_Binary_Operator *)b)->right, shift);
+	case Expr_Kind_Assignment:
+		return BenchSame(((Expr_Assignment *)a)->left, ((Expr_Assignment *)b)->left, shift) &&
+			BenchSame(((Expr_Assignment *)a)->right, ((Expr_Assignment *)b)->right, shift);
+	NoDefaultCase();
+	}
+
+	return false;
+}
+
+static double BenchRun(String program, bool recursive, Expr_Array *result, Source_Loc *base, M_Pool *pool) {
+	Parser parser;
+	ParserInit(&parser, program, Str("bench"), pool);
+
+	if (base) *base = parser.file ? parser.file->base : 0;
+
+	double start = BenchSeconds();
+	imem   count = 0;
+
+	while (parser.lookup[0].kind != Token_Kind_END) {
+		Expr *expr = recursive ? ParseExpressionRecursive(&parser) : ParseExpressionIterative(&parser);
+		if (result) result->data[count++] = expr;
+	}
+
+	if (result) result->count = count;
+
+	return BenchSeconds() - start;
+}
+
+int main(int argc, char **argv) {
+	u32 statements = argc > 1 ? (u32)atoi(argv[1]) : 200000;
+	u32 depth      = argc > 2 ? (u32)atoi(argv[2]) : 1000000;
+
+	String program = BenchProgram(statements, 4);
+	fprintf(stdout, "input: %u statements, %.1f MB\n", statements, (double)program.count / (1024.0 * 1024.0));
+
+	M_Pool pool;
+
+	M_PoolInit(&pool, MegaBytes(64));
+	Expr_Array iterative = { 0, M_PoolPush(&pool, sizeof(Expr *) * statements, _Alignof(Expr *), 0) };
+	Expr_Array recursive = { 0, M_PoolPush(&pool, sizeof(Expr *) * statements, _Alignof(Expr *), 0) };
+	Source_Loc iterative_base, recursive_base;
+	BenchRun(program, false, &iterative, &iterative_base, &pool);
+	BenchRun(program, true, &recursive, &recursive_base, &pool);
+
+	if (recursive.count != iterative.count) {
+		fprintf(stderr, "statement count differs: %" PRId64 " recursive, %" PRId64 " iterative\n", (i64)recursive.count, (i64)iterative.count);
+		return 1;
+	}
+
+	for (imem index = 0; index < iterative.count; ++index) {
+		if (!BenchSame(recursive.data[index], iterative.data[index], iterative_base - recursive_base)) {
+			fprintf(stderr, "statement %" PRId64 " parses differently\n", (i64)index);
+			return 1;
+		}
+	}
+	M_PoolFree(&pool);
+
+	fprintf(stdout, "trees match\n");
+
+	// One arena large enough for a whole run, reset in between so that both
+	// variants parse into memory that is already committed
+	M_PoolInit(&pool, GigaBytes(1));
+	M_PoolPush(&pool, 1, 1, 0);
+
+	double best[2] = { 1e9, 1e9 };
+	for (int round = 0; round < 30; ++round) {
+		for (int variant = 0; variant < 2; ++variant) {
+			M_ArenaReset(pool.first);
+			double seconds = BenchRun(program, variant == 0, nullptr, nullptr, &pool);
+			if (seconds < best[variant]) best[variant] = seconds;
+		}
+	}
+	M_PoolFree(&pool);
+
+	fprintf(stdout, "recursive: %8.2f ms, %6.1f MB/s\n", best[0] * 1e3, (double)program.count / best[0] / (1024.0 * 1024.0));
+	fprintf(stdout, "iterative: %8.2f ms, %6.1f MB/s\n", best[1] * 1e3, (double)program.count / best[1] / (1024.0 * 1024.0));
+
+	String nested  = BenchNested(depth);
+	String negated = BenchNegated(depth);
+
+	M_PoolInit(&pool, MegaBytes(64));
+	double seconds = BenchRun(nested, false, nullptr, nullptr, &pool);
+	fprintf(stdout, "%u nested groups:     %8.2f ms\n", depth, seconds * 1e3);
+	M_PoolFree(&pool);
+
+	M_PoolInit(&pool, MegaBytes(64));
+	seconds = BenchRun(negated, false, nullptr, nullptr, &pool);
+	fprintf(stdout, "%u chained negations: %8.2f ms\n", depth, seconds * 1e3);
+	M_PoolFree(&pool);
+
+	return 0;
+}